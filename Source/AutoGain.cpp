@@ -0,0 +1,227 @@
+#include "AutoGain.h"
+#include "MultiBandEQ.h"
+
+//the bs.1770 pre-filter (a high shelf) and rlb weighting (a highpass), from their analog prototypes so they fit any rate
+static std::array<BiquadCoefficients, 2> MakeKWeighting(double sampleRate)
+{
+    std::array<BiquadCoefficients, 2> stages;
+
+    auto k = std::tan(juce::MathConstants<double>::pi * 1681.974450955533 / sampleRate);
+    auto quality = 0.7071752369554196;
+    auto vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    auto vb = std::pow(vh, 0.4996667741545416);
+    stages[0] = MakeNormalisedBiquad(vh + vb * k / quality + k * k, 2.0 * (k * k - vh), vh - vb * k / quality + k * k,
+                                     1.0 + k / quality + k * k, 2.0 * (k * k - 1.0), 1.0 - k / quality + k * k);
+
+    k = std::tan(juce::MathConstants<double>::pi * 38.13547087602444 / sampleRate);
+    quality = 0.5003270373238773;
+    stages[1] = MakeNormalisedBiquad(1.0, -2.0, 1.0, 1.0 + k / quality + k * k, 2.0 * (k * k - 1.0), 1.0 - k / quality + k * k);
+    return stages;
+}
+
+//|H|^2 of one section at a precomputed e^-jw
+static double GetSectionPower(const BiquadCoefficients& c, std::complex<double> z1)
+{
+    auto z2 = z1 * z1;
+    auto numerator = double(c.b0) + double(c.b1) * z1 + double(c.b2) * z2;
+    auto denominator = 1.0 + double(c.a1) * z1 + double(c.a2) * z2;
+    return std::norm(numerator / denominator);
+}
+
+void AutoGain::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    //somewhere around 12khz, high enough for the shelf and cheap enough to not matter
+    decimation = juce::jmax(1, int(sampleRate / 12000.0));
+    kWeighting = MakeKWeighting(sampleRate / decimation);
+    integrationCoefficient = 1.0 - std::exp(-1.0 / (3.0 * sampleRate / decimation));
+    makeup.reset(sampleRate, 0.2);
+
+    //pink noise has the same power in every octave, so on a log spaced grid each point counts the same before k-weighting
+    auto fullRateWeighting = MakeKWeighting(sampleRate);
+    auto low = 20.0;
+    auto high = juce::jmin(20000.0, sampleRate * 0.45);
+    double totalWeight = 0;
+    for (int point = 0; point < numCurvePoints; point++)
+    {
+        auto freq = low * std::pow(high / low, point / double(numCurvePoints - 1));
+        auto z1 = std::polar(1.0, -juce::MathConstants<double>::twoPi * freq / sampleRate);
+        curvePoints[(size_t) point] = z1;
+        curveWeights[(size_t) point] = GetSectionPower(fullRateWeighting[0], z1) * GetSectionPower(fullRateWeighting[1], z1);
+        totalWeight += curveWeights[(size_t) point];
+    }
+    for (auto& weight : curveWeights)
+        weight /= totalWeight;
+
+    hasSettings = false;
+    reset();
+}
+
+void AutoGain::reset()
+{
+    input = {};
+    output = {};
+    gateOpen = false;
+    lastNumDecimated = 0;
+    laggedValid = false;
+
+    makeup.setCurrentAndTargetValue(1.f);
+    startGain = endGain = 1.f;
+}
+
+void AutoGain::setChainSettings(const ChainSettings& left, const ChainSettings& right)
+{
+    if (hasSettings && left == leftSettings && right == rightSettings)
+        return;
+
+    leftSettings = left;
+    rightSettings = right;
+    hasSettings = true;
+
+    auto leftSide = MakeSideCoefficients(left, sampleRate);
+    auto rightSide = MakeSideCoefficients(right, sampleRate);
+
+    //the extra bands are linked and follow the first set, same as the processor
+    std::array<BiquadCoefficients, MultiBandEQ::maxSections> bandSections;
+    int numBandSections = 0;
+    for (const auto& band : left.bands)
+    {
+        std::array<BiquadCoefficients, maxSectionsPerBand> sections;
+        auto numSections = MakeBandSections(band, sampleRate, sections);
+        for (int s = 0; s < numSections; s++)
+            bandSections[(size_t) numBandSections++] = sections[(size_t) s];
+    }
+
+    auto sidePower = [](const SideCoefficients& side, const ChainSettings& settings, std::complex<double> z1)
+    {
+        double power = 1;
+        if (!settings.lowCutBypassed)
+            for (int s = 0; s < GetNumCutSections(settings.lowCutSlope); s++)
+                power *= GetSectionPower(side.lowCut[(size_t) s], z1);
+        if (!settings.peakBypassed)
+            power *= GetSectionPower(side.peak, z1);
+        if (!settings.highCutBypassed)
+            for (int s = 0; s < GetNumCutSections(settings.highCutSlope); s++)
+                power *= GetSectionPower(side.highCut[(size_t) s], z1);
+        return power;
+    };
+
+    double total = 0;
+    for (int point = 0; point < numCurvePoints; point++)
+    {
+        auto z1 = curvePoints[(size_t) point];
+        auto power = 0.5 * (sidePower(leftSide, left, z1) + sidePower(rightSide, right, z1));
+        for (int s = 0; s < numBandSections; s++)
+            power *= GetSectionPower(bandSections[(size_t) s], z1);
+        total += curveWeights[(size_t) point] * power;
+    }
+
+    predictedDb = 10.0 * std::log10(juce::jmax(total, 1e-12));
+}
+
+double AutoGain::Measure(Detector& detector, const juce::dsp::AudioBlock<float>& block, float fromGain, float toGain, int& numDecimated)
+{
+    auto numSamples = (int) block.getNumSamples();
+    auto channels = juce::jmin((int) block.getNumChannels(), maxChannels);
+    auto step = (toGain - fromGain) / float(juce::jmax(1, numSamples));
+
+    double power = 0;
+    for (int channel = 0; channel < channels; channel++)
+    {
+        const auto* samples = block.getChannelPointer((size_t) channel);
+        for (int i = detector.phase; i < numSamples; i += decimation)
+        {
+            auto x = samples[i] / (fromGain + step * float(i));
+
+            for (size_t stage = 0; stage < kWeighting.size(); stage++)
+            {
+                const auto& c = kWeighting[stage];
+                auto& s1 = detector.z1[stage][(size_t) channel];
+                auto& s2 = detector.z2[stage][(size_t) channel];
+                auto out = x * c.b0 + s1;
+                s1 = (x * c.b1) - (out * c.a1) + s2;
+                s2 = (x * c.b2) - (out * c.a2);
+                x = out;
+            }
+
+            power += double(x) * double(x);
+        }
+    }
+
+    numDecimated = detector.phase < numSamples ? (numSamples - 1 - detector.phase) / decimation + 1 : 0;
+    //where the next block's first look lands, carried over so the rate stays even across block boundaries
+    detector.phase = ((detector.phase - numSamples) % decimation + decimation) % decimation;
+    return power;
+}
+
+void AutoGain::Integrate(Detector& detector, double blockPower, int numDecimated)
+{
+    if (numDecimated == 0)
+        return;
+
+    //the one pole run numDecimated times over the block's mean, close enough at this time constant
+    auto decay = std::pow(1.0 - integrationCoefficient, double(numDecimated));
+    detector.meanSquare = decay * detector.meanSquare + (1.0 - decay) * blockPower / numDecimated;
+}
+
+void AutoGain::measureInput(const juce::dsp::AudioBlock<float>& block)
+{
+    int numDecimated = 0;
+    auto power = Measure(input, block, 1.f, 1.f, numDecimated);
+
+    //silence (below -70db) says nothing about loudness, so everything holds until there's signal again
+    gateOpen = numDecimated > 0 && power / numDecimated > 1e-7;
+    lastNumDecimated = numDecimated;
+    if (gateOpen)
+        Integrate(input, power, numDecimated);
+}
+
+void AutoGain::updateGain(int numSamples)
+{
+    //the prediction lagged as much as the measurement, so what's left between them is down to the material
+    if (!laggedValid)
+    {
+        laggedPredictedDb = predictedDb;
+        laggedValid = true;
+    }
+    else if (gateOpen)
+    {
+        auto decay = std::pow(1.0 - integrationCoefficient, double(lastNumDecimated));
+        laggedPredictedDb = decay * laggedPredictedDb + (1.0 - decay) * predictedDb;
+    }
+
+    double correction = 0;
+    if (input.meanSquare > 1e-7 && output.meanSquare > 1e-12)
+        correction = juce::jlimit(-12.0, 12.0, 10.0 * std::log10(output.meanSquare / input.meanSquare) - laggedPredictedDb);
+
+    auto makeupInDb = juce::jlimit(-24.0, 24.0, -(predictedDb + correction));
+    makeup.setTargetValue(juce::Decibels::decibelsToGain(float(makeupInDb)));
+
+    startGain = makeup.getCurrentValue();
+    makeup.skip(numSamples);
+    endGain = makeup.getCurrentValue();
+}
+
+void AutoGain::applyGain(juce::dsp::AudioBlock<float>& block) const
+{
+    if (startGain == 1.f && endGain == 1.f)
+        return;
+
+    auto numSamples = block.getNumSamples();
+    auto step = (endGain - startGain) / float(juce::jmax(size_t(1), numSamples));
+    for (size_t channel = 0; channel < block.getNumChannels(); channel++)
+    {
+        auto* samples = block.getChannelPointer(channel);
+        for (size_t i = 0; i < numSamples; i++)
+            samples[i] *= startGain + step * float(i);
+    }
+}
+
+void AutoGain::measureOutput(const juce::dsp::AudioBlock<float>& block)
+{
+    int numDecimated = 0;
+    auto power = Measure(output, block, startGain, endGain, numDecimated);
+    if (gateOpen)
+        Integrate(output, power, numDecimated);
+}
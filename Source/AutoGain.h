@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//makeup gain that keeps the output about as loud as the input, so a boost isn't heard as "better" in an a/b
+//two estimates of how much louder the eq is making things, combined:
+// - predicted: the power gain of the current curves, k-weighted and averaged over a pink spectrum
+//   it's known the moment a knob moves, but it knows nothing about the material
+// - measured: running k-weighted mean squares of the input and the output over a few seconds
+//   right for this material, but slow
+//the makeup follows the prediction, plus the difference between the measurement and the prediction lagged the same way
+//the measurement only looks at every decimation'th sample, with the k-weighting designed for that rate
+//(what's above the lower nyquist folds down instead of disappearing, so its energy is still counted)
+class AutoGain
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr int numCurvePoints = 48;
+
+    void prepare(double sampleRate);
+    void reset();
+
+    //the prediction is only worked out again when either side has changed
+    void setChainSettings(const ChainSettings& left, const ChainSettings& right);
+
+    //the block before the eq has touched it
+    void measureInput(const juce::dsp::AudioBlock<float>& block);
+    //moves the makeup on by a block, the ramp is applied by whichever pass writes the output last
+    void updateGain(int numSamples);
+    float getStartGain() const { return startGain; }
+    float getEndGain() const { return endGain; }
+    //for the paths that don't have a pass of their own to put the ramp in
+    void applyGain(juce::dsp::AudioBlock<float>& block) const;
+    //the finished block, with the ramp in it (it gets divided back out)
+    void measureOutput(const juce::dsp::AudioBlock<float>& block);
+
+    float getMakeupGainInDb() const { return juce::Decibels::gainToDecibels(endGain); }
+
+private:
+    struct Detector
+    {
+        std::array<std::array<float, maxChannels>, 2> z1 {}, z2 {};
+        int phase {0};
+        double meanSquare {0};
+    };
+
+    //k-weights every decimation'th sample from phase on and returns their summed power, gain divides out a ramp
+    double Measure(Detector& detector, const juce::dsp::AudioBlock<float>& block, float fromGain, float toGain, int& numDecimated);
+    void Integrate(Detector& detector, double blockPower, int numDecimated);
+
+    double sampleRate {44100.0};
+    int decimation {1};
+    //the two stages of the k-weighting, a high shelf and a highpass, at the decimated rate
+    std::array<BiquadCoefficients, 2> kWeighting;
+    //per decimated sample, a few seconds like short term loudness
+    double integrationCoefficient {0};
+
+    Detector input, output;
+    bool gateOpen {false};
+    int lastNumDecimated {0};
+
+    //where the prediction looks: log spaced points with e^-jw and a pink k-weighted share of the total each
+    std::array<std::complex<double>, numCurvePoints> curvePoints {};
+    std::array<double, numCurvePoints> curveWeights {};
+    ChainSettings leftSettings, rightSettings;
+    bool hasSettings {false};
+    double predictedDb {0}, laggedPredictedDb {0};
+    bool laggedValid {false};
+
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> makeup {1.f};
+    float startGain {1.f}, endGain {1.f};
+
+    JUCE_LEAK_DETECTOR (AutoGain)
+};
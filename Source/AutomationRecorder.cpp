@@ -0,0 +1,203 @@
+#include "AutomationRecorder.h"
+
+AutomationRecorder::AutomationRecorder(juce::AudioProcessor& processorToRecord)
+    : processor(processorToRecord)
+{
+    //the layout is fixed by the time the processor's constructor gets here
+    const auto& parameters = processor.getParameters();
+    numParameters = parameters.size();
+    changed = std::make_unique<std::atomic<bool>[]>((size_t) numParameters);
+    for (auto* parameter : parameters)
+        parameter->addListener(this);
+}
+
+AutomationRecorder::~AutomationRecorder()
+{
+    stop();
+
+    for (auto* parameter : processor.getParameters())
+        parameter->removeListener(this);
+}
+
+void AutomationRecorder::parameterValueChanged(int parameterIndex, float)
+{
+    if (!juce::isPositiveAndBelow(parameterIndex, numParameters))
+        return;
+
+    changed[(size_t) parameterIndex].store(true, std::memory_order_relaxed);
+    anyChanged.store(true, std::memory_order_release);
+}
+
+bool AutomationRecorder::start(const juce::File& file, double sampleRate)
+{
+    if (recording.load())
+        return false;
+
+    file.deleteFile();
+    auto newStream = std::make_unique<juce::FileOutputStream>(file);
+    if (!newStream->openedOk())
+        return false;
+
+    const auto& parameters = processor.getParameters();
+    newStream->writeInt(magic);
+    newStream->writeInt(currentVersion);
+    newStream->writeDouble(sampleRate);
+    headerPatchOffset = newStream->getPosition();
+    newStream->writeInt(0);
+    newStream->writeInt(0);
+    newStream->writeInt(parameters.size());
+    for (auto* parameter : parameters)
+    {
+        auto* withId = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter);
+        newStream->writeString(withId != nullptr ? withId->paramID : parameter->getName(64));
+    }
+
+    //nothing on the audio thread looks at any of this until recording is set
+    if (events.empty())
+        events.resize((size_t) fifoSize);
+    lastValues.assign((size_t) parameters.size(), 0.f);
+    fifo.reset();
+    position = 0;
+    needsSnapshot = true;
+    numDropped = 0;
+    maxBlockSize = 0;
+    stream = std::move(newStream);
+
+    drainTrigger.start();
+    recording = true;
+    return true;
+}
+
+void AutomationRecorder::stop()
+{
+    if (!recording.exchange(false))
+        return;
+
+    //a block that saw recording set might still be pushing
+    while (inBlock.load())
+        juce::Thread::yield();
+
+    drainTrigger.stop();
+
+    //whatever the drain job didn't get to, then the numbers the header was waiting for
+    Drain();
+    stream->flush();
+    if (stream->setPosition(headerPatchOffset))
+    {
+        stream->writeInt(maxBlockSize.load());
+        stream->writeInt(numDropped.load());
+    }
+    stream.reset();
+}
+
+void AutomationRecorder::Push(const AutomationTrace::Event& event)
+{
+    //a full fifo means the drain job has fallen way behind, the trace says how much is missing
+    const auto scope = fifo.write(1);
+    if (scope.blockSize1 == 0)
+    {
+        numDropped++;
+        return;
+    }
+
+    events[(size_t) scope.startIndex1] = event;
+}
+
+void AutomationRecorder::recordBlock(int numSamples)
+{
+    inBlock = true;
+
+    if (recording.load())
+    {
+        //a parameter flagged after its flag was read here still has anyChanged set for the next block
+        if (anyChanged.exchange(false, std::memory_order_acquire) || needsSnapshot)
+        {
+            const auto& parameters = processor.getParameters();
+            auto numToRead = juce::jmin(numParameters, (int) lastValues.size());
+            for (int i = 0; i < numToRead; i++)
+            {
+                if (!changed[(size_t) i].exchange(false, std::memory_order_relaxed) && !needsSnapshot)
+                    continue;
+
+                //a parameter set back to where it was since the last block has nothing to record
+                auto value = parameters.getUnchecked(i)->getValue();
+                if (needsSnapshot || value != lastValues[(size_t) i])
+                {
+                    lastValues[(size_t) i] = value;
+                    Push({ position, i, value });
+                }
+            }
+            needsSnapshot = false;
+        }
+
+        Push({ position, AutomationTrace::Event::blockStart, float(numSamples) });
+        position += numSamples;
+        if (numSamples > maxBlockSize.load(std::memory_order_relaxed))
+            maxBlockSize.store(numSamples, std::memory_order_relaxed);
+
+        if (fifo.getNumReady() >= drainThreshold)
+            drainTrigger.fire();
+    }
+
+    inBlock = false;
+}
+
+void AutomationRecorder::Drain()
+{
+    auto ready = fifo.getNumReady();
+    if (ready == 0 || stream == nullptr)
+        return;
+
+    const auto scope = fifo.read(ready);
+    scope.forEach([this](int index)
+    {
+        const auto& event = events[(size_t) index];
+        stream->writeCompressedInt(event.parameter + 1);
+        if (event.parameter == AutomationTrace::Event::blockStart)
+            stream->writeCompressedInt(int(event.value));
+        else
+            stream->writeFloat(event.value);
+    });
+}
+
+bool AutomationRecorder::readTrace(const juce::File& file, AutomationTrace& trace)
+{
+    juce::FileInputStream stream (file);
+    if (!stream.openedOk() || stream.readInt() != magic)
+        return false;
+
+    //a newer version might have changed the layout in ways we can't read
+    if (stream.readInt() > currentVersion)
+        return false;
+
+    trace = {};
+    trace.sampleRate = stream.readDouble();
+    trace.maxBlockSize = stream.readInt();
+    trace.numDropped = stream.readInt();
+
+    auto numParameters = stream.readInt();
+    if (numParameters < 0)
+        return false;
+    for (int i = 0; i < numParameters; i++)
+        trace.parameterIds.add(stream.readString());
+
+    juce::int64 position = 0;
+    while (!stream.isExhausted())
+    {
+        auto code = stream.readCompressedInt();
+        if (code == 0)
+        {
+            auto length = stream.readCompressedInt();
+            trace.events.push_back({ position, AutomationTrace::Event::blockStart, float(length) });
+            position += length;
+            continue;
+        }
+
+        auto value = stream.readFloat();
+        if (code > numParameters)
+            return false;
+        trace.events.push_back({ position, code - 1, value });
+    }
+
+    return trace.sampleRate > 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "WorkerPool.h"
+
+//a recorded trace read back in, the events are in the order they happened with their positions filled in
+struct AutomationTrace
+{
+    //one thing that happened on the audio thread while recording
+    //a parameter change (parameter >= 0, value normalised) or the start of a block (parameter == blockStart, value = its length)
+    struct Event
+    {
+        static constexpr int blockStart = -1;
+
+        juce::int64 position {0};
+        int parameter {blockStart};
+        float value {0};
+    };
+
+    double sampleRate {0};
+    int maxBlockSize {0};
+    int numDropped {0};
+    //the trace's parameter indices are into this, so a trace still replays if the parameter layout changes
+    juce::StringArray parameterIds;
+    std::vector<Event> events;
+};
+
+//records the exact parameter stream an instance sees, so a cpu spike a customer hits can be replayed for profiling
+//
+//trace file layout (little endian):
+//  int   magic ("SEQA")
+//  int   version
+//  double sample rate
+//  int   largest block
+//  int   events that didn't fit in the fifo (0 for a complete trace)
+//  int   number of parameters, then every parameter id as a utf8 string
+//  then the events, the positions are implied by the block lengths:
+//  compressed int  parameter index + 1, or 0 for the start of a block
+//  float value (normalised) for a parameter, or compressed int length for a block
+//
+//every parameter has a listener that flags it when it changes, from whichever thread changed it. the audio thread only
+//reads the flagged ones and pushes them, plus the block itself, into a preallocated fifo, so a block with no automation
+//costs one atomic. a job on the shared worker pool drains that to the file. the first block recorded has every parameter
+//in it, so a replay starts from the same state
+class AutomationRecorder  : private juce::AudioProcessorParameter::Listener
+{
+public:
+    static constexpr int magic = 0x41514553; //"SEQA"
+    static constexpr int currentVersion = 1;
+    static constexpr int fifoSize = 1 << 15;
+    //how many events pile up before the audio thread asks for them to be written
+    static constexpr int drainThreshold = 512;
+
+    explicit AutomationRecorder(juce::AudioProcessor& processor);
+    ~AutomationRecorder() override;
+
+    //message thread
+    //returns false if the file can't be written or a recording is already running
+    bool start(const juce::File& file, double sampleRate);
+    //waits for everything the audio thread has pushed to reach the file
+    void stop();
+    bool isRecording() const { return recording.load(); }
+    int getNumDropped() const { return numDropped.load(); }
+    size_t getMemoryUsageInBytes() const
+    {
+        return sizeof(*this) + GetVectorBytes(events) + GetVectorBytes(lastValues) + (size_t) numParameters * sizeof(std::atomic<bool>);
+    }
+
+    //audio thread, at the start of every block, does nothing unless recording
+    void recordBlock(int numSamples);
+
+    static bool readTrace(const juce::File& file, AutomationTrace& trace);
+
+private:
+    void Drain();
+    void Push(const AutomationTrace::Event& event);
+
+    //any thread, whoever set the parameter
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override {}
+
+    juce::AudioProcessor& processor;
+
+    //one flag per parameter, set by the listener and cleared by the audio thread when it records the new value
+    //anyChanged is set after the parameter's own flag, so a block that finds it clear can skip the lot
+    int numParameters {0};
+    std::unique_ptr<std::atomic<bool>[]> changed;
+    std::atomic<bool> anyChanged {false};
+
+    //allocated by the first recording and kept, the audio thread only touches them while recording is set
+    juce::AbstractFifo fifo {fifoSize};
+    std::vector<AutomationTrace::Event> events;
+    std::vector<float> lastValues;
+    juce::int64 position {0};
+    bool needsSnapshot {false};
+
+    //inBlock is held while the audio thread is recording a block, so stop knows when it's done pushing
+    std::atomic<bool> recording {false}, inBlock {false};
+    std::atomic<int> numDropped {0}, maxBlockSize {0};
+
+    //only the drain job writes to it while recording, stop finishes it off
+    std::unique_ptr<juce::FileOutputStream> stream;
+    //where the largest block and dropped count go in the header, they're only known at the end
+    juce::int64 headerPatchOffset {0};
+
+    //nobody's waiting on a trace, it can wait for everything else
+    WorkerPool::Client workers {WorkerPool::background};
+    WorkerPool::Trigger drainTrigger {workers, [this] { Drain(); }};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AutomationRecorder)
+};
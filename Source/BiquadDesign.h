@@ -0,0 +1,130 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//plain normalised biquad coefficients (a0 = 1) that can be stored in flat arrays
+//the designers below are closed form and don't allocate, unlike IIR::Coefficients
+//everything realtime stores floats, the offline render path keeps doubles so low cuts at high oversampling stay accurate
+template<typename SampleType>
+struct BiquadCoefficientsOf
+{
+    SampleType b0 {1}, b1 {0}, b2 {0}, a1 {0}, a2 {0};
+};
+using BiquadCoefficients = BiquadCoefficientsOf<float>;
+
+//divides everything through by a0
+template<typename SampleType = float>
+inline BiquadCoefficientsOf<SampleType> MakeNormalisedBiquad(double b0, double b1, double b2, double a0, double a1, double a2)
+{
+    auto scale = 1.0 / a0;
+    return { SampleType(b0 * scale), SampleType(b1 * scale), SampleType(b2 * scale), SampleType(a1 * scale), SampleType(a2 * scale) };
+}
+
+//same formulas as IIR::Coefficients::makePeakFilter / makeLowShelf / makeHighShelf (rbj cookbook)
+template<typename SampleType = float>
+inline BiquadCoefficientsOf<SampleType> MakeBellBiquad(double sampleRate, double freq, double quality, float gainInDb)
+{
+    auto a = std::sqrt(double(juce::Decibels::decibelsToGain(gainInDb)));
+    auto omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+    auto alpha = std::sin(omega) / (2.0 * quality);
+    auto c2 = -2.0 * std::cos(omega);
+
+    return MakeNormalisedBiquad<SampleType>(1.0 + alpha * a, c2, 1.0 - alpha * a,
+                                1.0 + alpha / a, c2, 1.0 - alpha / a);
+}
+
+template<typename SampleType = float>
+inline BiquadCoefficientsOf<SampleType> MakeLowShelfBiquad(double sampleRate, double freq, double quality, float gainInDb)
+{
+    auto a = std::sqrt(double(juce::Decibels::decibelsToGain(gainInDb)));
+    auto omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+    auto cosOmega = std::cos(omega);
+    auto beta = std::sin(omega) * std::sqrt(a) / quality;
+    auto aMinus1TimesCos = (a - 1.0) * cosOmega;
+
+    return MakeNormalisedBiquad<SampleType>(a * (a + 1.0 - aMinus1TimesCos + beta),
+                                a * 2.0 * (a - 1.0 - (a + 1.0) * cosOmega),
+                                a * (a + 1.0 - aMinus1TimesCos - beta),
+                                a + 1.0 + aMinus1TimesCos + beta,
+                                -2.0 * (a - 1.0 + (a + 1.0) * cosOmega),
+                                a + 1.0 + aMinus1TimesCos - beta);
+}
+
+template<typename SampleType = float>
+inline BiquadCoefficientsOf<SampleType> MakeHighShelfBiquad(double sampleRate, double freq, double quality, float gainInDb)
+{
+    auto a = std::sqrt(double(juce::Decibels::decibelsToGain(gainInDb)));
+    auto omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+    auto cosOmega = std::cos(omega);
+    auto beta = std::sin(omega) * std::sqrt(a) / quality;
+    auto aMinus1TimesCos = (a - 1.0) * cosOmega;
+
+    return MakeNormalisedBiquad<SampleType>(a * (a + 1.0 + aMinus1TimesCos + beta),
+                                a * -2.0 * (a - 1.0 + (a + 1.0) * cosOmega),
+                                a * (a + 1.0 + aMinus1TimesCos - beta),
+                                a + 1.0 - aMinus1TimesCos + beta,
+                                2.0 * (a - 1.0 - (a + 1.0) * cosOmega),
+                                a + 1.0 - aMinus1TimesCos - beta);
+}
+
+template<typename SampleType = float>
+inline BiquadCoefficientsOf<SampleType> MakeNotchBiquad(double sampleRate, double freq, double quality)
+{
+    auto omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+    auto alpha = std::sin(omega) / (2.0 * quality);
+    auto c2 = -2.0 * std::cos(omega);
+
+    return MakeNormalisedBiquad<SampleType>(1.0, c2, 1.0, 1.0 + alpha, c2, 1.0 - alpha);
+}
+
+template<typename SampleType = float>
+inline BiquadCoefficientsOf<SampleType> MakeHighPassBiquad(double sampleRate, double freq, double quality)
+{
+    auto omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+    auto alpha = std::sin(omega) / (2.0 * quality);
+    auto cosOmega = std::cos(omega);
+
+    return MakeNormalisedBiquad<SampleType>((1.0 + cosOmega) * .5, -(1.0 + cosOmega), (1.0 + cosOmega) * .5,
+                                1.0 + alpha, -2.0 * cosOmega, 1.0 - alpha);
+}
+
+template<typename SampleType = float>
+inline BiquadCoefficientsOf<SampleType> MakeLowPassBiquad(double sampleRate, double freq, double quality)
+{
+    auto omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+    auto alpha = std::sin(omega) / (2.0 * quality);
+    auto cosOmega = std::cos(omega);
+
+    return MakeNormalisedBiquad<SampleType>((1.0 - cosOmega) * .5, 1.0 - cosOmega, (1.0 - cosOmega) * .5,
+                                1.0 + alpha, -2.0 * cosOmega, 1.0 - alpha);
+}
+
+//Q of one section of an even order butterworth cascade, same as FilterDesign's high order butterworth designs
+//so a cut built from MakeHighPassBiquad / MakeLowPassBiquad with these matches the juce design
+inline double GetButterworthQuality(int order, int section)
+{
+    return 1.0 / (2.0 * std::cos((2.0 * section + 1.0) * juce::MathConstants<double>::pi / (order * 2.0)));
+}
+
+//band pass with 0db at the centre frequency
+template<typename SampleType = float>
+inline BiquadCoefficientsOf<SampleType> MakeBandPassBiquad(double sampleRate, double freq, double quality)
+{
+    auto omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+    auto alpha = std::sin(omega) / (2.0 * quality);
+
+    return MakeNormalisedBiquad<SampleType>(alpha, 0.0, -alpha, 1.0 + alpha, -2.0 * std::cos(omega), 1.0 - alpha);
+}
+
+//|H(e^jw)| of one section, same as IIR::Coefficients::getMagnitudeForFrequency
+template<typename SampleType>
+inline double GetBiquadMagnitude(const BiquadCoefficientsOf<SampleType>& c, double freq, double sampleRate)
+{
+    auto omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+    std::complex<double> z1 = std::polar(1.0, -omega);
+    std::complex<double> z2 = z1 * z1;
+
+    auto numerator = double(c.b0) + double(c.b1) * z1 + double(c.b2) * z2;
+    auto denominator = 1.0 + double(c.a1) * z1 + double(c.a2) * z2;
+    return std::abs(numerator / denominator);
+}
@@ -0,0 +1,614 @@
+#include "BiquadKernels.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #define SIMPLEEQ_X86_KERNELS 1
+#endif
+
+#if JUCE_ARM && (defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define SIMPLEEQ_NEON_KERNELS 1
+#endif
+
+//every variant has to round exactly like the scalar one, so none of them can have a multiply and an add fused
+//into one instruction. gcc fuses them at -O2 whenever the target has fma (-ffp-contract=fast is its default),
+//so the kernels turn that off for themselves. clang and msvc only fuse within one expression, or when asked,
+//and the pragmas turn that off for the whole file
+#if JUCE_CLANG
+ #pragma clang fp contract (off)
+ #define SIMPLEEQ_NO_CONTRACT
+#elif JUCE_GCC
+ #define SIMPLEEQ_NO_CONTRACT __attribute__ ((optimize ("fp-contract=off")))
+#else
+ #if JUCE_MSVC
+  #pragma fp_contract (off)
+ #endif
+ #define SIMPLEEQ_NO_CONTRACT
+#endif
+
+//gcc and clang only let us use an instruction set's intrinsics inside functions marked for it,
+//msvc lets us use them anywhere
+#if JUCE_CLANG
+ #define SIMPLEEQ_TARGET(isa) __attribute__ ((target (isa)))
+#elif JUCE_GCC
+ #define SIMPLEEQ_TARGET(isa) __attribute__ ((target (isa), optimize ("fp-contract=off")))
+#else
+ #define SIMPLEEQ_TARGET(isa)
+#endif
+
+namespace BiquadKernels
+{
+
+constexpr int coefficientStride = 5 * maxLanes;
+constexpr int stateStride = 2 * maxLanes;
+
+//one lane at a time, the compiler is free to do what it likes with it apart from fusing
+SIMPLEEQ_NO_CONTRACT
+static inline float ProcessScalarSample(float x, int lane, int numSections, const float* coefficients, float* state)
+{
+    for (int s = 0; s < numSections; s++)
+    {
+        auto* c = coefficients + s * coefficientStride + lane;
+        auto* z = state + s * stateStride + lane;
+
+        auto out = x * c[0] + z[0];
+        z[0] = (x * c[maxLanes]) - (out * c[3 * maxLanes]) + z[maxLanes];
+        z[maxLanes] = (x * c[2 * maxLanes]) - (out * c[4 * maxLanes]);
+        x = out;
+    }
+
+    return x;
+}
+
+SIMPLEEQ_NO_CONTRACT
+static void ProcessScalar(float* const* channels, int numChannels, int numSamples,
+                          int numSections, const float* coefficients, float* state, bool encodeMidSide)
+{
+    auto firstLane = 0;
+    if (encodeMidSide)
+    {
+        //mid and side both need the left and right input, so those two lanes go through side by side
+        auto* left = channels[0];
+        auto* right = channels[1];
+        for (int i = 0; i < numSamples; i++)
+        {
+            auto mid = (left[i] + right[i]) * .5f;
+            auto side = (left[i] - right[i]) * .5f;
+            left[i] = ProcessScalarSample(mid, 0, numSections, coefficients, state);
+            right[i] = ProcessScalarSample(side, 1, numSections, coefficients, state);
+        }
+        firstLane = 2;
+    }
+
+    for (int lane = firstLane; lane < numChannels; lane++)
+    {
+        auto* samples = channels[lane];
+        for (int i = 0; i < numSamples; i++)
+            samples[i] = ProcessScalarSample(samples[i], lane, numSections, coefficients, state);
+    }
+}
+
+//the vector kernels gather one sample from every channel into a register, run it through every section
+//and scatter it back, width lanes at a time. every width holds the first two channels in one pass, so the
+//mid/side encode is done on the gathered samples
+template <int width>
+static inline void Gather(float* const* channels, int firstLane, int numChannels, int i, bool encodeMidSide, float* x)
+{
+    for (int lane = 0; lane < width; lane++)
+        x[lane] = firstLane + lane < numChannels ? channels[firstLane + lane][i] : 0.f;
+
+    if (encodeMidSide && firstLane == 0)
+    {
+        auto left = x[0], right = x[1];
+        x[0] = (left + right) * .5f;
+        x[1] = (left - right) * .5f;
+    }
+}
+
+template <int width>
+static inline void Scatter(float* const* channels, int firstLane, int numChannels, int i, const float* x)
+{
+    for (int lane = 0; lane < width && firstLane + lane < numChannels; lane++)
+        channels[firstLane + lane][i] = x[lane];
+}
+
+#if SIMPLEEQ_X86_KERNELS
+SIMPLEEQ_TARGET("sse2")
+static void ProcessSSE2(float* const* channels, int numChannels, int numSamples,
+                        int numSections, const float* coefficients, float* state, bool encodeMidSide)
+{
+    constexpr int width = 4;
+    alignas(16) float x[width];
+
+    for (int firstLane = 0; firstLane < numChannels; firstLane += width)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            Gather<width>(channels, firstLane, numChannels, i, encodeMidSide, x);
+            auto in = _mm_load_ps(x);
+
+            for (int s = 0; s < numSections; s++)
+            {
+                auto* c = coefficients + s * coefficientStride + firstLane;
+                auto* z = state + s * stateStride + firstLane;
+                auto z1 = _mm_loadu_ps(z);
+                auto z2 = _mm_loadu_ps(z + maxLanes);
+
+                auto out = _mm_add_ps(_mm_mul_ps(in, _mm_loadu_ps(c)), z1);
+                z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(in, _mm_loadu_ps(c + maxLanes)), _mm_mul_ps(out, _mm_loadu_ps(c + 3 * maxLanes))), z2);
+                z2 = _mm_sub_ps(_mm_mul_ps(in, _mm_loadu_ps(c + 2 * maxLanes)), _mm_mul_ps(out, _mm_loadu_ps(c + 4 * maxLanes)));
+
+                _mm_storeu_ps(z, z1);
+                _mm_storeu_ps(z + maxLanes, z2);
+                in = out;
+            }
+
+            _mm_store_ps(x, in);
+            Scatter<width>(channels, firstLane, numChannels, i, x);
+        }
+    }
+}
+
+SIMPLEEQ_TARGET("avx2")
+static void ProcessAVX2(float* const* channels, int numChannels, int numSamples,
+                        int numSections, const float* coefficients, float* state, bool encodeMidSide)
+{
+    constexpr int width = 8;
+    alignas(32) float x[width];
+
+    for (int firstLane = 0; firstLane < numChannels; firstLane += width)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            Gather<width>(channels, firstLane, numChannels, i, encodeMidSide, x);
+            auto in = _mm256_load_ps(x);
+
+            for (int s = 0; s < numSections; s++)
+            {
+                auto* c = coefficients + s * coefficientStride + firstLane;
+                auto* z = state + s * stateStride + firstLane;
+                auto z1 = _mm256_loadu_ps(z);
+                auto z2 = _mm256_loadu_ps(z + maxLanes);
+
+                auto out = _mm256_add_ps(_mm256_mul_ps(in, _mm256_loadu_ps(c)), z1);
+                z1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(in, _mm256_loadu_ps(c + maxLanes)), _mm256_mul_ps(out, _mm256_loadu_ps(c + 3 * maxLanes))), z2);
+                z2 = _mm256_sub_ps(_mm256_mul_ps(in, _mm256_loadu_ps(c + 2 * maxLanes)), _mm256_mul_ps(out, _mm256_loadu_ps(c + 4 * maxLanes)));
+
+                _mm256_storeu_ps(z, z1);
+                _mm256_storeu_ps(z + maxLanes, z2);
+                in = out;
+            }
+
+            _mm256_store_ps(x, in);
+            Scatter<width>(channels, firstLane, numChannels, i, x);
+        }
+    }
+}
+
+SIMPLEEQ_TARGET("avx512f")
+static void ProcessAVX512(float* const* channels, int numChannels, int numSamples,
+                          int numSections, const float* coefficients, float* state, bool encodeMidSide)
+{
+    constexpr int width = 16;
+    alignas(64) float x[width];
+
+    for (int firstLane = 0; firstLane < numChannels; firstLane += width)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            Gather<width>(channels, firstLane, numChannels, i, encodeMidSide, x);
+            auto in = _mm512_load_ps(x);
+
+            for (int s = 0; s < numSections; s++)
+            {
+                auto* c = coefficients + s * coefficientStride + firstLane;
+                auto* z = state + s * stateStride + firstLane;
+                auto z1 = _mm512_loadu_ps(z);
+                auto z2 = _mm512_loadu_ps(z + maxLanes);
+
+                auto out = _mm512_add_ps(_mm512_mul_ps(in, _mm512_loadu_ps(c)), z1);
+                z1 = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(in, _mm512_loadu_ps(c + maxLanes)), _mm512_mul_ps(out, _mm512_loadu_ps(c + 3 * maxLanes))), z2);
+                z2 = _mm512_sub_ps(_mm512_mul_ps(in, _mm512_loadu_ps(c + 2 * maxLanes)), _mm512_mul_ps(out, _mm512_loadu_ps(c + 4 * maxLanes)));
+
+                _mm512_storeu_ps(z, z1);
+                _mm512_storeu_ps(z + maxLanes, z2);
+                in = out;
+            }
+
+            _mm512_store_ps(x, in);
+            Scatter<width>(channels, firstLane, numChannels, i, x);
+        }
+    }
+}
+#endif
+
+#if SIMPLEEQ_NEON_KERNELS
+SIMPLEEQ_NO_CONTRACT
+static void ProcessNEON(float* const* channels, int numChannels, int numSamples,
+                        int numSections, const float* coefficients, float* state, bool encodeMidSide)
+{
+    constexpr int width = 4;
+    alignas(16) float x[width];
+
+    for (int firstLane = 0; firstLane < numChannels; firstLane += width)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            Gather<width>(channels, firstLane, numChannels, i, encodeMidSide, x);
+            auto in = vld1q_f32(x);
+
+            for (int s = 0; s < numSections; s++)
+            {
+                auto* c = coefficients + s * coefficientStride + firstLane;
+                auto* z = state + s * stateStride + firstLane;
+                auto z1 = vld1q_f32(z);
+                auto z2 = vld1q_f32(z + maxLanes);
+
+                //separate multiplies and adds rather than vmlaq, which would round differently to the other variants
+                auto out = vaddq_f32(vmulq_f32(in, vld1q_f32(c)), z1);
+                z1 = vaddq_f32(vsubq_f32(vmulq_f32(in, vld1q_f32(c + maxLanes)), vmulq_f32(out, vld1q_f32(c + 3 * maxLanes))), z2);
+                z2 = vsubq_f32(vmulq_f32(in, vld1q_f32(c + 2 * maxLanes)), vmulq_f32(out, vld1q_f32(c + 4 * maxLanes)));
+
+                vst1q_f32(z, z1);
+                vst1q_f32(z + maxLanes, z2);
+                in = out;
+            }
+
+            vst1q_f32(x, in);
+            Scatter<width>(channels, firstLane, numChannels, i, x);
+        }
+    }
+}
+#endif
+
+std::vector<VariantReport> CheckVariants(double sampleRate)
+{
+    constexpr int fftOrder = 14;
+    constexpr int length = 1 << fftOrder;
+    constexpr int numLanes = 2;
+
+    //a 48db lowcut, a bell and a 24db highcut, with a different bell on each lane
+    std::vector<std::array<BiquadCoefficients, numLanes>> sections;
+    for (int i = 0; i < 4; i++)
+    {
+        auto section = MakeHighPassBiquad(sampleRate, 80.0, GetButterworthQuality(8, i));
+        sections.push_back({ section, section });
+    }
+    sections.push_back({ MakeBellBiquad(sampleRate, 1000.0, 1.0, 6.f), MakeBellBiquad(sampleRate, 3000.0, 4.0, -12.f) });
+    for (int i = 0; i < 2; i++)
+    {
+        auto section = MakeLowPassBiquad(sampleRate, juce::jmin(8000.0, sampleRate * 0.45), GetButterworthQuality(4, i));
+        sections.push_back({ section, section });
+    }
+
+    auto numSections = (int) sections.size();
+    std::vector<float> coefficients((size_t) (numSections * coefficientStride), 0.f);
+    for (int s = 0; s < numSections; s++)
+    {
+        for (int lane = 0; lane < numLanes; lane++)
+        {
+            const auto& c = sections[(size_t) s][(size_t) lane];
+            auto* destination = coefficients.data() + s * coefficientStride + lane;
+            destination[0] = c.b0;
+            destination[maxLanes] = c.b1;
+            destination[2 * maxLanes] = c.b2;
+            destination[3 * maxLanes] = c.a1;
+            destination[4 * maxLanes] = c.a2;
+        }
+    }
+
+    //impulse, log sweep from 20hz to nyquist and noise from a fixed seed, one after another
+    std::vector<float> input((size_t) (3 * length), 0.f);
+    input[0] = 1.f;
+    for (int i = 0; i < length; i++)
+    {
+        auto t = double(i) / length;
+        auto phase = juce::MathConstants<double>::twoPi * 20.0 * length / sampleRate / std::log(sampleRate * 0.5 / 20.0)
+                   * (std::pow(sampleRate * 0.5 / 20.0, t) - 1.0);
+        input[(size_t) (length + i)] = float(0.5 * std::sin(phase));
+    }
+    juce::Random random (0x5eed);
+    for (int i = 0; i < length; i++)
+        input[(size_t) (2 * length + i)] = random.nextFloat() - 0.5f;
+
+    auto render = [&](Variant variant)
+    {
+        std::vector<float> output((size_t) numLanes * input.size());
+        float* channels[numLanes];
+        for (int lane = 0; lane < numLanes; lane++)
+        {
+            std::copy(input.begin(), input.end(), output.begin() + lane * (int) input.size());
+            channels[lane] = output.data() + lane * input.size();
+        }
+
+        //odd sized blocks so the state gets carried across block boundaries too
+        std::vector<float> state((size_t) (numSections * stateStride), 0.f);
+        auto process = GetProcessFunction(variant);
+        for (int start = 0; start < (int) input.size(); start += 509)
+        {
+            float* offsetChannels[numLanes];
+            for (int lane = 0; lane < numLanes; lane++)
+                offsetChannels[lane] = channels[lane] + start;
+            process(offsetChannels, numLanes, juce::jmin(509, (int) input.size() - start), numSections, coefficients.data(), state.data(), false);
+        }
+        return output;
+    };
+
+    auto reference = render(Variant::Scalar);
+
+    //the scalar impulse response against the product of every section's magnitude
+    double magnitudeError = 0;
+    {
+        juce::dsp::FFT fft (fftOrder);
+        for (int lane = 0; lane < numLanes; lane++)
+        {
+            std::vector<float> spectrum((size_t) (2 * length), 0.f);
+            std::copy(reference.begin() + lane * (int) input.size(), reference.begin() + lane * (int) input.size() + length, spectrum.begin());
+            fft.performFrequencyOnlyForwardTransform(spectrum.data(), true);
+
+            //skip the bins right at the bottom and top, where the cuts are far below anything audible
+            for (int bin = 8; bin < length / 2 - 8; bin++)
+            {
+                auto freq = double(bin) * sampleRate / length;
+                double expected = 1.0;
+                for (const auto& section : sections)
+                    expected *= GetBiquadMagnitude(section[(size_t) lane], freq, sampleRate);
+
+                if (expected > 1.0e-3)
+                    magnitudeError = juce::jmax(magnitudeError, std::abs(juce::Decibels::gainToDecibels(double(spectrum[(size_t) bin]), -200.0)
+                                                                         - juce::Decibels::gainToDecibels(expected, -200.0)));
+            }
+        }
+    }
+
+    std::vector<VariantReport> reports;
+    for (int i = 0; i < numVariants; i++)
+    {
+        auto variant = static_cast<Variant>(i);
+        if (!IsVariantSupported(variant))
+            continue;
+
+        auto output = variant == Variant::Scalar ? reference : render(variant);
+
+        VariantReport report;
+        report.variant = variant;
+        report.magnitudeErrorInDb = magnitudeError;
+
+        double errorEnergy = 0, signalEnergy = 0;
+        for (size_t n = 0; n < output.size(); n++)
+        {
+            auto error = output[n] - reference[n];
+            report.maxError = juce::jmax(report.maxError, std::abs(error));
+            errorEnergy += double(error) * error;
+            signalEnergy += double(reference[n]) * reference[n];
+        }
+
+        if (errorEnergy > 0 && signalEnergy > 0)
+            report.nullDepthInDb = 10.0 * std::log10(errorEnergy / signalEnergy);
+
+        reports.push_back(report);
+    }
+
+    return reports;
+}
+
+juce::String GetVariantName(Variant variant)
+{
+    switch (variant)
+    {
+        case Variant::Scalar: return "Scalar";
+        case Variant::SSE2:   return "SSE2";
+        case Variant::AVX2:   return "AVX2";
+        case Variant::AVX512: return "AVX-512";
+        case Variant::NEON:   return "NEON";
+    }
+
+    return {};
+}
+
+bool IsVariantSupported(Variant variant)
+{
+    switch (variant)
+    {
+        case Variant::Scalar: return true;
+       #if SIMPLEEQ_X86_KERNELS
+        case Variant::SSE2:   return juce::SystemStats::hasSSE2();
+        case Variant::AVX2:   return juce::SystemStats::hasAVX2();
+        case Variant::AVX512: return juce::SystemStats::hasAVX512F();
+       #endif
+       #if SIMPLEEQ_NEON_KERNELS
+        case Variant::NEON:   return juce::SystemStats::hasNeon();
+       #endif
+        default:              return false;
+    }
+}
+
+int GetVariantWidth(Variant variant)
+{
+    switch (variant)
+    {
+        case Variant::SSE2:   return 4;
+        case Variant::AVX2:   return 8;
+        case Variant::AVX512: return 16;
+        case Variant::NEON:   return 4;
+        case Variant::Scalar: break;
+    }
+
+    return 1;
+}
+
+static Variant FindBestVariant(int numChannels)
+{
+    //narrowest first, the first one wide enough wins and otherwise we end up with the widest
+    auto best = Variant::Scalar;
+    for (auto variant : { Variant::SSE2, Variant::NEON, Variant::AVX2, Variant::AVX512 })
+    {
+        if (!IsVariantSupported(variant))
+            continue;
+
+        best = variant;
+        if (GetVariantWidth(variant) >= numChannels)
+            break;
+    }
+
+    return best;
+}
+
+Variant GetBestVariant(int numChannels)
+{
+    //one per channel count, so the audio thread only ever reads a table
+    static const auto table = []
+    {
+        std::array<Variant, maxLanes + 1> bestForChannels {};
+        for (int channels = 0; channels <= maxLanes; channels++)
+            bestForChannels[(size_t) channels] = FindBestVariant(channels);
+        return bestForChannels;
+    }();
+
+    return table[(size_t) juce::jlimit(0, maxLanes, numChannels)];
+}
+
+ProcessFunction GetProcessFunction(Variant variant)
+{
+    switch (variant)
+    {
+       #if SIMPLEEQ_X86_KERNELS
+        case Variant::SSE2:   return ProcessSSE2;
+        case Variant::AVX2:   return ProcessAVX2;
+        case Variant::AVX512: return ProcessAVX512;
+       #endif
+       #if SIMPLEEQ_NEON_KERNELS
+        case Variant::NEON:   return ProcessNEON;
+       #endif
+        default:              return ProcessScalar;
+    }
+}
+
+static constexpr int notForced = -1;
+
+static int GetStartupForcedVariant()
+{
+    auto forced = juce::SystemStats::getEnvironmentVariable("SIMPLEEQ_KERNEL", {}).trim();
+
+    for (int i = 0; i < numVariants && forced.isNotEmpty(); i++)
+    {
+        auto variant = static_cast<Variant>(i);
+        if (GetVariantName(variant).removeCharacters("-").equalsIgnoreCase(forced) && IsVariantSupported(variant))
+            return i;
+    }
+
+    return notForced;
+}
+
+//worked out the first time anyone asks, after that it only changes if a variant is forced
+static std::atomic<int>& GetForcedVariantStorage()
+{
+    static std::atomic<int> forced { GetStartupForcedVariant() };
+    return forced;
+}
+
+Variant GetActiveVariant(int numChannels)
+{
+    auto forced = GetForcedVariantStorage().load();
+    return forced != notForced ? static_cast<Variant>(forced) : GetBestVariant(numChannels);
+}
+
+bool ForceVariant(Variant variant)
+{
+    if (!IsVariantSupported(variant))
+        return false;
+
+    GetForcedVariantStorage() = int(variant);
+    return true;
+}
+
+void ClearForcedVariant()
+{
+    GetForcedVariantStorage() = notForced;
+}
+
+}
+
+void BiquadCascade::reset()
+{
+    state.fill(0.f);
+}
+
+void BiquadCascade::beginUpdate()
+{
+    numNewSections = 0;
+}
+
+void BiquadCascade::setSection(int id, int lane, const BiquadCoefficients& sectionCoefficients)
+{
+    jassert(lane >= 0 && lane < maxLanes);
+
+    //a lane of a section we already have, or a new section
+    int slot = 0;
+    while (slot < numNewSections && newIds[(size_t) slot] != id)
+        slot++;
+
+    if (slot == numNewSections)
+    {
+        if (numNewSections == maxSections)
+        {
+            jassertfalse;
+            return;
+        }
+
+        //every lane starts out passing straight through
+        auto* c = coefficients.data() + slot * coefficientStride;
+        std::fill(c, c + coefficientStride, 0.f);
+        std::fill(c, c + maxLanes, 1.f);
+        newIds[(size_t) slot] = id;
+        numNewSections++;
+    }
+
+    auto* c = coefficients.data() + slot * coefficientStride + lane;
+    c[0] = sectionCoefficients.b0;
+    c[maxLanes] = sectionCoefficients.b1;
+    c[2 * maxLanes] = sectionCoefficients.b2;
+    c[3 * maxLanes] = sectionCoefficients.a1;
+    c[4 * maxLanes] = sectionCoefficients.a2;
+}
+
+void BiquadCascade::endUpdate()
+{
+    //nothing moved, which is almost always the case
+    if (numNewSections == numSections && std::equal(newIds.begin(), newIds.begin() + numSections, sectionIds.begin()))
+        return;
+
+    //carry each section's state over from wherever it used to be
+    newState.fill(0.f);
+    for (int slot = 0; slot < numNewSections; slot++)
+    {
+        for (int old = 0; old < numSections; old++)
+        {
+            if (sectionIds[(size_t) old] == newIds[(size_t) slot])
+            {
+                std::copy(state.begin() + old * stateStride, state.begin() + (old + 1) * stateStride,
+                          newState.begin() + slot * stateStride);
+                break;
+            }
+        }
+    }
+
+    std::swap(state, newState);
+    sectionIds = newIds;
+    numSections = numNewSections;
+}
+
+void BiquadCascade::process(juce::dsp::AudioBlock<float>& block, bool encodeMidSide)
+{
+    auto numChannels = juce::jmin((int) block.getNumChannels(), maxLanes);
+    encodeMidSide = encodeMidSide && numChannels > 1;
+    if (numChannels == 0 || (numSections == 0 && !encodeMidSide))
+        return;
+
+    float* channels[maxLanes] {};
+    for (int channel = 0; channel < numChannels; channel++)
+        channels[channel] = block.getChannelPointer((size_t) channel);
+
+    auto process = BiquadKernels::GetProcessFunction(BiquadKernels::GetActiveVariant(numChannels));
+    process(channels, numChannels, (int) block.getNumSamples(), numSections, coefficients.data(), state.data(), encodeMidSide);
+}
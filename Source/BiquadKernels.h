@@ -0,0 +1,99 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadDesign.h"
+
+//biquad cascade kernels compiled for several instruction sets, picked at runtime for the cpu we're on
+//every variant runs the channels side by side in the lanes of one register and the sections one after another,
+//with the same transposed direct form II maths as IIR::Filter. they're all built with floating point contraction off,
+//so the compiler can't fuse a multiply and an add behind our back and they all give the same output
+namespace BiquadKernels
+{
+    enum class Variant
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512,
+        NEON
+    };
+    constexpr int numVariants = 5;
+
+    constexpr int maxLanes = 16;
+    //both cuts at 96db plus the peak take 17
+    constexpr int maxSections = 20;
+
+    //coefficients are [section][b0 b1 b2 a1 a2][lane] and state is [section][z1 z2][lane], maxLanes wide
+    //encodeMidSide turns channels 0/1 from left/right into mid/side as they're read, it needs at least two channels
+    using ProcessFunction = void (*)(float* const* channels, int numChannels, int numSamples,
+                                     int numSections, const float* coefficients, float* state, bool encodeMidSide);
+
+    juce::String GetVariantName(Variant variant);
+
+    //compiled into this build and supported by this cpu
+    bool IsVariantSupported(Variant variant);
+    //how many channels one pass of the variant runs side by side
+    int GetVariantWidth(Variant variant);
+    //the narrowest variant that takes every channel in one pass, since the lanes a narrow block of channels
+    //leaves empty still cost gathers and scatters (and on some cpus a wider register slows the whole core down).
+    //stereo gets sse2 on an avx-512 cpu, more channels than the widest variant holds get the widest
+    Variant GetBestVariant(int numChannels);
+
+    //the variant a cascade with this many channels uses, the best one for it unless one has been forced
+    //the SIMPLEEQ_KERNEL environment variable (scalar, sse2, avx2, avx512, neon) forces one at startup
+    Variant GetActiveVariant(int numChannels);
+    ProcessFunction GetProcessFunction(Variant variant);
+
+    //for testing and benchmarking, every cascade uses this one whatever its channel count
+    //returns false if the variant can't run here
+    bool ForceVariant(Variant variant);
+    void ClearForcedVariant();
+
+    //how far one variant's output is from the scalar kernel's
+    //nullDepthInDb is the level of the difference relative to the signal, -200 when they are identical
+    //magnitudeErrorInDb compares the impulse response against the magnitude worked out from the coefficients
+    struct VariantReport
+    {
+        Variant variant {Variant::Scalar};
+        float maxError {0};
+        double nullDepthInDb {-200.0}, magnitudeErrorInDb {0};
+    };
+
+    //renders an impulse, a sweep and noise through a fixed set of butterworth cuts and bells at this sample rate
+    //with every supported variant, the regression test (Tools/RegressionTest) fails if any of them is off
+    std::vector<VariantReport> CheckVariants(double sampleRate);
+}
+
+//a cascade of biquads with one lane per channel, run by whichever kernel variant is active
+//the sections are rebuilt every time with beginUpdate / setSection / endUpdate,
+//and a section keeps its state as long as its id is still in the cascade
+class BiquadCascade
+{
+public:
+    static constexpr int maxSections = BiquadKernels::maxSections;
+    static constexpr int maxLanes = BiquadKernels::maxLanes;
+
+    void reset();
+
+    void beginUpdate();
+    //sections have to be set in processing order, lanes that never get set for a section pass straight through it
+    void setSection(int id, int lane, const BiquadCoefficients& coefficients);
+    void endUpdate();
+
+    //encodeMidSide turns channels 0/1 from left/right into mid/side on the way in, so the block comes out
+    //as filtered mid/side without a pass of its own
+    void process(juce::dsp::AudioBlock<float>& block, bool encodeMidSide = false);
+
+    int getNumSections() const { return numSections; }
+
+private:
+    static constexpr int coefficientStride = 5 * maxLanes;
+    static constexpr int stateStride = 2 * maxLanes;
+
+    alignas(64) std::array<float, maxSections * coefficientStride> coefficients {};
+    alignas(64) std::array<float, maxSections * stateStride> state {}, newState {};
+    std::array<int, maxSections> sectionIds {}, newIds {};
+    int numSections {0}, numNewSections {0};
+
+    JUCE_LEAK_DETECTOR (BiquadCascade)
+};
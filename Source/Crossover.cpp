@@ -0,0 +1,113 @@
+#include "Crossover.h"
+
+CrossoverSettings getCrossoverSettings(juce::AudioProcessorValueTreeState& apvts)
+{
+    CrossoverSettings settings;
+
+    //"Off", "2 Bands", "3 Bands", "4 Bands"
+    settings.numBands = 1 + int(apvts.getRawParameterValue("Crossover")->load());
+    settings.slope = Slope_LR12 + int(apvts.getRawParameterValue("CrossoverSlope")->load());
+
+    settings.freqs[0] = apvts.getRawParameterValue("CrossoverFreq1")->load();
+    settings.freqs[1] = apvts.getRawParameterValue("CrossoverFreq2")->load();
+    settings.freqs[2] = apvts.getRawParameterValue("CrossoverFreq3")->load();
+
+    //only the splits in use are sorted, so switching bands off doesn't shuffle the ones still there
+    std::sort(settings.freqs.begin(), settings.freqs.begin() + (settings.numBands - 1));
+    return settings;
+}
+
+void Crossover::prepare(double newSampleRate, int newNumChannels)
+{
+    sampleRate = newSampleRate;
+    numChannels = juce::jlimit(1, maxChannels, newNumChannels);
+
+    hasSettings = false;
+    reset();
+}
+
+void Crossover::reset()
+{
+    for (auto& state : states)
+    {
+        for (auto& cut : state.lowPass)
+            cut.reset();
+        for (auto& cut : state.highPass)
+            cut.reset();
+        for (auto& band : state.allpass)
+            for (auto& cut : band)
+                cut.reset();
+    }
+}
+
+void Crossover::setSettings(const CrossoverSettings& newSettings)
+{
+    if (hasSettings && newSettings == settings)
+        return;
+
+    //bands coming back in have stale state
+    if (hasSettings && newSettings.numBands > settings.numBands)
+        reset();
+
+    //the linkwitz-riley rows of the cut tables, the same designs the chain's cuts use
+    auto slope = IsLinkwitzRiley(newSettings.slope) ? newSettings.slope : int(Slope_LR24);
+    for (int split = 0; split < newSettings.numBands - 1; split++)
+    {
+        auto& designed = splits[(size_t) split];
+        auto freq = juce::jlimit(20.0, sampleRate * 0.45, double(newSettings.freqs[(size_t) split]));
+        designed.lowPass.numSections = MakeCutSections(false, sampleRate, freq, slope, designed.lowPass.sections);
+        designed.highPass.numSections = MakeCutSections(true, sampleRate, freq, slope, designed.highPass.sections);
+        designed.allpass.numSections = MakeLinkwitzRileyAllpassSections(sampleRate, freq, slope, designed.allpass.sections);
+    }
+    highSign = IsLinkwitzRileyHighInverted(slope) ? -1.f : 1.f;
+
+    settings = newSettings;
+    hasSettings = true;
+}
+
+void Crossover::process(const juce::dsp::AudioBlock<float>& input, const std::array<juce::dsp::AudioBlock<float>, maxBands>& bands)
+{
+    if (!isActive())
+        return;
+
+    auto numBands = settings.numBands;
+    auto numSplits = numBands - 1;
+    auto numSamples = input.getNumSamples();
+    auto channels = juce::jmin((int) input.getNumChannels(), numChannels);
+
+    for (int channel = 0; channel < channels; channel++)
+    {
+        auto& state = states[(size_t) channel];
+        const auto* in = input.getChannelPointer((size_t) channel);
+
+        //nullptr for a band that isn't connected or doesn't have this channel
+        std::array<float*, maxBands> out {};
+        for (int band = 0; band < numBands; band++)
+        {
+            const auto& block = bands[(size_t) band];
+            if ((size_t) channel < block.getNumChannels() && block.getNumSamples() >= numSamples)
+                out[(size_t) band] = block.getChannelPointer((size_t) channel);
+        }
+
+        for (size_t i = 0; i < numSamples; i++)
+        {
+            //the rest of the signal walks up the splits, each one peeling off the band below it
+            auto x = in[i];
+            for (int split = 0; split < numSplits; split++)
+            {
+                const auto& designed = splits[(size_t) split];
+                auto low = TickCutFilter(designed.lowPass, state.lowPass[(size_t) split], x);
+                x = highSign * TickCutFilter(designed.highPass, state.highPass[(size_t) split], x);
+
+                for (int above = split + 1; above < numSplits; above++)
+                    low = TickCutFilter(splits[(size_t) above].allpass, state.allpass[(size_t) split][(size_t) above], low);
+
+                if (auto* destination = out[(size_t) split])
+                    destination[i] = low;
+            }
+
+            if (auto* destination = out[(size_t) numSplits])
+                destination[i] = x;
+        }
+    }
+}
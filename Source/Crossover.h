@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CutFilter.h"
+
+//what the crossover is set to, numBands 1 means it's off
+struct CrossoverSettings
+{
+    static constexpr int maxBands = 4;
+
+    int numBands {1};
+    std::array<float, maxBands - 1> freqs {};
+    int slope {Slope_LR24};
+};
+
+inline bool operator==(const CrossoverSettings& a, const CrossoverSettings& b)
+{
+    return a.numBands == b.numBands && a.freqs == b.freqs && a.slope == b.slope;
+}
+
+inline bool operator!=(const CrossoverSettings& a, const CrossoverSettings& b)
+{
+    return !(a == b);
+}
+
+//reads the crossover parameters, the frequencies come back sorted so the bands never overlap
+CrossoverSettings getCrossoverSettings(juce::AudioProcessorValueTreeState& apvts);
+
+//splits the eq'd signal into 2-4 linkwitz-riley bands for multiband processing further down the line
+//every split is a lowcut and highcut at the same frequency, and the bands below a split go through the allpass
+//the split sums to, so all the bands have the same phase and add back up to the input (allpassed)
+class Crossover
+{
+public:
+    static constexpr int maxBands = CrossoverSettings::maxBands;
+    static constexpr int maxChannels = 2;
+
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+
+    //only redesigns when something has changed, the filters keep their state through it
+    void setSettings(const CrossoverSettings& settings);
+    bool isActive() const { return settings.numBands > 1; }
+
+    //one pass over the input per channel with every split and allpass worked out sample by sample,
+    //each band written straight into its block (the host's bus buffers, nothing is copied)
+    //a band block with fewer channels only gets those, one with none is still split so the others stay in phase
+    void process(const juce::dsp::AudioBlock<float>& input, const std::array<juce::dsp::AudioBlock<float>, maxBands>& bands);
+
+private:
+    struct Split
+    {
+        CutSections<float> lowPass, highPass, allpass;
+    };
+
+    struct ChannelState
+    {
+        std::array<CutState<float>, maxBands - 1> lowPass, highPass;
+        //[band][split], a band goes through the allpass of every split above it
+        std::array<std::array<CutState<float>, maxBands - 1>, maxBands - 1> allpass;
+    };
+
+    double sampleRate {44100.0};
+    int numChannels {maxChannels};
+    bool hasSettings {false};
+    CrossoverSettings settings;
+
+    std::array<Split, maxBands - 1> splits;
+    //-1 for LR 12, where the highcut has to be flipped for the bands to sum flat
+    float highSign {1.f};
+    std::array<ChannelState, maxChannels> states;
+
+    JUCE_LEAK_DETECTOR (Crossover)
+};
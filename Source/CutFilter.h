@@ -0,0 +1,291 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadDesign.h"
+
+//enum for hi/low pass slope options
+//these are the choice parameters' indices, so the original four keep theirs and every newer slope is added at the end
+//(the editor shows them in order of steepness). the linkwitz-riley ones are a butterworth of half the order run twice,
+//-6db at the cutoff instead of -3db, so a lowcut and a highcut at the same frequency sum back to flat
+enum Slope
+{
+    Slope_12,
+    Slope_24,
+    Slope_36,
+    Slope_48,
+    Slope_6,
+    Slope_18,
+    Slope_60,
+    Slope_72,
+    Slope_96,
+    Slope_LR12,
+    Slope_LR24,
+    Slope_LR48
+};
+constexpr int numSlopes = Slope_LR48 + 1;
+
+//96db is a 16th order butterworth, 8 sections
+constexpr int maxCutSections = 8;
+
+//how a slope is built: its order, how many biquads that takes and the Q of each one
+//a Q of 0 marks the first order section an odd order needs (a biquad with b2 = a2 = 0)
+struct CutSectionTable
+{
+    int order {0}, numSections {0};
+    std::array<double, maxCutSections> qualities {};
+};
+
+namespace CutTables
+{
+    //std::cos isn't constexpr, a taylor series this long is exact to double precision for angles up to pi / 2
+    constexpr double Cos(double x)
+    {
+        double term = 1.0, sum = 1.0;
+        for (int i = 1; i < 16; i++)
+        {
+            term *= -x * x / double((2 * i - 1) * (2 * i));
+            sum += term;
+        }
+        return sum;
+    }
+
+    //the poles of a butterworth sit evenly around the left half of the unit circle
+    //each conjugate pair is a section with Q = 1 / (2 cos(angle)), an odd order has one real pole left over
+    //the even orders come out in the same order as FilterDesign's high order butterworth designs
+    constexpr CutSectionTable MakeButterworth(int order)
+    {
+        CutSectionTable table;
+        table.order = order;
+        table.numSections = (order + 1) / 2;
+
+        int section = 0;
+        if (order % 2 == 1)
+            table.qualities[(size_t) section++] = 0.0;
+
+        for (int i = 0; i < order / 2; i++)
+        {
+            auto angle = order % 2 == 0 ? double(2 * i + 1) * juce::MathConstants<double>::pi / double(2 * order)
+                                        : double(i + 1) * juce::MathConstants<double>::pi / double(order);
+            table.qualities[(size_t) section++] = 1.0 / (2.0 * Cos(angle));
+        }
+        return table;
+    }
+
+    //every pole of the half order butterworth twice, a doubled real pole is a single section with Q = 0.5
+    constexpr CutSectionTable MakeLinkwitzRiley(int order)
+    {
+        auto half = MakeButterworth(order / 2);
+
+        CutSectionTable table;
+        table.order = order;
+
+        for (int i = 0; i < half.numSections; i++)
+        {
+            auto quality = half.qualities[(size_t) i];
+            if (quality == 0.0)
+            {
+                table.qualities[(size_t) table.numSections++] = 0.5;
+            }
+            else
+            {
+                table.qualities[(size_t) table.numSections++] = quality;
+                table.qualities[(size_t) table.numSections++] = quality;
+            }
+        }
+        return table;
+    }
+
+    //in the same order as the Slope enum
+    constexpr std::array<CutSectionTable, numSlopes> tables
+    {{
+        MakeButterworth(2), MakeButterworth(4), MakeButterworth(6), MakeButterworth(8),
+        MakeButterworth(1), MakeButterworth(3), MakeButterworth(10), MakeButterworth(12), MakeButterworth(16),
+        MakeLinkwitzRiley(2), MakeLinkwitzRiley(4), MakeLinkwitzRiley(8)
+    }};
+
+    static_assert(tables[Slope_96].numSections == maxCutSections, "the steepest slope sets maxCutSections");
+
+    //the half order butterworths the linkwitz-riley slopes are built from, in the same order
+    constexpr std::array<CutSectionTable, 3> linkwitzRileyHalves {{ MakeButterworth(1), MakeButterworth(2), MakeButterworth(4) }};
+}
+
+inline const CutSectionTable& GetCutSectionTable(int slope)
+{
+    return CutTables::tables[(size_t) juce::jlimit(0, numSlopes - 1, slope)];
+}
+
+inline int GetNumCutSections(int slope)
+{
+    return GetCutSectionTable(slope).numSections;
+}
+
+//the sections of a butterworth or linkwitz-riley cut, returns how many the slope uses
+//the Qs come from the tables above, so the only maths left at runtime is the one tan() that warps the frequency,
+//then every section is the bilinear transform of its analog prototype with a handful of multiplies
+//(the same curves MakeHighPassBiquad / MakeLowPassBiquad give for the same Q), and nothing is allocated
+template<typename SampleType = float>
+inline int MakeCutSections(bool isLowCut, double sampleRate, double freq, int slope,
+                           std::array<BiquadCoefficientsOf<SampleType>, maxCutSections>& sections)
+{
+    const auto& table = GetCutSectionTable(slope);
+    auto k = std::tan(juce::MathConstants<double>::pi * freq / sampleRate);
+    auto kSquared = k * k;
+
+    for (int i = 0; i < table.numSections; i++)
+    {
+        auto quality = table.qualities[(size_t) i];
+        auto& section = sections[(size_t) i];
+
+        if (quality == 0.0)
+        {
+            section = isLowCut ? MakeNormalisedBiquad<SampleType>(1.0, -1.0, 0.0, 1.0 + k, k - 1.0, 0.0)
+                               : MakeNormalisedBiquad<SampleType>(k, k, 0.0, 1.0 + k, k - 1.0, 0.0);
+            continue;
+        }
+
+        auto a0 = 1.0 + k / quality + kSquared;
+        auto a1 = 2.0 * (kSquared - 1.0);
+        auto a2 = 1.0 - k / quality + kSquared;
+        section = isLowCut ? MakeNormalisedBiquad<SampleType>(1.0, -2.0, 1.0, a0, a1, a2)
+                           : MakeNormalisedBiquad<SampleType>(kSquared, 2.0 * kSquared, kSquared, a0, a1, a2);
+    }
+
+    return table.numSections;
+}
+
+inline bool IsLinkwitzRiley(int slope)
+{
+    return slope >= Slope_LR12 && slope <= Slope_LR48;
+}
+
+//a linkwitz-riley lowcut and highcut at the same frequency sum to an allpass, but when the half order is odd (LR 12)
+//only with the highcut's polarity flipped
+inline bool IsLinkwitzRileyHighInverted(int slope)
+{
+    return (GetCutSectionTable(slope).order / 2) % 2 == 1;
+}
+
+//that allpass: the half order butterworth's poles once each, with the zeros mirrored across the unit circle
+//running it over a band that didn't go through a crossover lines its phase up with the bands that did
+template<typename SampleType = float>
+inline int MakeLinkwitzRileyAllpassSections(double sampleRate, double freq, int slope,
+                                           std::array<BiquadCoefficientsOf<SampleType>, maxCutSections>& sections)
+{
+    jassert(IsLinkwitzRiley(slope));
+    const auto& table = CutTables::linkwitzRileyHalves[(size_t) juce::jlimit(0, 2, slope - Slope_LR12)];
+    auto k = std::tan(juce::MathConstants<double>::pi * freq / sampleRate);
+    auto kSquared = k * k;
+
+    for (int i = 0; i < table.numSections; i++)
+    {
+        auto quality = table.qualities[(size_t) i];
+        auto& section = sections[(size_t) i];
+
+        if (quality == 0.0)
+        {
+            section = MakeNormalisedBiquad<SampleType>(k - 1.0, k + 1.0, 0.0, k + 1.0, k - 1.0, 0.0);
+            continue;
+        }
+
+        auto a0 = 1.0 + k / quality + kSquared;
+        auto a1 = 2.0 * (kSquared - 1.0);
+        auto a2 = 1.0 - k / quality + kSquared;
+        section = MakeNormalisedBiquad<SampleType>(a2, a1, a0, a0, a1, a2);
+    }
+
+    return table.numSections;
+}
+
+//the designed sections of one cut and how many of them run, 0 when it's bypassed
+template<typename SampleType>
+struct CutSections
+{
+    std::array<BiquadCoefficientsOf<SampleType>, maxCutSections> sections {};
+    int numSections {0};
+};
+
+template<typename SampleType>
+struct CutState
+{
+    std::array<SampleType, maxCutSections> s1 {}, s2 {};
+
+    void reset() noexcept
+    {
+        s1.fill(SampleType(0));
+        s2.fill(SampleType(0));
+    }
+};
+
+//one sample through every section, for code that has to interleave several cuts sample by sample
+template<typename SampleType>
+inline SampleType TickCutFilter(const CutSections<SampleType>& cut, CutState<SampleType>& state, SampleType x) noexcept
+{
+    for (size_t k = 0; k < (size_t) cut.numSections; k++)
+    {
+        const auto& c = cut.sections[k];
+        auto out = x * c.b0 + state.s1[k];
+        state.s1[k] = (x * c.b1) - (out * c.a1) + state.s2[k];
+        state.s2[k] = (x * c.b2) - (out * c.a2);
+        x = out;
+    }
+    return x;
+}
+
+//a cut with its section count fixed at compile time, so every slope gets its own loop:
+//the loop over the sections unrolls and the whole cascade's state stays in registers from one sample to the next
+//same transposed direct form II as IIR::Filter, so the output matches running the sections one after another
+template<int NumSections>
+struct CutFilter
+{
+    static_assert(NumSections > 0 && NumSections <= maxCutSections, "a cut has 1 to maxCutSections sections");
+
+    template<typename SampleType>
+    static void process(const CutSections<SampleType>& cut, CutState<SampleType>& state, SampleType* samples, size_t numSamples) noexcept
+    {
+        std::array<BiquadCoefficientsOf<SampleType>, NumSections> c;
+        std::array<SampleType, NumSections> s1, s2;
+        for (size_t k = 0; k < NumSections; k++)
+        {
+            c[k] = cut.sections[k];
+            s1[k] = state.s1[k];
+            s2[k] = state.s2[k];
+        }
+
+        for (size_t i = 0; i < numSamples; i++)
+        {
+            auto x = samples[i];
+            for (size_t k = 0; k < NumSections; k++)
+            {
+                auto out = x * c[k].b0 + s1[k];
+                s1[k] = (x * c[k].b1) - (out * c[k].a1) + s2[k];
+                s2[k] = (x * c[k].b2) - (out * c[k].a2);
+                x = out;
+            }
+            samples[i] = x;
+        }
+
+        for (size_t k = 0; k < NumSections; k++)
+        {
+            state.s1[k] = s1[k];
+            state.s2[k] = s2[k];
+        }
+    }
+};
+
+//picks the specialised loop for however many sections the cut is using right now
+template<typename SampleType>
+void ProcessCutFilter(const CutSections<SampleType>& cut, CutState<SampleType>& state, SampleType* samples, size_t numSamples) noexcept
+{
+    switch (cut.numSections)
+    {
+        case 1: CutFilter<1>::process(cut, state, samples, numSamples); break;
+        case 2: CutFilter<2>::process(cut, state, samples, numSamples); break;
+        case 3: CutFilter<3>::process(cut, state, samples, numSamples); break;
+        case 4: CutFilter<4>::process(cut, state, samples, numSamples); break;
+        case 5: CutFilter<5>::process(cut, state, samples, numSamples); break;
+        case 6: CutFilter<6>::process(cut, state, samples, numSamples); break;
+        case 7: CutFilter<7>::process(cut, state, samples, numSamples); break;
+        case 8: CutFilter<8>::process(cut, state, samples, numSamples); break;
+        default: break;
+    }
+}
@@ -0,0 +1,96 @@
+#include "DynamicBand.h"
+
+void DynamicBand::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    //force the filter and the time constants to be worked out again for the new rate
+    detectorFreq = 0;
+    auto dynamicSettings = settings;
+    settings = {};
+    settings.attackMs = -1.f;
+    setDynamics(dynamicSettings);
+
+    reset();
+}
+
+void DynamicBand::reset()
+{
+    z1.fill(0.f);
+    z2.fill(0.f);
+    envelope = 0.f;
+}
+
+void DynamicBand::setDetector(float freq, float quality)
+{
+    if (freq == detectorFreq && quality == detectorQuality)
+        return;
+
+    detectorFreq = freq;
+    detectorQuality = quality;
+    detectorFilter = MakeBandPassBiquad(sampleRate, juce::jmin(double(freq), sampleRate * 0.49), quality);
+}
+
+void DynamicBand::setDynamics(const DynamicSettings& dynamicSettings)
+{
+    if (dynamicSettings == settings)
+        return;
+
+    //one pole time constants at the control rate rather than the sample rate
+    auto controlRate = sampleRate / controlInterval;
+    auto timeConstant = [controlRate](float ms)
+    {
+        return float(std::exp(-1.0 / (juce::jmax(0.001, double(ms) * 0.001) * controlRate)));
+    };
+
+    if (dynamicSettings.attackMs != settings.attackMs)
+        attackCoefficient = timeConstant(dynamicSettings.attackMs);
+    if (dynamicSettings.releaseMs != settings.releaseMs)
+        releaseCoefficient = timeConstant(dynamicSettings.releaseMs);
+
+    settings = dynamicSettings;
+}
+
+float DynamicBand::process(const juce::dsp::AudioBlock<const float>& detector, bool encodeMidSide)
+{
+    auto numChannels = juce::jmin((int) detector.getNumChannels(), maxChannels);
+    auto numSamples = (int) detector.getNumSamples();
+    jassert(numSamples <= controlInterval);
+    encodeMidSide = encodeMidSide && numChannels > 1;
+    auto* left = detector.getChannelPointer(0);
+    auto* right = encodeMidSide ? detector.getChannelPointer(1) : left;
+
+    //band pass the detector signal and find its peak over this control period
+    float peak = 0.f;
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        auto* samples = detector.getChannelPointer((size_t) channel);
+        auto encode = encodeMidSide && channel < 2;
+        auto s1 = z1[(size_t) channel];
+        auto s2 = z2[(size_t) channel];
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            auto in = samples[i];
+            if (encode)
+                in = channel == 0 ? (left[i] + right[i]) * .5f : (left[i] - right[i]) * .5f;
+            auto out = detectorFilter.b0 * in + s1;
+            s1 = detectorFilter.b1 * in - detectorFilter.a1 * out + s2;
+            s2 = detectorFilter.b2 * in - detectorFilter.a2 * out;
+            peak = juce::jmax(peak, std::abs(out));
+        }
+
+        z1[(size_t) channel] = s1;
+        z2[(size_t) channel] = s2;
+    }
+
+    //attack/release envelope, once per control period
+    auto coefficient = peak > envelope ? attackCoefficient : releaseCoefficient;
+    envelope = peak + coefficient * (envelope - peak);
+
+    auto over = juce::Decibels::gainToDecibels(envelope) - settings.thresholdInDb;
+    if (over <= 0.f)
+        return 0.f;
+
+    return -over * (1.f - 1.f / juce::jmax(1.f, settings.ratio));
+}
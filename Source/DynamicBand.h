@@ -0,0 +1,56 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadDesign.h"
+
+//settings for turning a band into a dynamic band
+//above the threshold the band's gain is pulled down by (level - threshold) * (1 - 1 / ratio)
+struct DynamicSettings
+{
+    bool enabled {false}, useSidechain {false};
+    float thresholdInDb {-20.f}, ratio {2.f}, attackMs {10.f}, releaseMs {100.f};
+};
+
+inline bool operator==(const DynamicSettings& a, const DynamicSettings& b)
+{
+    return a.enabled == b.enabled && a.useSidechain == b.useSidechain && a.thresholdInDb == b.thresholdInDb
+        && a.ratio == b.ratio && a.attackMs == b.attackMs && a.releaseMs == b.releaseMs;
+}
+
+inline bool operator!=(const DynamicSettings& a, const DynamicSettings& b)
+{
+    return !(a == b);
+}
+
+//band limited envelope follower that drives a band's gain
+//the detector filter runs every sample but the envelope and gain only update once per control period,
+//so the band only needs a new set of coefficients every controlInterval samples
+class DynamicBand
+{
+public:
+    static constexpr int controlInterval = 32;
+    static constexpr int maxChannels = 2;
+
+    void prepare(double sampleRate);
+    void reset();
+
+    //the detector listens around the band's own frequency
+    void setDetector(float freq, float quality);
+    void setDynamics(const DynamicSettings& dynamicSettings);
+
+    //analyses up to controlInterval samples of the detector signal and returns the band's gain change in db (<= 0)
+    //encodeMidSide listens to channels 0/1 as mid/side, for a left/right input the eq is about to encode
+    float process(const juce::dsp::AudioBlock<const float>& detector, bool encodeMidSide = false);
+
+private:
+    double sampleRate {44100.0};
+
+    BiquadCoefficients detectorFilter;
+    std::array<float, maxChannels> z1 {}, z2 {};
+    float detectorFreq {0}, detectorQuality {0};
+
+    DynamicSettings settings;
+    float envelope {0}, attackCoefficient {0}, releaseCoefficient {0};
+
+    JUCE_LEAK_DETECTOR (DynamicBand)
+};
@@ -0,0 +1,362 @@
+#include "LinearPhaseEQ.h"
+#include "MultiBandEQ.h"
+#include "Timeline.h"
+
+LinearPhaseEQ::LinearPhaseEQ()
+{
+}
+
+LinearPhaseEQ::~LinearPhaseEQ()
+{
+    designTrigger.stop();
+}
+
+void LinearPhaseEQ::prepare(double newSampleRate, int numChannels, int newFirLength, int newPartitionSize)
+{
+    //the design job uses the buffers we are about to resize so it has to finish first
+    designTrigger.stop();
+
+    jassert(juce::isPowerOfTwo(newFirLength) && juce::isPowerOfTwo(newPartitionSize));
+    jassert(newPartitionSize <= newFirLength);
+
+    sampleRate = newSampleRate;
+    firLength = newFirLength;
+    partitionSize = newPartitionSize;
+    //real fft of size 2 * partitionSize gives partitionSize + 1 unique bins
+    numBins = partitionSize + 1;
+    numPartitions = firLength / partitionSize;
+    //the kernel is centred on sample firLength / 2 - 1, and the input fifo adds one partition
+    latency = firLength / 2 - 1 + partitionSize;
+
+    auto partitionOrder = juce::roundToInt(std::log2(2 * partitionSize));
+    auto designOrder = juce::roundToInt(std::log2(firLength));
+    partitionFft = std::make_unique<juce::dsp::FFT>(partitionOrder);
+    designPartitionFft = std::make_unique<juce::dsp::FFT>(partitionOrder);
+    designFft = std::make_unique<juce::dsp::FFT>(designOrder);
+
+    //juce's real only transforms need twice the fft size to work in
+    fftBuffer.assign(4 * partitionSize, 0.f);
+    fadeBuffer.assign(4 * partitionSize, 0.f);
+    partitionBuffer.assign(4 * partitionSize, 0.f);
+    designBuffer.assign(2 * firLength, 0.f);
+    impulseBuffer.assign(firLength, 0.f);
+
+    //symmetric window one sample shorter than the fir so it has a centre sample
+    designWindow.assign(firLength, 0.f);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(designWindow.data(), firLength - 1, juce::dsp::WindowingFunction<float>::blackman, false);
+
+    auto kernelSize = (size_t) (numPartitions * numBins);
+    currentKernel.assign(kernelSize, {});
+    nextKernel.assign(kernelSize, {});
+    pendingKernel.assign(kernelSize, {});
+
+    channels.resize(numChannels);
+    for (auto& state : channels)
+    {
+        state.inputFifo.assign(partitionSize, 0.f);
+        state.outputFifo.assign(partitionSize, 0.f);
+        state.previousInput.assign(partitionSize, 0.f);
+        state.delayLine.assign(kernelSize, {});
+        state.delayLineIndex = 0;
+    }
+
+    fifoPosition = 0;
+    pendingReady = false;
+    redesignRequested = false;
+    hasRequest = false;
+    fading = false;
+    hasKernel = false;
+    requestedGeneration = designGeneration = pendingGeneration = nextGeneration = playingGeneration = 0;
+
+    designTrigger.start();
+}
+
+void LinearPhaseEQ::reset()
+{
+    //clears the audio history but keeps the current kernel
+    for (auto& state : channels)
+    {
+        std::fill(state.inputFifo.begin(), state.inputFifo.end(), 0.f);
+        std::fill(state.outputFifo.begin(), state.outputFifo.end(), 0.f);
+        std::fill(state.previousInput.begin(), state.previousInput.end(), 0.f);
+        std::fill(state.delayLine.begin(), state.delayLine.end(), Complex{});
+        state.delayLineIndex = 0;
+    }
+
+    fifoPosition = 0;
+}
+
+size_t LinearPhaseEQ::getMemoryUsageInBytes() const
+{
+    auto bytes = sizeof(*this) + GetVectorBytes(channels);
+    for (const auto& state : channels)
+        bytes += GetVectorBytes(state.inputFifo) + GetVectorBytes(state.outputFifo)
+               + GetVectorBytes(state.previousInput) + GetVectorBytes(state.delayLine);
+
+    bytes += GetVectorBytes(currentKernel) + GetVectorBytes(nextKernel) + GetVectorBytes(pendingKernel);
+    bytes += GetVectorBytes(fftBuffer) + GetVectorBytes(fadeBuffer);
+    bytes += GetVectorBytes(designBuffer) + GetVectorBytes(designWindow) + GetVectorBytes(impulseBuffer) + GetVectorBytes(partitionBuffer);
+    return bytes;
+}
+
+void LinearPhaseEQ::setChainSettings(const ChainSettings& chainSettings)
+{
+    if (hasRequest && chainSettings == lastRequestedSettings)
+        return;
+
+    //if the design job is copying the settings right now we just try again next block
+    juce::SpinLock::ScopedTryLockType lock(settingsLock);
+    if (!lock.isLocked())
+        return;
+
+    requestedSettings = chainSettings;
+    lastRequestedSettings = chainSettings;
+    requestedGeneration++;
+    hasRequest = true;
+    redesignRequested = true;
+    designTrigger.fire();
+}
+
+void LinearPhaseEQ::process(juce::dsp::AudioBlock<float>& block, MidSide midSide)
+{
+    auto numSamples = (int) block.getNumSamples();
+    if (block.getNumChannels() < 2)
+        midSide = MidSide::off;
+    auto numChannels = juce::jmin(midSide != MidSide::off ? 1 : (int) block.getNumChannels(), (int) channels.size());
+    int position = 0;
+
+    while (position < numSamples)
+    {
+        //move samples in and out of the fifos until we reach the end of the block or a partition boundary
+        auto numToCopy = juce::jmin(numSamples - position, partitionSize - fifoPosition);
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            auto& state = channels[(size_t) channel];
+            auto* input = state.inputFifo.data() + fifoPosition;
+            auto* output = state.outputFifo.data() + fifoPosition;
+
+            if (midSide == MidSide::encodeMid)
+            {
+                auto* left = block.getChannelPointer(0) + position;
+                auto* right = block.getChannelPointer(1) + position;
+                for (int i = 0; i < numToCopy; i++)
+                {
+                    auto l = left[i], r = right[i];
+                    input[i] = (l + r) * .5f;
+                    right[i] = (l - r) * .5f;
+                    left[i] = output[i];
+                }
+            }
+            else if (midSide == MidSide::decodeSide)
+            {
+                auto* mid = block.getChannelPointer(0) + position;
+                auto* side = block.getChannelPointer(1) + position;
+                for (int i = 0; i < numToCopy; i++)
+                {
+                    input[i] = side[i];
+                    auto m = mid[i], s = output[i];
+                    mid[i] = m + s;
+                    side[i] = m - s;
+                }
+            }
+            else
+            {
+                auto* samples = block.getChannelPointer((size_t) channel) + position;
+                std::copy(samples, samples + numToCopy, input);
+                std::copy(output, output + numToCopy, samples);
+            }
+        }
+
+        fifoPosition += numToCopy;
+        position += numToCopy;
+
+        if (fifoPosition < partitionSize)
+            continue;
+
+        fifoPosition = 0;
+
+        //a new kernel can only be picked up on a partition boundary, and only once the last fade is done
+        if (!fading && pendingReady.load(std::memory_order_acquire))
+        {
+            std::swap(nextKernel, pendingKernel);
+            nextGeneration = pendingGeneration;
+            pendingReady.store(false, std::memory_order_release);
+
+            //the design job gave up on anything newer while the pending kernel was full
+            if (redesignRequested.load())
+                designTrigger.fire();
+
+            if (hasKernel)
+            {
+                fading = true;
+            }
+            else
+            {
+                //nothing to fade from yet (we have been outputting silence)
+                std::swap(currentKernel, nextKernel);
+                playingGeneration = nextGeneration;
+                hasKernel = true;
+            }
+        }
+
+        for (int channel = 0; channel < numChannels; channel++)
+            ProcessPartition(channels[(size_t) channel]);
+
+        if (fading)
+        {
+            std::swap(currentKernel, nextKernel);
+            playingGeneration = nextGeneration;
+            fading = false;
+        }
+    }
+}
+
+void LinearPhaseEQ::ProcessPartition(ChannelState& state)
+{
+    //overlap-save: transform the last two partitions of input, keep the second half of the result
+    std::fill(fftBuffer.begin(), fftBuffer.end(), 0.f);
+    std::copy(state.previousInput.begin(), state.previousInput.end(), fftBuffer.begin());
+    std::copy(state.inputFifo.begin(), state.inputFifo.end(), fftBuffer.begin() + partitionSize);
+    std::copy(state.inputFifo.begin(), state.inputFifo.end(), state.previousInput.begin());
+
+    partitionFft->performRealOnlyForwardTransform(fftBuffer.data(), true);
+
+    //the newest spectrum goes into the delay line
+    auto* spectrum = reinterpret_cast<const Complex*>(fftBuffer.data());
+    std::copy(spectrum, spectrum + numBins, state.delayLine.data() + state.delayLineIndex * numBins);
+
+    Accumulate(state, currentKernel, fftBuffer.data());
+    partitionFft->performRealOnlyInverseTransform(fftBuffer.data());
+    auto* output = fftBuffer.data() + partitionSize;
+
+    if (fading)
+    {
+        //run the new kernel over the same input and fade to it across this partition
+        Accumulate(state, nextKernel, fadeBuffer.data());
+        partitionFft->performRealOnlyInverseTransform(fadeBuffer.data());
+        auto* fadeOutput = fadeBuffer.data() + partitionSize;
+
+        for (int i = 0; i < partitionSize; i++)
+        {
+            auto gain = float(i + 1) / float(partitionSize);
+            state.outputFifo[(size_t) i] = output[i] + gain * (fadeOutput[i] - output[i]);
+        }
+    }
+    else
+    {
+        std::copy(output, output + partitionSize, state.outputFifo.begin());
+    }
+
+    state.delayLineIndex = (state.delayLineIndex + 1) % numPartitions;
+}
+
+void LinearPhaseEQ::Accumulate(const ChannelState& state, const KernelSpectrum& kernel, float* destination)
+{
+    //multiply every delayed input spectrum with its kernel partition and sum them up
+    //the newest input lines up with partition 0, the one before with partition 1 etc.
+    auto* sum = reinterpret_cast<Complex*>(destination);
+    std::fill(sum, sum + numBins, Complex{});
+
+    for (int partition = 0; partition < numPartitions; partition++)
+    {
+        auto slot = (state.delayLineIndex - partition + numPartitions) % numPartitions;
+        auto* input = state.delayLine.data() + slot * numBins;
+        auto* kernelPartition = kernel.data() + partition * numBins;
+
+        for (int bin = 0; bin < numBins; bin++)
+            sum[bin] += input[bin] * kernelPartition[bin];
+    }
+}
+
+void LinearPhaseEQ::Design()
+{
+    SIMPLEEQ_TIMELINE_SCOPE("FIR design");
+    //we can only write the pending kernel once the audio thread has taken the last one, it fires us again when it has
+    //a design that's started always finishes, even if newer settings come in while it runs (under automation they
+    //always do, and giving up would mean never hearing anything). however many requests arrive meanwhile only leave
+    //redesignRequested set, so they come out as one follow-up design from the latest settings
+    while (redesignRequested.load() && !pendingReady.load(std::memory_order_acquire))
+    {
+        ChainSettings chainSettings;
+        {
+            const juce::SpinLock::ScopedLockType lock(settingsLock);
+            chainSettings = requestedSettings;
+            designGeneration = requestedGeneration;
+            redesignRequested = false;
+        }
+
+        DesignImpulse(chainSettings, impulseBuffer);
+        TransformKernel(impulseBuffer, pendingKernel);
+        pendingGeneration = designGeneration;
+        pendingReady.store(true, std::memory_order_release);
+    }
+}
+
+void LinearPhaseEQ::DesignImpulse(const ChainSettings& chainSettings, std::vector<float>& impulse)
+{
+    //we use the exact same filter designs as the minimum phase chain so both modes have the same curve
+    auto peak = MakeBellBiquad(sampleRate, chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDb);
+    std::array<BiquadCoefficients, maxCutSections> lowCutSections, highCutSections;
+    auto numLowCutSections = MakeLowCutSections(chainSettings, sampleRate, lowCutSections);
+    auto numHighCutSections = MakeHighCutSections(chainSettings, sampleRate, highCutSections);
+    
+    //plus every section of the extra bands
+    std::vector<BiquadCoefficients> bandSections;
+    std::array<BiquadCoefficients, maxSectionsPerBand> sections;
+    for (const auto& band : chainSettings.bands)
+    {
+        auto numSections = MakeBandSections(band, sampleRate, sections);
+        bandSections.insert(bandSections.end(), sections.begin(), sections.begin() + numSections);
+    }
+
+    //fill a zero phase spectrum with the magnitude of the whole chain at each bin
+    std::fill(designBuffer.begin(), designBuffer.end(), 0.f);
+    for (int bin = 0; bin <= firLength / 2; bin++)
+    {
+        auto freq = double(bin) * sampleRate / double(firLength);
+        double mag = 1.0;
+
+        if (!chainSettings.peakBypassed)
+            mag *= GetBiquadMagnitude(peak, freq, sampleRate);
+
+        if (!chainSettings.lowCutBypassed)
+            for (int i = 0; i < numLowCutSections; i++)
+                mag *= GetBiquadMagnitude(lowCutSections[(size_t) i], freq, sampleRate);
+
+        if (!chainSettings.highCutBypassed)
+            for (int i = 0; i < numHighCutSections; i++)
+                mag *= GetBiquadMagnitude(highCutSections[(size_t) i], freq, sampleRate);
+
+        for (const auto& section : bandSections)
+            mag *= GetBiquadMagnitude(section, freq, sampleRate);
+
+        designBuffer[(size_t) (2 * bin)] = float(mag);
+    }
+
+    //back to the time domain gives a symmetric impulse centred on sample 0
+    designFft->performRealOnlyInverseTransform(designBuffer.data());
+
+    //rotate it so the centre lands on firLength / 2 - 1 and window it
+    auto centre = firLength / 2 - 1;
+    for (int i = 0; i < firLength - 1; i++)
+        impulse[(size_t) i] = designBuffer[(size_t) ((i - centre + firLength) % firLength)] * designWindow[(size_t) i];
+
+    impulse[(size_t) (firLength - 1)] = 0.f;
+}
+
+void LinearPhaseEQ::TransformKernel(const std::vector<float>& impulse, KernelSpectrum& destination)
+{
+    //each partition of the impulse is zero padded to 2 * partitionSize and transformed
+    for (int partition = 0; partition < numPartitions; partition++)
+    {
+        std::fill(partitionBuffer.begin(), partitionBuffer.end(), 0.f);
+        auto start = impulse.begin() + partition * partitionSize;
+        std::copy(start, start + partitionSize, partitionBuffer.begin());
+
+        designPartitionFft->performRealOnlyForwardTransform(partitionBuffer.data(), true);
+
+        auto* spectrum = reinterpret_cast<const Complex*>(partitionBuffer.data());
+        std::copy(spectrum, spectrum + numBins, destination.begin() + partition * numBins);
+    }
+}
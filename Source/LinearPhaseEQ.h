@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "WorkerPool.h"
+
+//linear phase version of the eq curve
+//the magnitude response of the current ChainSettings is turned into a symmetric FIR kernel on the shared worker pool
+//and the kernel is run with a uniformly partitioned overlap-save FFT convolution
+//new kernels are crossfaded in over one partition so parameter changes don't click
+class LinearPhaseEQ
+{
+public:
+    LinearPhaseEQ();
+    ~LinearPhaseEQ();
+
+    //firLength and partitionSize must be powers of 2
+    //longer firs = better low frequency resolution but more latency and cpu
+    //smaller partitions = less latency but more fft work per sample
+    void prepare(double sampleRate, int numChannels, int firLength, int partitionSize);
+    void reset();
+
+    //called from the audio thread, never blocks
+    //if the settings differ from the last design the kernel is redesigned in the background
+    void setChainSettings(const ChainSettings& chainSettings);
+
+    //message thread, where the designs go in the pool's queue
+    void setWorkerPriority(WorkerPool::Priority priority) { workers.setPriority(priority); }
+
+    //in mid/side the two sides' firs each take the left/right pair and run one channel of it, so the encode and
+    //decode happen while samples are copied in and out of the fifos rather than in passes of their own
+    enum class MidSide
+    {
+        off,
+        //encodes the input, runs the mid in channel 0 and leaves the side in channel 1 for the other fir
+        encodeMid,
+        //runs the side in channel 1, channel 0 holds the mid fir's output and both come out as left/right
+        decodeSide
+    };
+
+    void process(juce::dsp::AudioBlock<float>& block, MidSide midSide = MidSide::off);
+
+    //audio thread, true until the kernel being played is the one designed from the last settings we were given
+    //offline tools keep processing until it's false before they trust what comes out
+    bool isDesignPending() const { return playingGeneration != requestedGeneration; }
+
+    //half the fir (the kernel is centred) plus one partition of input buffering
+    int getLatencyInSamples() const { return latency; }
+
+    //the kernels, fifos and scratch prepare allocated, not counting the fft engines' own tables
+    size_t getMemoryUsageInBytes() const;
+
+private:
+    using Complex = std::complex<float>;
+
+    //every partition of the kernel in the frequency domain, numPartitions * (partitionSize + 1) bins
+    using KernelSpectrum = std::vector<Complex>;
+
+    struct ChannelState
+    {
+        std::vector<float> inputFifo, outputFifo, previousInput;
+        //frequency domain delay line - the spectra of the last numPartitions input blocks
+        std::vector<Complex> delayLine;
+        int delayLineIndex {0};
+    };
+
+    void Design();
+    void DesignImpulse(const ChainSettings& chainSettings, std::vector<float>& impulse);
+    void TransformKernel(const std::vector<float>& impulse, KernelSpectrum& destination);
+    void ProcessPartition(ChannelState& state);
+    void Accumulate(const ChannelState& state, const KernelSpectrum& kernel, float* destination);
+
+    double sampleRate {44100.0};
+    int firLength {0}, partitionSize {0}, numBins {0}, numPartitions {0};
+    int fifoPosition {0}, latency {0};
+
+    std::unique_ptr<juce::dsp::FFT> partitionFft, designPartitionFft, designFft;
+    std::vector<ChannelState> channels;
+
+    //current is what we are playing, next is what we are fading towards
+    //pending is only written by the design job and only while pendingReady is false
+    KernelSpectrum currentKernel, nextKernel, pendingKernel;
+    std::atomic<bool> pendingReady {false};
+    bool fading {false}, hasKernel {false};
+
+    //which request each kernel was designed from, pendingGeneration is handed over with pendingReady like the kernel
+    int requestedGeneration {0}, designGeneration {0}, pendingGeneration {0}, nextGeneration {0}, playingGeneration {0};
+
+    //audio thread scratch, sized in prepare
+    std::vector<float> fftBuffer, fadeBuffer;
+
+    //design job scratch, a trigger's job never runs twice at once
+    std::vector<float> designBuffer, designWindow, impulseBuffer, partitionBuffer;
+
+    //settings handed from the audio thread to the design job
+    juce::SpinLock settingsLock;
+    ChainSettings requestedSettings, lastRequestedSettings;
+    std::atomic<bool> redesignRequested {false};
+    bool hasRequest {false};
+
+    //last, so the trigger is stopped before anything its job uses is destroyed, and before its client
+    WorkerPool::Client workers;
+    WorkerPool::Trigger designTrigger {workers, [this] { Design(); }};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LinearPhaseEQ)
+};
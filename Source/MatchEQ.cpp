@@ -0,0 +1,526 @@
+#include "MatchEQ.h"
+
+SpectrumAverager::SpectrumAverager()
+    : window((size_t) fftSize), frame((size_t) fftSize), fftBuffer((size_t) fftSize * 2), powerSum((size_t) numBins, 0.0)
+{
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t) fftSize,
+                                                             juce::dsp::WindowingFunction<float>::hann, false);
+}
+
+void SpectrumAverager::push(const float* samples, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        auto toCopy = juce::jmin(numSamples, fftSize - frameFill);
+        std::copy(samples, samples + toCopy, frame.begin() + frameFill);
+        frameFill += toCopy;
+        samples += toCopy;
+        numSamples -= toCopy;
+
+        if (frameFill == fftSize)
+        {
+            ProcessFrame();
+
+            //50% overlap, the second half becomes the start of the next frame
+            std::copy(frame.begin() + fftSize / 2, frame.end(), frame.begin());
+            frameFill = fftSize / 2;
+        }
+    }
+}
+
+void SpectrumAverager::ProcessFrame()
+{
+    for (int i = 0; i < fftSize; i++)
+        fftBuffer[(size_t) i] = frame[(size_t) i] * window[(size_t) i];
+    std::fill(fftBuffer.begin() + fftSize, fftBuffer.end(), 0.f);
+
+    fft.performFrequencyOnlyForwardTransform(fftBuffer.data(), true);
+
+    for (int bin = 0; bin < numBins; bin++)
+    {
+        auto magnitude = double(fftBuffer[(size_t) bin]);
+        powerSum[(size_t) bin] += magnitude * magnitude;
+    }
+    numFrames++;
+}
+
+void SpectrumAverager::merge(const SpectrumAverager& other)
+{
+    for (int bin = 0; bin < numBins; bin++)
+        powerSum[(size_t) bin] += other.powerSum[(size_t) bin];
+    numFrames += other.numFrames;
+}
+
+std::vector<double> SpectrumAverager::getAveragePower() const
+{
+    std::vector<double> power (powerSum);
+    if (numFrames > 0)
+        for (auto& value : power)
+            value /= numFrames;
+    return power;
+}
+
+//gaussian elimination with partial pivoting, a is n x n row major and gets destroyed, the answer ends up in b
+static void SolveLinearSystem(std::vector<double>& a, std::vector<double>& b, int n)
+{
+    for (int column = 0; column < n; column++)
+    {
+        auto pivot = column;
+        for (int row = column + 1; row < n; row++)
+            if (std::abs(a[(size_t) (row * n + column)]) > std::abs(a[(size_t) (pivot * n + column)]))
+                pivot = row;
+
+        if (pivot != column)
+        {
+            for (int k = 0; k < n; k++)
+                std::swap(a[(size_t) (column * n + k)], a[(size_t) (pivot * n + k)]);
+            std::swap(b[(size_t) column], b[(size_t) pivot]);
+        }
+
+        auto diagonal = a[(size_t) (column * n + column)];
+        if (std::abs(diagonal) < 1e-12)
+            continue;
+
+        for (int row = column + 1; row < n; row++)
+        {
+            auto factor = a[(size_t) (row * n + column)] / diagonal;
+            for (int k = column; k < n; k++)
+                a[(size_t) (row * n + k)] -= factor * a[(size_t) (column * n + k)];
+            b[(size_t) row] -= factor * b[(size_t) column];
+        }
+    }
+
+    for (int row = n - 1; row >= 0; row--)
+    {
+        auto sum = b[(size_t) row];
+        for (int k = row + 1; k < n; k++)
+            sum -= a[(size_t) (row * n + k)] * b[(size_t) k];
+        auto diagonal = a[(size_t) (row * n + row)];
+        b[(size_t) row] = std::abs(diagonal) < 1e-12 ? 0.0 : sum / diagonal;
+    }
+}
+
+ChainSettings FitMatchCurve(const AveragedSpectrum& reference, const AveragedSpectrum& input, double sampleRate,
+                            const ChainSettings& current, int numBands)
+{
+    auto result = current;
+    numBands = juce::jlimit(1, ChainSettings::numExtraBands, numBands);
+    if (reference.power.empty() || input.power.empty())
+        return result;
+
+    //a twelfth of an octave grid over the range worth matching, everything outside it is left alone
+    auto low = 30.0;
+    auto high = juce::jmin(16000.0, 0.45 * juce::jmin(sampleRate, reference.sampleRate, input.sampleRate));
+    std::vector<double> grid;
+    for (auto freq = low; freq <= high; freq *= std::pow(2.0, 1.0 / 12.0))
+        grid.push_back(freq);
+    auto numPoints = (int) grid.size();
+
+    //each point averages the bins within a third of an octave, so single harmonics don't pull the fit around
+    auto toGridDb = [&grid](const AveragedSpectrum& spectrum)
+    {
+        std::vector<double> db (grid.size());
+        auto binWidth = spectrum.sampleRate / SpectrumAverager::fftSize;
+        auto lastBin = (int) spectrum.power.size() - 1;
+        for (size_t i = 0; i < grid.size(); i++)
+        {
+            auto first = juce::jmax(1, (int) std::ceil(grid[i] * std::pow(2.0, -1.0 / 6.0) / binWidth));
+            auto last = juce::jmin(lastBin, (int) std::floor(grid[i] * std::pow(2.0, 1.0 / 6.0) / binWidth));
+            if (last < first)
+                first = last = juce::jlimit(1, lastBin, juce::roundToInt(grid[i] / binWidth));
+
+            double sum = 0;
+            for (int bin = first; bin <= last; bin++)
+                sum += spectrum.power[(size_t) bin];
+            db[i] = 10.0 * std::log10(sum / (last - first + 1) + 1e-30);
+        }
+        return db;
+    };
+    auto referenceDb = toGridDb(reference);
+    auto inputDb = toGridDb(input);
+
+    //what the lowcut, peak and highcut already do, the bands only have to make up the rest
+    //where a cut has already taken more than 12db away there's nothing sensible to match, so those points are left out
+    auto side = MakeSideCoefficients(current, sampleRate);
+    std::vector<double> target ((size_t) numPoints), weight ((size_t) numPoints);
+    double difference = 0, totalWeight = 0;
+    for (int i = 0; i < numPoints; i++)
+    {
+        auto freq = grid[(size_t) i];
+        double gain = 1.0;
+        if (!current.lowCutBypassed)
+            for (int s = 0; s < GetNumCutSections(current.lowCutSlope); s++)
+                gain *= GetBiquadMagnitude(side.lowCut[(size_t) s], freq, sampleRate);
+        if (!current.peakBypassed)
+            gain *= GetBiquadMagnitude(side.peak, freq, sampleRate);
+        if (!current.highCutBypassed)
+            for (int s = 0; s < GetNumCutSections(current.highCutSlope); s++)
+                gain *= GetBiquadMagnitude(side.highCut[(size_t) s], freq, sampleRate);
+
+        auto chainDb = juce::Decibels::gainToDecibels(gain, -300.0);
+        weight[(size_t) i] = chainDb > -12.0 ? 1.0 : 0.0;
+        target[(size_t) i] = referenceDb[(size_t) i] - inputDb[(size_t) i] - chainDb;
+        difference += weight[(size_t) i] * (referenceDb[(size_t) i] - inputDb[(size_t) i]);
+        totalWeight += weight[(size_t) i];
+    }
+
+    //the overall level is the fader's job, only the shape gets matched
+    auto meanDifference = totalWeight > 0 ? difference / totalWeight : 0.0;
+    for (auto& value : target)
+        value = juce::jlimit(-24.0, 24.0, value - meanDifference);
+
+    //bells spread evenly in log frequency, each one wide enough to overlap its neighbours
+    std::vector<double> freqs ((size_t) numBands), gains ((size_t) numBands, 0.0);
+    auto spacing = std::log2(high / low) / numBands;
+    auto bandwidth = std::pow(2.0, spacing * 1.5);
+    auto quality = juce::jlimit(0.3, 4.0, std::sqrt(bandwidth) / (bandwidth - 1.0));
+    for (int band = 0; band < numBands; band++)
+        freqs[(size_t) band] = low * std::pow(high / low, (band + .5) / numBands);
+
+    auto bellDb = [&](int band, double gainInDb, double freq)
+    {
+        auto bell = MakeBellBiquad<double>(sampleRate, freqs[(size_t) band], quality, float(gainInDb));
+        return juce::Decibels::gainToDecibels(GetBiquadMagnitude(bell, freq, sampleRate), -300.0);
+    };
+
+    //gauss-newton: a bell's db curve is nearly linear in its gain, so a few damped steps get there
+    std::vector<double> jacobian ((size_t) (numPoints * numBands)), residual ((size_t) numPoints);
+    std::vector<double> normal ((size_t) (numBands * numBands)), step ((size_t) numBands);
+    for (int iteration = 0; iteration < 4; iteration++)
+    {
+        for (int i = 0; i < numPoints; i++)
+        {
+            double model = 0;
+            for (int band = 0; band < numBands; band++)
+            {
+                auto now = bellDb(band, gains[(size_t) band], grid[(size_t) i]);
+                model += now;
+                jacobian[(size_t) (i * numBands + band)] = bellDb(band, gains[(size_t) band] + 1.0, grid[(size_t) i]) - now;
+            }
+            residual[(size_t) i] = target[(size_t) i] - model;
+        }
+
+        //(J'WJ + lambda I) step = J'W r, the damping keeps neighbouring bells from fighting each other
+        std::fill(normal.begin(), normal.end(), 0.0);
+        std::fill(step.begin(), step.end(), 0.0);
+        for (int i = 0; i < numPoints; i++)
+        {
+            auto w = weight[(size_t) i];
+            if (w == 0.0)
+                continue;
+
+            const auto* row = jacobian.data() + i * numBands;
+            for (int j = 0; j < numBands; j++)
+            {
+                step[(size_t) j] += w * row[j] * residual[(size_t) i];
+                for (int k = 0; k < numBands; k++)
+                    normal[(size_t) (j * numBands + k)] += w * row[j] * row[k];
+            }
+        }
+        for (int j = 0; j < numBands; j++)
+            normal[(size_t) (j * numBands + j)] += 0.05 * totalWeight / numBands + 1e-6;
+
+        SolveLinearSystem(normal, step, numBands);
+        for (int band = 0; band < numBands; band++)
+            gains[(size_t) band] = juce::jlimit(-24.0, 24.0, gains[(size_t) band] + step[(size_t) band]);
+    }
+
+    for (int band = 0; band < ChainSettings::numExtraBands; band++)
+    {
+        auto& settings = result.bands[(size_t) band];
+        settings.enabled = band < numBands;
+        if (!settings.enabled)
+            continue;
+
+        settings.type = BandType::Bell;
+        settings.freq = float(freqs[(size_t) band]);
+        settings.gainInDb = float(gains[(size_t) band]);
+        settings.quality = float(quality);
+    }
+
+    return result;
+}
+
+MatchEQ::MatchEQ(juce::AudioProcessorValueTreeState& state)
+    : apvts(state)
+{
+    formatManager.registerBasicFormats();
+}
+
+MatchEQ::~MatchEQ()
+{
+    shuttingDown = true;
+    capturing = false;
+    analyseTrigger.stop();
+    cancelPendingUpdate();
+}
+
+void MatchEQ::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+}
+
+void MatchEQ::setNumBands(int newNumBands)
+{
+    numBands = juce::jlimit(1, ChainSettings::numExtraBands, newNumBands);
+}
+
+bool MatchEQ::hasReference() const
+{
+    const juce::SpinLock::ScopedLockType lock(resultsLock);
+    return !referenceSpectrum.power.empty();
+}
+
+bool MatchEQ::hasCapture() const
+{
+    const juce::SpinLock::ScopedLockType lock(resultsLock);
+    return !captureSpectrum.power.empty();
+}
+
+bool MatchEQ::loadReference(const juce::File& file)
+{
+    //just checking something can read it, the decoding happens on the pool
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return false;
+
+    auto generation = ++referenceGeneration;
+    {
+        const juce::SpinLock::ScopedLockType lock(resultsLock);
+        referenceSpectrum = {};
+    }
+
+    //a load still queued behind other work is dropped, one that's running sees the generation change
+    workers.submitLatest(0, [this, file, generation] { AnalyseReference(file, generation); });
+    return true;
+}
+
+void MatchEQ::AnalyseReference(const juce::File& file, int generation)
+{
+    //everything the pieces share lives here, so a helper job that only starts once the others are done is still safe
+    struct Pieces
+    {
+        juce::File file;
+        juce::int64 length {0};
+        int numPieces {1};
+        std::atomic<int> nextPiece {0}, finishedPieces {0};
+        std::vector<std::unique_ptr<SpectrumAverager>> averagers;
+        juce::WaitableEvent finished;
+    };
+
+    auto pieces = std::make_shared<Pieces>();
+    double fileSampleRate = 0;
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(file));
+        if (reader == nullptr)
+            return;
+        pieces->length = reader->lengthInSamples;
+        fileSampleRate = reader->sampleRate;
+    }
+
+    //one piece of the file per core, each decoded by its own reader
+    constexpr juce::int64 minPieceLength = SpectrumAverager::fftSize * 64;
+    pieces->file = file;
+    pieces->numPieces = (int) juce::jlimit<juce::int64>(1, juce::SystemStats::getNumCpus(), pieces->length / minPieceLength);
+    pieces->averagers.resize((size_t) pieces->numPieces);
+
+    //whoever is free takes the next piece, this thread included, so we never sit waiting on jobs stuck in the queue
+    auto analysePieces = [this, pieces, generation]
+    {
+        constexpr int blockSize = 1 << 16;
+        for (auto piece = pieces->nextPiece++; piece < pieces->numPieces; piece = pieces->nextPiece++)
+        {
+            auto averager = std::make_unique<SpectrumAverager>();
+            std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(pieces->file));
+            if (reader != nullptr && reader->numChannels > 0)
+            {
+                auto start = pieces->length * piece / pieces->numPieces;
+                auto end = pieces->length * (piece + 1) / pieces->numPieces;
+                juce::AudioBuffer<float> buffer ((int) reader->numChannels, blockSize);
+
+                for (auto position = start; position < end; position += blockSize)
+                {
+                    if (shuttingDown || referenceGeneration != generation)
+                        break;
+
+                    auto numSamples = (int) juce::jmin<juce::int64>(blockSize, end - position);
+                    reader->read(&buffer, 0, numSamples, position, true, true);
+
+                    //the level doesn't matter, only the shape, so the channels are just summed
+                    for (int channel = 1; channel < buffer.getNumChannels(); channel++)
+                        buffer.addFrom(0, 0, buffer, channel, 0, numSamples);
+                    averager->push(buffer.getReadPointer(0), numSamples);
+                }
+            }
+
+            pieces->averagers[(size_t) piece] = std::move(averager);
+            if (++pieces->finishedPieces == pieces->numPieces)
+                pieces->finished.signal();
+        }
+    };
+
+    for (int helper = 1; helper < pieces->numPieces; helper++)
+        workers.submit(analysePieces);
+    analysePieces();
+    pieces->finished.wait();
+
+    if (shuttingDown || referenceGeneration != generation)
+        return;
+
+    SpectrumAverager total;
+    for (const auto& averager : pieces->averagers)
+        total.merge(*averager);
+    if (total.getNumFrames() == 0)
+        return;
+
+    {
+        const juce::SpinLock::ScopedLockType lock(resultsLock);
+        referenceSpectrum = { total.getAveragePower(), fileSampleRate };
+    }
+    FitIfReady();
+}
+
+bool MatchEQ::startCapture(double seconds)
+{
+    if (captureRunning.load() || seconds <= 0)
+        return false;
+
+    //neither the audio thread nor the analysis job is looking at any of this until capturing is set
+    if (fifoBuffer.empty())
+        fifoBuffer.resize((size_t) fifoSize);
+    fifo.reset();
+    captureAverager = std::make_unique<SpectrumAverager>();
+    captureRunning = true;
+    captureTarget = juce::roundToInt(seconds * sampleRate.load());
+    capturedSamples = 0;
+    {
+        const juce::SpinLock::ScopedLockType lock(resultsLock);
+        captureSpectrum = {};
+    }
+    capturing.store(true, std::memory_order_release);
+    return true;
+}
+
+void MatchEQ::pushInput(const juce::dsp::AudioBlock<float>& block)
+{
+    if (!capturing.load(std::memory_order_acquire))
+        return;
+
+    auto numSamples = (int) juce::jmin<int64_t>((int64_t) block.getNumSamples(), captureTarget - capturedSamples);
+    auto numChannels = block.getNumChannels();
+
+    //if the analysis has fallen behind the fifo is full and we drop samples, the average barely notices
+    const auto scope = fifo.write(numSamples);
+    auto copy = [&](int destination, int size, int offset)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            float sum = 0;
+            for (size_t channel = 0; channel < numChannels; channel++)
+                sum += block.getSample((int) channel, offset + i);
+            fifoBuffer[(size_t) (destination + i)] = sum;
+        }
+    };
+    copy(scope.startIndex1, scope.blockSize1, 0);
+    copy(scope.startIndex2, scope.blockSize2, scope.blockSize1);
+
+    capturedSamples += numSamples;
+    auto finished = capturedSamples >= captureTarget;
+    if (finished)
+        capturing.store(false, std::memory_order_release);
+
+    //firing never blocks, the last block always fires so the tail gets averaged and the spectrum handed over
+    if (finished || fifo.getNumReady() >= analyseThreshold)
+        analyseTrigger.fire();
+}
+
+void MatchEQ::AnalyseCapture()
+{
+    if (captureAverager == nullptr)
+        return;
+
+    //the last samples land before capturing is cleared, so once it's clear whatever is in the fifo is the end
+    auto finished = !capturing.load(std::memory_order_acquire);
+
+    if (auto ready = fifo.getNumReady(); ready > 0)
+    {
+        const auto scope = fifo.read(ready);
+        captureAverager->push(fifoBuffer.data() + scope.startIndex1, scope.blockSize1);
+        captureAverager->push(fifoBuffer.data() + scope.startIndex2, scope.blockSize2);
+    }
+
+    if (!finished)
+        return;
+
+    std::unique_ptr<SpectrumAverager> averager;
+    std::swap(averager, captureAverager);
+    if (!shuttingDown && averager->getNumFrames() > 0)
+    {
+        {
+            const juce::SpinLock::ScopedLockType lock(resultsLock);
+            captureSpectrum = { averager->getAveragePower(), sampleRate.load() };
+        }
+        FitIfReady();
+    }
+
+    captureRunning = false;
+}
+
+void MatchEQ::FitIfReady()
+{
+    AveragedSpectrum reference, input;
+    {
+        const juce::SpinLock::ScopedLockType lock(resultsLock);
+        if (referenceSpectrum.power.empty() || captureSpectrum.power.empty())
+            return;
+        reference = referenceSpectrum;
+        input = captureSpectrum;
+    }
+
+    workers.submit([this, reference, input]
+    {
+        //the parameters are only read here, they get written on the message thread
+        auto fitted = FitMatchCurve(reference, input, sampleRate.load(), getChainSettings(apvts), numBands.load());
+        {
+            const juce::SpinLock::ScopedLockType lock(resultsLock);
+            fittedSettings = fitted;
+            fitPending = true;
+        }
+
+        if (!shuttingDown)
+            triggerAsyncUpdate();
+    });
+}
+
+void MatchEQ::handleAsyncUpdate()
+{
+    ChainSettings settings;
+    {
+        const juce::SpinLock::ScopedLockType lock(resultsLock);
+        if (!fitPending)
+            return;
+        settings = fittedSettings;
+        fitPending = false;
+    }
+
+    //a normal parameter change, so the host records it and the processor picks it up like a knob move
+    //only the bands are the fit's, the other knobs may have moved since it read them and are left alone
+    WriteBandSettings([this](const juce::String& id, float value)
+    {
+        if (auto* parameter = apvts.getParameter(id))
+        {
+            auto normalised = parameter->convertTo0to1(value);
+            if (normalised != parameter->getValue())
+                parameter->setValueNotifyingHost(normalised);
+        }
+    }, settings.bands);
+
+    if (onMatchApplied != nullptr)
+        onMatchApplied();
+}
+
+size_t MatchEQ::getMemoryUsageInBytes() const
+{
+    const juce::SpinLock::ScopedLockType lock(resultsLock);
+    return sizeof(*this) + GetVectorBytes(fifoBuffer) + GetVectorBytes(referenceSpectrum.power) + GetVectorBytes(captureSpectrum.power);
+}
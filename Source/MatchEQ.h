@@ -0,0 +1,124 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "WorkerPool.h"
+
+//long term average power spectrum: hann windowed frames with 50% overlap, power summed per bin
+class SpectrumAverager
+{
+public:
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numBins = fftSize / 2 + 1;
+
+    SpectrumAverager();
+
+    void push(const float* samples, int numSamples);
+    //adds another averager's frames in, for spectra worked out a piece at a time on several threads
+    void merge(const SpectrumAverager& other);
+
+    int getNumFrames() const { return numFrames; }
+    //mean power per bin
+    std::vector<double> getAveragePower() const;
+
+private:
+    void ProcessFrame();
+
+    juce::dsp::FFT fft {fftOrder};
+    std::vector<float> window, frame, fftBuffer;
+    int frameFill {0};
+
+    std::vector<double> powerSum;
+    int numFrames {0};
+};
+
+struct AveragedSpectrum
+{
+    std::vector<double> power;
+    double sampleRate {0};
+};
+
+//least squares fit of numBands bells (log spaced, fixed Q) to the difference between the two spectra, on top of
+//the lowcut, peak and highcut the current settings already have. the overall level difference is ignored
+//returns current with the first numBands extra bands set to the fit and the rest switched off
+ChainSettings FitMatchCurve(const AveragedSpectrum& reference, const AveragedSpectrum& input, double sampleRate,
+                            const ChainSettings& current, int numBands);
+
+//"match": the long term spectrum of a reference file against a captured stretch of the live input,
+//fitted to the extra bands and applied to the parameters like any other change
+//the decoding, averaging and fitting all happen on the shared worker pool, the audio thread only copies
+//the input into a fifo while capturing and the message thread only writes the parameters at the end
+class MatchEQ : private juce::AsyncUpdater
+{
+public:
+    static constexpr int fifoSize = 1 << 16;
+    //how many captured samples pile up before the audio thread asks for them to be averaged, one frame's worth
+    static constexpr int analyseThreshold = SpectrumAverager::fftSize;
+
+    explicit MatchEQ(juce::AudioProcessorValueTreeState& apvts);
+    ~MatchEQ() override;
+
+    //message thread
+    void prepare(double sampleRate);
+    //decodes and averages the file on every core, returns false if nothing can read it
+    bool loadReference(const juce::File& file);
+    //averages the next seconds of input, returns false if a capture is already running
+    bool startCapture(double seconds);
+    //how many extra bands the fit uses, from 1 to ChainSettings::numExtraBands
+    void setNumBands(int numBands);
+    int getNumBands() const { return numBands.load(); }
+    void setWorkerPriority(WorkerPool::Priority priority) { workers.setPriority(priority); }
+    //every file pattern loadReference can read, for a file chooser
+    juce::String getReferenceWildcard() const { return formatManager.getWildcardForAllFormats(); }
+
+    bool isBusy() const { return workers.isBusy() || captureRunning.load(); }
+    bool isCapturing() const { return captureRunning.load(); }
+    bool hasReference() const;
+    bool hasCapture() const;
+
+    //called on the message thread after a match has been written to the parameters
+    std::function<void()> onMatchApplied;
+
+    //audio thread, does nothing unless a capture is running
+    void pushInput(const juce::dsp::AudioBlock<float>& block);
+
+    size_t getMemoryUsageInBytes() const;
+
+private:
+    void AnalyseReference(const juce::File& file, int generation);
+    void AnalyseCapture();
+    void FitIfReady();
+    void handleAsyncUpdate() override;
+
+    juce::AudioProcessorValueTreeState& apvts;
+    juce::AudioFormatManager formatManager;
+    std::atomic<bool> shuttingDown {false};
+
+    std::atomic<double> sampleRate {44100.0};
+    std::atomic<int> numBands {ChainSettings::numExtraBands};
+
+    //a newer load makes the one still running throw its result away
+    std::atomic<int> referenceGeneration {0};
+
+    //the finished spectra and fit, swapped in and out under the lock
+    mutable juce::SpinLock resultsLock;
+    AveragedSpectrum referenceSpectrum, captureSpectrum;
+    ChainSettings fittedSettings;
+    bool fitPending {false};
+
+    //allocated by the first capture and kept, the audio thread only touches it while capturing is set
+    juce::AbstractFifo fifo {fifoSize};
+    std::vector<float> fifoBuffer;
+    std::atomic<bool> capturing {false};
+    int64_t captureTarget {0}, capturedSamples {0};
+    //set from the start of a capture until its spectrum is in, the averager belongs to the analysis job in between
+    std::atomic<bool> captureRunning {false};
+    std::unique_ptr<SpectrumAverager> captureAverager;
+
+    //last, so every job is finished before anything it uses goes
+    WorkerPool::Client workers;
+    WorkerPool::Trigger analyseTrigger {workers, [this] { AnalyseCapture(); }};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MatchEQ)
+};
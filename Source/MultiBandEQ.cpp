@@ -0,0 +1,169 @@
+#include "MultiBandEQ.h"
+#include "Timeline.h"
+
+template<typename SampleType>
+int MakeBandSections(const BandSettings& band, double sampleRate, std::array<BiquadCoefficientsOf<SampleType>, maxSectionsPerBand>& sections)
+{
+    if (!band.enabled || sampleRate <= 0)
+        return 0;
+
+    SIMPLEEQ_TIMELINE_SCOPE("Band design");
+
+    //keep the designs away from nyquist at low sample rates
+    auto freq = juce::jmin(double(band.freq), sampleRate * 0.49);
+    double quality = band.quality;
+
+    switch (band.type)
+    {
+        case BandType::Bell:
+            sections[0] = MakeBellBiquad<SampleType>(sampleRate, freq, quality, band.gainInDb);
+            return 1;
+        case BandType::LowShelf:
+            sections[0] = MakeLowShelfBiquad<SampleType>(sampleRate, freq, quality, band.gainInDb);
+            return 1;
+        case BandType::HighShelf:
+            sections[0] = MakeHighShelfBiquad<SampleType>(sampleRate, freq, quality, band.gainInDb);
+            return 1;
+        case BandType::Notch:
+            sections[0] = MakeNotchBiquad<SampleType>(sampleRate, freq, quality);
+            return 1;
+        case BandType::BandLowCut:
+            sections[0] = MakeHighPassBiquad<SampleType>(sampleRate, freq, quality);
+            return 1;
+        case BandType::BandHighCut:
+            sections[0] = MakeLowPassBiquad<SampleType>(sampleRate, freq, quality);
+            return 1;
+        case BandType::Tilt:
+            //half the gain each way, pivoting around freq
+            sections[0] = MakeLowShelfBiquad<SampleType>(sampleRate, freq, quality, -band.gainInDb * .5f);
+            sections[1] = MakeHighShelfBiquad<SampleType>(sampleRate, freq, quality, band.gainInDb * .5f);
+            return 2;
+        default:
+            jassertfalse;
+            return 0;
+    }
+}
+
+template int MakeBandSections<float>(const BandSettings&, double, std::array<BiquadCoefficientsOf<float>, maxSectionsPerBand>&);
+template int MakeBandSections<double>(const BandSettings&, double, std::array<BiquadCoefficientsOf<double>, maxSectionsPerBand>&);
+
+void MultiBandEQ::prepare(double newSampleRate, int newNumChannels)
+{
+    sampleRate = newSampleRate;
+    numChannels = juce::jlimit(1, maxChannels, newNumChannels);
+
+    //the sample rate may have changed so everything gets redesigned next time
+    hasSettings = false;
+    numActive = 0;
+    reset();
+}
+
+void MultiBandEQ::reset()
+{
+    z1.fill(0.f);
+    z2.fill(0.f);
+}
+
+void MultiBandEQ::setChainSettings(const ChainSettings& chainSettings)
+{
+    if (hasSettings && chainSettings.bands == lastBands)
+        return;
+
+    //design into the packed arrays, carrying each section's state over from wherever it used to be
+    std::array<float, maxSections * maxChannels> newZ1 {}, newZ2 {};
+    std::array<int, maxSections> newIds {};
+    std::array<BiquadCoefficients, maxSectionsPerBand> sections;
+    int newNumActive = 0;
+
+    for (int band = 0; band < ChainSettings::numExtraBands; band++)
+    {
+        auto numSections = MakeBandSections(chainSettings.bands[(size_t) band], sampleRate, sections);
+
+        for (int s = 0; s < numSections; s++)
+        {
+            auto slot = (size_t) newNumActive;
+            auto id = band * maxSectionsPerBand + s;
+            b0[slot] = sections[(size_t) s].b0;
+            b1[slot] = sections[(size_t) s].b1;
+            b2[slot] = sections[(size_t) s].b2;
+            a1[slot] = sections[(size_t) s].a1;
+            a2[slot] = sections[(size_t) s].a2;
+            newIds[slot] = id;
+
+            for (int old = 0; old < numActive; old++)
+            {
+                if (sectionIds[(size_t) old] == id)
+                {
+                    for (int channel = 0; channel < maxChannels; channel++)
+                    {
+                        newZ1[slot * maxChannels + (size_t) channel] = z1[(size_t) (old * maxChannels + channel)];
+                        newZ2[slot * maxChannels + (size_t) channel] = z2[(size_t) (old * maxChannels + channel)];
+                    }
+                    break;
+                }
+            }
+
+            newNumActive++;
+        }
+    }
+
+    z1 = newZ1;
+    z2 = newZ2;
+    sectionIds = newIds;
+    numActive = newNumActive;
+
+    lastBands = chainSettings.bands;
+    hasSettings = true;
+}
+
+void MultiBandEQ::process(juce::dsp::AudioBlock<float>& block, bool decodeMidSide, float startGain, float endGain)
+{
+    auto numSamples = block.getNumSamples();
+    auto channelsToProcess = juce::jmin((int) block.getNumChannels(), numChannels);
+    decodeMidSide = decodeMidSide && channelsToProcess == maxChannels;
+
+    auto hasGain = startGain != 1.f || endGain != 1.f;
+    if (numActive == 0 && !decodeMidSide && !hasGain)
+        return;
+    auto gainStep = (endGain - startGain) / float(juce::jmax(size_t(1), numSamples));
+
+    float* channelData[maxChannels] {};
+    for (int channel = 0; channel < channelsToProcess; channel++)
+        channelData[channel] = block.getChannelPointer((size_t) channel);
+
+    for (size_t i = 0; i < numSamples; i++)
+    {
+        //the channel loop always runs maxChannels wide so the compiler can vectorise it
+        float x[maxChannels] {};
+        for (int channel = 0; channel < channelsToProcess; channel++)
+            x[channel] = channelData[channel][i];
+
+        if (decodeMidSide)
+        {
+            auto mid = x[0];
+            auto side = x[1];
+            x[0] = mid + side;
+            x[1] = mid - side;
+        }
+
+        //transposed direct form II, one section after another
+        for (int s = 0; s < numActive; s++)
+        {
+            auto* sz1 = z1.data() + s * maxChannels;
+            auto* sz2 = z2.data() + s * maxChannels;
+
+            for (int channel = 0; channel < maxChannels; channel++)
+            {
+                auto in = x[channel];
+                auto out = b0[(size_t) s] * in + sz1[channel];
+                sz1[channel] = b1[(size_t) s] * in - a1[(size_t) s] * out + sz2[channel];
+                sz2[channel] = b2[(size_t) s] * in - a2[(size_t) s] * out;
+                x[channel] = out;
+            }
+        }
+
+        auto gain = startGain + gainStep * float(i);
+        for (int channel = 0; channel < channelsToProcess; channel++)
+            channelData[channel][i] = x[channel] * gain;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "BiquadDesign.h"
+
+//designs the biquad sections for one extra band, returns how many it needs (0 if the band is off)
+//tilt is a low shelf and a high shelf pulling in opposite directions so it needs 2
+constexpr int maxSectionsPerBand = 2;
+//built for float (everything realtime) and double (the render path)
+template<typename SampleType>
+int MakeBandSections(const BandSettings& band, double sampleRate, std::array<BiquadCoefficientsOf<SampleType>, maxSectionsPerBand>& sections);
+
+//runtime configurable cascade for the extra bands
+//coefficients and states are stored as struct of arrays and only the enabled bands are packed in,
+//so the inner loop runs straight through every active section with no branches
+class MultiBandEQ
+{
+public:
+    static constexpr int maxSections = ChainSettings::numExtraBands * maxSectionsPerBand;
+    static constexpr int maxChannels = 2;
+
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+
+    //only redesigns (and repacks) when the extra bands have actually changed
+    void setChainSettings(const ChainSettings& chainSettings);
+
+    //decodeMidSide turns channels 0/1 from mid/side back into left/right on the way in,
+    //and the output is ramped from startGain to endGain on the way out (the auto gain's makeup),
+    //so neither needs an extra pass over the buffer
+    void process(juce::dsp::AudioBlock<float>& block, bool decodeMidSide = false, float startGain = 1.f, float endGain = 1.f);
+
+    int getNumActiveSections() const { return numActive; }
+
+private:
+    double sampleRate {44100.0};
+    int numChannels {maxChannels};
+    bool hasSettings {false};
+    std::array<BandSettings, ChainSettings::numExtraBands> lastBands;
+
+    //one entry per active section
+    alignas(16) std::array<float, maxSections> b0 {}, b1 {}, b2 {}, a1 {}, a2 {};
+    //states are [section][channel] so both channels of a section sit next to each other
+    alignas(16) std::array<float, maxSections * maxChannels> z1 {}, z2 {};
+    //band index * maxSectionsPerBand + section, so state follows its band when the packing changes
+    std::array<int, maxSections> sectionIds {};
+    int numActive {0};
+
+    JUCE_LEAK_DETECTOR (MultiBandEQ)
+};
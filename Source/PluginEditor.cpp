@@ -8,6 +8,12 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "ResponseAnalysis.h"
+#include "Spectrogram.h"
+#include "MatchEQ.h"
+#include "SnapshotMorph.h"
+#include "AutomationRecorder.h"
+#include "Timeline.h"
 
 void LookAndFeel::drawRotarySlider(juce::Graphics &g,
                                    int x,
@@ -18,15 +24,26 @@ void LookAndFeel::drawRotarySlider(juce::Graphics &g,
                                    float rotaryStartAngle,
                                    float rotaryEndAngle,
                                    juce::Slider &slider)
+{
+    auto bounds = juce::Rectangle<float>(x, y, width, height);
+    drawRotarySliderBody(g, bounds);
+    drawRotarySliderPointer(g, bounds, sliderPosProportional, rotaryStartAngle, rotaryEndAngle, slider);
+}
+
+void LookAndFeel::drawRotarySliderBody(juce::Graphics& g, juce::Rectangle<float> bounds)
 {
     using namespace juce;
-    auto bounds = Rectangle<float>(x, y, width, height);
     g.setColour(Colour(97u, 18u, 167u));
     g.fillEllipse(bounds);
     
     g.setColour(Colour(155u, 15u, 155u));
     g.drawEllipse(bounds, 1.f);
-    
+}
+
+void LookAndFeel::drawRotarySliderPointer(juce::Graphics& g, juce::Rectangle<float> bounds, float sliderPosProportional,
+                                          float rotaryStartAngle, float rotaryEndAngle, juce::Slider& slider)
+{
+    using namespace juce;
     if(auto* rswl = dynamic_cast<KnobWithText*>(&slider))
     {
         auto center = bounds.getCentre();
@@ -79,28 +96,108 @@ void LookAndFeel::drawToggleButton (juce::Graphics &g, juce::ToggleButton &toggl
     
 }
 
+//==============================================================================
+CachedLayer::CachedLayer(juce::Component& layerOwner, int maxImagePixels) : owner(layerOwner), maxPixels(maxImagePixels)
+{
+}
+
+void CachedLayer::draw(juce::Graphics& g, const std::function<void(juce::Graphics&)>& render)
+{
+    auto width = owner.getWidth();
+    auto height = owner.getHeight();
+    if(width <= 0 || height <= 0)
+        return;
+    
+    auto now = juce::Time::getMillisecondCounter();
+    if(width != lastWidth || height != lastHeight)
+    {
+        lastWidth = width;
+        lastHeight = height;
+        sizeChangedAt = now;
+    }
+    
+    //physical pixels per component pixel, the host's scaling and the display's both included
+    auto scale = juce::jmin(g.getInternalContext().getPhysicalPixelScaleFactor(),
+                            std::sqrt(float(maxPixels) / float(width * height)));
+    
+    Entry* sameScale = nullptr;
+    Entry* newest = nullptr;
+    Entry* oldest = &entries.front();
+    for(auto& entry : entries)
+    {
+        if(!entry.image.isValid())
+        {
+            oldest = &entry;
+            continue;
+        }
+        
+        if(juce::approximatelyEqual(entry.scale, scale))
+            sameScale = &entry;
+        if(newest == nullptr || entry.lastUsed > newest->lastUsed)
+            newest = &entry;
+        if(oldest->image.isValid() && entry.lastUsed < oldest->lastUsed)
+            oldest = &entry;
+    }
+    
+    auto* chosen = sameScale;
+    if(chosen == nullptr || chosen->width != width || chosen->height != height)
+    {
+        //mid drag the closest thing we have is stretched to fit, the timer comes back for the real one
+        auto* stale = sameScale != nullptr ? sameScale : newest;
+        if(stale != nullptr && now - sizeChangedAt < (juce::uint32) settleMs)
+        {
+            chosen = stale;
+            startTimer(settleMs);
+        }
+        else
+        {
+            chosen = sameScale != nullptr ? sameScale : oldest;
+            Render(*chosen, width, height, scale, render);
+        }
+    }
+    
+    chosen->lastUsed = ++useCounter;
+    g.drawImage(chosen->image, owner.getLocalBounds().toFloat());
+}
+
+void CachedLayer::Render(Entry& entry, int width, int height, float scale, const std::function<void(juce::Graphics&)>& render)
+{
+    entry.scale = scale;
+    entry.width = width;
+    entry.height = height;
+    entry.image = juce::Image(juce::Image::PixelFormat::ARGB, juce::jmax(1, juce::roundToInt(width * scale)),
+                              juce::jmax(1, juce::roundToInt(height * scale)), true);
+    
+    juce::Graphics layer (entry.image);
+    layer.addTransform(juce::AffineTransform::scale(entry.image.getWidth() / float(width), entry.image.getHeight() / float(height)));
+    render(layer);
+}
+
+void CachedLayer::timerCallback()
+{
+    stopTimer();
+    owner.repaint();
+}
+
+//==============================================================================
 void KnobWithText::paint(juce::Graphics &g)
 {
     using namespace juce;
-    auto startAngle = degreesToRadians(180.f + 45.f);
-    auto endAngle = degreesToRadians(180.f - 45.f) + MathConstants<float>::twoPi;
     auto range = getRange();
-    auto knobBounds = getSliderBounds();
-    
-//    g.setColour(Colours::red);
-//    g.drawRect(getLocalBounds());
-//    g.setColour(Colours::yellow);
-//    g.drawRect(getSliderBounds());
-    
-    getLookAndFeel().drawRotarySlider(g,
-                                      knobBounds.getX(),
-                                      knobBounds.getY(),
-                                      knobBounds.getWidth(),
-                                      knobBounds.getHeight(),
-                                      jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0),
-                                      startAngle,
-                                      endAngle,
-                                      *this);
+    
+    //the body and the labels come from the cache, only the pointer and the value are drawn every time
+    staticLayer.draw(g, [this](Graphics& layer) { DrawStaticLayer(layer); });
+    lnf->drawRotarySliderPointer(g, getSliderBounds().toFloat(), jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0),
+                                 GetStartAngle(), GetEndAngle(), *this);
+}
+
+void KnobWithText::DrawStaticLayer(juce::Graphics& g)
+{
+    using namespace juce;
+    auto startAngle = GetStartAngle();
+    auto endAngle = GetEndAngle();
+    
+    lnf->drawRotarySliderBody(g, getSliderBounds().toFloat());
     
     auto center = getSliderBounds().toFloat().getCentre();
     auto radius = getSliderBounds().getWidth() / 2;
@@ -148,6 +245,52 @@ juce::Rectangle<int> KnobWithText::getSliderBounds() const
     return r;
 }
 
+//the knob's positions, steepest last with the linkwitz-riley slopes after the butterworths
+static constexpr std::array<Slope, numSlopes> slopeDisplayOrder
+{
+    Slope_6, Slope_12, Slope_18, Slope_24, Slope_36, Slope_48, Slope_60, Slope_72, Slope_96,
+    Slope_LR12, Slope_LR24, Slope_LR48
+};
+
+static int GetSlopeDisplayPosition(int slope)
+{
+    auto found = std::find(slopeDisplayOrder.begin(), slopeDisplayOrder.end(), slope);
+    return found != slopeDisplayOrder.end() ? int(found - slopeDisplayOrder.begin()) : 0;
+}
+
+SlopeSliderAttachment::SlopeSliderAttachment(juce::RangedAudioParameter& parameter, juce::Slider& s)
+    : slider(s), attachment(parameter, [this](float value)
+    {
+        slider.setValue(GetSlopeDisplayPosition(juce::roundToInt(value)), juce::dontSendNotification);
+    })
+{
+    slider.setRange(0.0, double(numSlopes - 1), 1.0);
+    slider.setDoubleClickReturnValue(true, GetSlopeDisplayPosition(juce::roundToInt(parameter.convertFrom0to1(parameter.getDefaultValue()))));
+    slider.addListener(this);
+    attachment.sendInitialUpdate();
+}
+
+SlopeSliderAttachment::~SlopeSliderAttachment()
+{
+    slider.removeListener(this);
+}
+
+void SlopeSliderAttachment::sliderValueChanged(juce::Slider*)
+{
+    auto position = juce::jlimit(0, numSlopes - 1, juce::roundToInt(slider.getValue()));
+    attachment.setValueAsPartOfGesture(float(slopeDisplayOrder[(size_t) position]));
+}
+
+void SlopeSliderAttachment::sliderDragStarted(juce::Slider*)
+{
+    attachment.beginGesture();
+}
+
+void SlopeSliderAttachment::sliderDragEnded(juce::Slider*)
+{
+    attachment.endGesture();
+}
+
 juce::String KnobWithText::getDisplayString() const
 {
     if(auto* choiceParam = dynamic_cast<juce::AudioParameterChoice*>(param))
@@ -171,7 +314,7 @@ juce::String KnobWithText::getDisplayString() const
         jassertfalse;
     }
     
-    if(param->paramID == "PeakGain")
+    if(param->paramID == GetChainParameterIDs(0).peakGain || param->paramID == GetChainParameterIDs(1).peakGain)
         string = juce::String(getValue(), 2);
     
     if(suffix.isNotEmpty())
@@ -195,6 +338,17 @@ ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) : audi
         param->addListener(this);
     }
     
+    //quiet is black, then blue and purple up to orange and yellow for the loudest
+    juce::ColourGradient gradient (juce::Colours::black, 0.f, 0.f, juce::Colours::yellow, 1.f, 0.f, false);
+    gradient.addColour(.35, juce::Colour(20, 30, 110));
+    gradient.addColour(.6, juce::Colour(120, 30, 130));
+    gradient.addColour(.8, juce::Colours::darkorange);
+    for (size_t i = 0; i < spectrogramColours.size(); i++)
+        spectrogramColours[i] = gradient.getColourAtPosition(double(i) / double(spectrogramColours.size() - 1));
+    
+    //the analysis only runs while there's an editor open to show it
+    audioProcessor.getSpectrogram().setViewOpen(true);
+    
     UpdateGraph();
     //starting the timer to check for param changes (60fps)
     startTimerHz(60);
@@ -202,6 +356,8 @@ ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) : audi
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
+    audioProcessor.getSpectrogram().setViewOpen(false);
+    
     const auto& params = audioProcessor.getParameters();
     for (auto param : params)
     {
@@ -215,21 +371,30 @@ void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float new
 }
 
 void ResponseCurveComponent::UpdateGraph() {
+    SIMPLEEQ_TIMELINE_SCOPE("UpdateGraph");
     
-    auto chainSettings = getChainSettings(audioProcessor.apvts);
-    
-    monochain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    monochain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    monochain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    
-    auto peakCoefficients = MakePeakFilter(chainSettings, audioProcessor.getSampleRate());
-    UpdateCoefficients(monochain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    auto& apvts = audioProcessor.apvts;
+    auto sampleRate = audioProcessor.getSampleRate();
+    linked = int(apvts.getRawParameterValue("StereoMode")->load()) == StereoMode::Linked;
     
-    auto lowCutCoefficients = MakeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-    auto highCutCoefficients = MakeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
+    //plain biquads instead of a third copy of the processor's filter chain
+    sections[0] = MakeChainSections(getChainSettings(apvts), sampleRate);
+    if(linked)
+        sections[1].clear();
+    else
+        sections[1] = MakeChainSections(getChainSettings(apvts, 1), sampleRate);
     
-    UpdateCutFilter(monochain.get<ChainPositions::LowCut>(), lowCutCoefficients, static_cast<Slope>(chainSettings.lowCutSlope));
-    UpdateCutFilter(monochain.get<ChainPositions::HighCut>(), highCutCoefficients, static_cast<Slope>(chainSettings.highCutSlope));
+    //linked there's only the one set, so the knobs go back to it
+    if(linked && editedParameterSet != 0)
+        EditParameterSet(0);
+    UpdateResponseCurve();
+}
+
+void ResponseCurveComponent::EditParameterSet(int parameterSet)
+{
+    editedParameterSet = parameterSet;
+    if(onEditParameterSet)
+        onEditParameterSet(parameterSet);
 }
 
 void ResponseCurveComponent::timerCallback()
@@ -237,31 +402,263 @@ void ResponseCurveComponent::timerCallback()
     if(parametersChanged.compareAndSetBool(false, true))
     {
         //if the parameters have changed then we change the curve
-        //update the monochain
+        //redesign the sections
         UpdateGraph();
         
         //signal a repaint
         repaint();
     }
+    
+    //whatever columns the analyser has finished since last time, only the graph needs repainting for them
+    auto& analyser = audioProcessor.getSpectrogram();
+    if(analyser.isEnabled())
+    {
+        auto numColumns = analyser.readColumns([this](const uint8_t* levels, int numRows) { DrawSpectrogramColumn(levels, numRows); });
+        if(numColumns > 0)
+            repaint(getAnalysisArea());
+    }
 }
 
-void ResponseCurveComponent::paint (juce::Graphics& g)
+void ResponseCurveComponent::DrawSpectrogramColumn(const uint8_t* levels, int numRows)
 {
-    using namespace juce;
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (Colours::black);
+    //a column from before the last resize doesn't fit any more
+    if(!spectrogramImage.isValid() || numRows != spectrogramImage.getHeight())
+        return;
     
-    //drawing grid background
-    g.drawImage(background, getLocalBounds().toFloat());
+    juce::Image::BitmapData data (spectrogramImage, spectrogramWriteX, 0, 1, numRows, juce::Image::BitmapData::writeOnly);
+    for(int y = 0; y < numRows; y++)
+        data.setPixelColour(0, y, spectrogramColours[levels[y]]);
+    
+    spectrogramWriteX = (spectrogramWriteX + 1) % spectrogramImage.getWidth();
+}
+
+void ResponseCurveComponent::ClearSpectrogram()
+{
+    if(spectrogramImage.isValid())
+        spectrogramImage.clear(spectrogramImage.getBounds(), juce::Colours::black);
+    spectrogramWriteX = 0;
+}
+
+void ResponseCurveComponent::mouseDown(const juce::MouseEvent& e)
+{
+    if(e.mods.isPopupMenu())
+        ShowContextMenu();
+}
+
+//the menu's item ids, a range for each submenu
+namespace MenuIds
+{
+    constexpr int spectrogram = 1, recordTimeline = 2;
+    constexpr int fftOrder = 100, scrollSpeed = 200;
+    constexpr int matchReference = 300, matchCapture = 310, matchBands = 320;
+    constexpr int morphStore = 400, morphClear = 410, morphEnabled = 420;
+    constexpr int recordAutomation = 500;
+    constexpr int stereoMode = 600, editParameterSet = 610;
+}
+
+static constexpr std::array<float, 4> spectrogramSpeeds { 25.f, 50.f, 100.f, 200.f };
+static constexpr std::array<int, 3> matchCaptureSeconds { 5, 10, 30 };
+static constexpr std::array<int, 4> matchBandCounts { 4, 8, 12, 16 };
+
+void ResponseCurveComponent::ShowContextMenu()
+{
+    auto& analyser = audioProcessor.getSpectrogram();
+    
+    juce::PopupMenu fftMenu;
+    for(int order = SpectrogramAnalyser::minFftOrder; order <= SpectrogramAnalyser::maxFftOrder; order++)
+        fftMenu.addItem(MenuIds::fftOrder + order, juce::String(1 << order), true, analyser.getFftOrder() == order);
+    
+    juce::PopupMenu speedMenu;
+    for(size_t i = 0; i < spectrogramSpeeds.size(); i++)
+        speedMenu.addItem(MenuIds::scrollSpeed + (int) i, juce::String(int(spectrogramSpeeds[i])) + " px/s", true, analyser.getColumnsPerSecond() == spectrogramSpeeds[i]);
+    
+    //a reference file and a stretch of the input, the fit goes into the extra bands as soon as both are in
+    auto& match = audioProcessor.getMatchEQ();
+    juce::PopupMenu captureMenu;
+    for(size_t i = 0; i < matchCaptureSeconds.size(); i++)
+        captureMenu.addItem(MenuIds::matchCapture + (int) i, juce::String(matchCaptureSeconds[i]) + " s");
+    juce::PopupMenu bandsMenu;
+    for(size_t i = 0; i < matchBandCounts.size(); i++)
+        bandsMenu.addItem(MenuIds::matchBands + (int) i, juce::String(matchBandCounts[i]), true, match.getNumBands() == matchBandCounts[i]);
+    juce::PopupMenu matchMenu;
+    matchMenu.addItem(MenuIds::matchReference, "Load Reference...", true, match.hasReference());
+    matchMenu.addSubMenu(match.isCapturing() ? "Capturing Input..." : "Capture Input", captureMenu, !match.isCapturing(), {}, match.hasCapture());
+    matchMenu.addSubMenu("Bands", bandsMenu);
+    
+    //the snapshots the morph parameter runs through, stored from wherever the knobs are now
+    auto& morph = audioProcessor.getSnapshotMorph();
+    auto* morphEnabled = audioProcessor.apvts.getParameter("MorphEnabled");
+    juce::PopupMenu morphMenu;
+    morphMenu.addItem(MenuIds::morphEnabled, "Morph Enabled", true, morphEnabled->getValue() > 0.5f);
+    morphMenu.addSeparator();
+    for(int slot = 0; slot < SnapshotMorph::maxSnapshots; slot++)
+        morphMenu.addItem(MenuIds::morphStore + slot, "Store " + juce::String::charToString(juce::juce_wchar('A' + slot)), true, morph.getSnapshot(slot).stored);
+    morphMenu.addItem(MenuIds::morphClear, "Clear Snapshots");
+    
+    //how the channels are processed, and which set of parameters the knobs edit when they each have their own
+    auto* stereoMode = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("StereoMode"));
+    auto midSide = stereoMode->getIndex() == StereoMode::MidSide;
+    auto unlinked = stereoMode->getIndex() != StereoMode::Linked;
+    juce::PopupMenu stereoMenu;
+    for(int mode = 0; mode < stereoMode->choices.size(); mode++)
+        stereoMenu.addItem(MenuIds::stereoMode + mode, stereoMode->choices[mode], true, stereoMode->getIndex() == mode);
+    stereoMenu.addSeparator();
+    stereoMenu.addItem(MenuIds::editParameterSet, midSide ? "Edit Mid" : "Edit Left", unlinked, editedParameterSet == 0);
+    stereoMenu.addItem(MenuIds::editParameterSet + 1, midSide ? "Edit Side" : "Edit Right", unlinked, editedParameterSet == 1);
+    
+    juce::PopupMenu menu;
+    menu.addItem(MenuIds::spectrogram, "Spectrogram", true, analyser.isEnabled());
+    menu.addSubMenu("FFT Size", fftMenu);
+    menu.addSubMenu("Scroll Speed", speedMenu);
+    menu.addSeparator();
+    menu.addSubMenu("Stereo Mode", stereoMenu);
+    menu.addSubMenu("Match", matchMenu);
+    menu.addSubMenu("Morph", morphMenu);
+    menu.addSeparator();
+    //a trace of every parameter change, for SoakTest --replay to reproduce a session's cpu use
+    auto recordingAutomation = audioProcessor.getAutomationRecorder().isRecording();
+    menu.addItem(MenuIds::recordAutomation, recordingAutomation ? "Stop Recording Automation" : "Record Automation...", true, recordingAutomation);
+   #if SIMPLEEQ_TIMELINE
+    menu.addSeparator();
+    menu.addItem(MenuIds::recordTimeline, "Record Timeline", true, Timeline::isRecording());
+   #endif
+    
+    juce::Component::SafePointer<ResponseCurveComponent> safeThis (this);
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this), [safeThis](int result)
+    {
+        if(safeThis != nullptr && result != 0)
+            safeThis->HandleMenuResult(result);
+    });
+}
+
+void ResponseCurveComponent::HandleMenuResult(int result)
+{
+    auto& analyser = audioProcessor.getSpectrogram();
+    auto& match = audioProcessor.getMatchEQ();
+    
+    if(result == MenuIds::spectrogram)
+    {
+        analyser.setEnabled(!analyser.isEnabled());
+        ClearSpectrogram();
+    }
+   #if SIMPLEEQ_TIMELINE
+    else if(result == MenuIds::recordTimeline)
+    {
+        //stopping saves it to the desktop and shows the user where it went
+        if(!Timeline::isRecording())
+        {
+            Timeline::start();
+            return;
+        }
+        
+        Timeline::stop();
+        auto file = juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getNonexistentChildFile("SimpleEQ Timeline", ".json");
+        if(Timeline::writeChromeTrace(file))
+            file.revealToUser();
+    }
+   #endif
+    else if(result == MenuIds::recordAutomation)
+    {
+        auto& recorder = audioProcessor.getAutomationRecorder();
+        if(recorder.isRecording())
+            recorder.stop();
+        else
+            ChooseAutomationFile();
+    }
+    else if(result >= MenuIds::editParameterSet)
+    {
+        EditParameterSet(result - MenuIds::editParameterSet);
+    }
+    else if(result >= MenuIds::stereoMode)
+    {
+        //the curves and the knobs catch up on the next timer tick, like any other parameter change
+        auto* stereoMode = audioProcessor.apvts.getParameter("StereoMode");
+        stereoMode->setValueNotifyingHost(stereoMode->convertTo0to1(float(result - MenuIds::stereoMode)));
+    }
+    else if(result == MenuIds::morphEnabled)
+    {
+        auto* morphEnabled = audioProcessor.apvts.getParameter("MorphEnabled");
+        morphEnabled->setValueNotifyingHost(morphEnabled->getValue() > 0.5f ? 0.f : 1.f);
+    }
+    else if(result == MenuIds::morphClear)
+    {
+        for(int slot = 0; slot < SnapshotMorph::maxSnapshots; slot++)
+            audioProcessor.clearSnapshot(slot);
+    }
+    else if(result >= MenuIds::morphStore)
+    {
+        audioProcessor.storeSnapshot(result - MenuIds::morphStore);
+    }
+    else if(result == MenuIds::matchReference)
+    {
+        ChooseMatchReference();
+    }
+    else if(result >= MenuIds::matchBands)
+    {
+        match.setNumBands(matchBandCounts[(size_t) (result - MenuIds::matchBands)]);
+    }
+    else if(result >= MenuIds::matchCapture)
+    {
+        match.startCapture(matchCaptureSeconds[(size_t) (result - MenuIds::matchCapture)]);
+    }
+    else if(result >= MenuIds::scrollSpeed)
+    {
+        analyser.setColumnsPerSecond(spectrogramSpeeds[(size_t) (result - MenuIds::scrollSpeed)]);
+    }
+    else if(result >= MenuIds::fftOrder)
+    {
+        analyser.setFftOrder(result - MenuIds::fftOrder);
+    }
+    repaint();
+}
+
+void ResponseCurveComponent::ChooseMatchReference()
+{
+    auto& match = audioProcessor.getMatchEQ();
+    fileChooser = std::make_unique<juce::FileChooser>("Match Reference", juce::File(), match.getReferenceWildcard());
+    
+    juce::Component::SafePointer<ResponseCurveComponent> safeThis (this);
+    fileChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles, [safeThis](const juce::FileChooser& chooser)
+    {
+        auto file = chooser.getResult();
+        if(safeThis == nullptr || file == juce::File())
+            return;
+        
+        if(!safeThis->audioProcessor.getMatchEQ().loadReference(file))
+            juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Match Reference", "Can't read " + file.getFileName());
+    });
+}
+
+void ResponseCurveComponent::ChooseAutomationFile()
+{
+    auto defaultFile = juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getNonexistentChildFile("SimpleEQ Automation", ".seqa");
+    fileChooser = std::make_unique<juce::FileChooser>("Record Automation", defaultFile, "*.seqa");
+    
+    juce::Component::SafePointer<ResponseCurveComponent> safeThis (this);
+    fileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles | juce::FileBrowserComponent::warnAboutOverwriting,
+                             [safeThis](const juce::FileChooser& chooser)
+    {
+        auto file = chooser.getResult();
+        if(safeThis == nullptr || file == juce::File())
+            return;
+        
+        auto& processor = safeThis->audioProcessor;
+        if(!processor.getAutomationRecorder().start(file, processor.getSampleRate()))
+            juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Record Automation", "Can't write " + file.getFileName());
+    });
+}
+
+void ResponseCurveComponent::UpdateResponseCurve()
+{
+    using namespace juce;
     
     //setting up to display response curve
     auto responseArea = getAnalysisArea();
     auto w = responseArea.getWidth();
-    
-    //get chain elements
-    auto& lowcut = monochain.get<ChainPositions::LowCut>();
-    auto& peak = monochain.get<ChainPositions::Peak>();
-    auto& highcut = monochain.get<ChainPositions::HighCut>();
+    for (auto& responseCurve : responseCurves)
+        responseCurve.clear();
+    if(w <= 0)
+        return;
     
     auto sampleRate = audioProcessor.getSampleRate();
     
@@ -270,63 +667,7 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
     std::vector<double> magnitudes;
     //changing the size of the vector to the width of the response curve display (1 pixel = 1 magnitude)
     magnitudes.resize(w);
-    //iterate through each element of the vector and calculate magnitude at that frequency
-    for (int i = 0; i < w; i++)
-    {
-        //we need a starting gain of 1
-        double mag = 1.f;
-        //call magnitude function for pixel
-        auto freq = mapToLog10(double(i) / double(w), 20.0, 20000.0);
-        if(!monochain.isBypassed<ChainPositions::Peak>())
-        {
-            mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if(!monochain.isBypassed<ChainPositions::LowCut>())
-        {
-            if(!lowcut.isBypassed<0>())
-            {
-                mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if(!lowcut.isBypassed<1>())
-            {
-                mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if(!lowcut.isBypassed<2>())
-            {
-                mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if(!lowcut.isBypassed<3>())
-            {
-                mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            }
-        }
-        if(!monochain.isBypassed<ChainPositions::HighCut>())
-        {
-            if(!highcut.isBypassed<0>())
-            {
-                mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if(!highcut.isBypassed<1>())
-            {
-                mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if(!highcut.isBypassed<2>())
-            {
-                mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if(!highcut.isBypassed<3>())
-            {
-                mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            }
-        }
-        
-        //convert magnitude to decibels
-        magnitudes[i] = Decibels::gainToDecibels(mag);
-    }
     
-    //convert vector of magnitudes to path so we can draw it
-    //Path = juce - sequence of lines and curves that may either form a closed shape or be open-ended
-    Path responseCurve;
     //get window max and min positions
     const double outputMin = responseArea.getBottom();
     const double outputMax = responseArea.getY();
@@ -334,26 +675,98 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
     {
         return jmap(input, -24.0, 24.0, outputMin, outputMax);
     };
-    //starting the curve
-    responseCurve.startNewSubPath(responseArea.getX(), map(magnitudes.front()));
-    //drawing rest of the curve
-    for (size_t i = 1; i < magnitudes.size(); i++)
+    
+    for (size_t set = 0; set < responseCurves.size(); set++)
     {
-        responseCurve.lineTo(responseArea.getX() + i, map(magnitudes[i]));
+        //linked there's no second curve to draw
+        if(set > 0 && linked)
+            break;
+        
+        //iterate through each element of the vector and calculate magnitude at that frequency
+        for (int i = 0; i < w; i++)
+        {
+            //we need a starting gain of 1
+            double mag = 1.f;
+            //call magnitude function for pixel
+            auto freq = mapToLog10(double(i) / double(w), 20.0, 20000.0);
+            for (const auto& section : sections[set])
+            {
+                mag *= GetBiquadMagnitude(section, freq, sampleRate);
+            }
+            
+            //convert magnitude to decibels
+            magnitudes[i] = Decibels::gainToDecibels(mag);
+        }
+        
+        //convert vector of magnitudes to path so we can draw it
+        //Path = juce - sequence of lines and curves that may either form a closed shape or be open-ended
+        auto& responseCurve = responseCurves[set];
+        //starting the curve
+        responseCurve.startNewSubPath(responseArea.getX(), map(magnitudes.front()));
+        //drawing rest of the curve
+        for (size_t i = 1; i < magnitudes.size(); i++)
+        {
+            responseCurve.lineTo(responseArea.getX() + i, map(magnitudes[i]));
+        }
     }
+}
+
+void ResponseCurveComponent::paint (juce::Graphics& g)
+{
+    SIMPLEEQ_TIMELINE_SCOPE("ResponseCurveComponent::paint");
+    using namespace juce;
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll (Colours::black);
+    
+    //the spectrogram goes under the grid, the oldest column (the next one to be overwritten) on the left
+    if(audioProcessor.getSpectrogram().isEnabled() && spectrogramImage.isValid())
+    {
+        auto area = getAnalysisArea();
+        auto width = spectrogramImage.getWidth();
+        auto height = spectrogramImage.getHeight();
+        auto older = width - spectrogramWriteX;
+        g.drawImage(spectrogramImage, area.getX(), area.getY(), older, area.getHeight(), spectrogramWriteX, 0, older, height);
+        if(spectrogramWriteX > 0)
+            g.drawImage(spectrogramImage, area.getX() + older, area.getY(), spectrogramWriteX, area.getHeight(), 0, 0, spectrogramWriteX, height);
+    }
+    
+    //drawing grid background
+    background.draw(g, [this](Graphics& layer) { DrawBackground(layer); });
     
     g.setColour(Colours::orange);
     g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
+    //the set the knobs aren't editing goes underneath, dimmer
+    if(!linked)
+    {
+        g.setColour(Colours::lightblue.withAlpha(.6f));
+        g.strokePath(responseCurves[(size_t) (1 - editedParameterSet)], PathStrokeType(1.5f));
+    }
     g.setColour(Colours::white);
-    g.strokePath(responseCurve, PathStrokeType(2.f));
+    g.strokePath(responseCurves[(size_t) editedParameterSet], PathStrokeType(2.f));
 }
 
 void ResponseCurveComponent::resized()
 {
+    SIMPLEEQ_TIMELINE_SCOPE("ResponseCurveComponent::resized");
     using namespace juce;
-    background = Image(Image::PixelFormat::RGB, getWidth(), getHeight(), true);
-    Graphics g(background);
     
+    //one column per pixel across, and as many rows as fit up to what the analyser makes
+    auto analysisArea = getAnalysisArea();
+    auto numRows = jlimit(1, SpectrogramAnalyser::maxRows, analysisArea.getHeight());
+    spectrogramImage = Image(Image::PixelFormat::RGB, jmax(1, analysisArea.getWidth()), numRows, true);
+    spectrogramWriteX = 0;
+    audioProcessor.getSpectrogram().setNumRows(numRows);
+    
+    //the grid isn't touched here, paint redraws it once the size has settled
+    UpdateResponseCurve();
+}
+
+void ResponseCurveComponent::DrawBackground(juce::Graphics& g)
+{
+    SIMPLEEQ_TIMELINE_SCOPE("ResponseCurveComponent::DrawBackground");
+    using namespace juce;
+    
+    //the layer is transparent so the spectrogram shows through between the lines
     Array<float> frequencies
     {
         20, 50, 100,
@@ -477,19 +890,7 @@ highCutFreqSlider(*audioProcessor.apvts.getParameter("HiCutFreq"), "hz"),
 lowCutSlopeSlider(*audioProcessor.apvts.getParameter("LowCutSlope"), "db/oct"),
 highCutSlopeSlider(*audioProcessor.apvts.getParameter("HiCutSlope"), "db/oct"),
 
-responseCurveComponent(audioProcessor),
-
-peakFreqSliderAttachment(audioProcessor.apvts, "PeakFreq", peakFreqSlider),
-peakGainSliderAttachment(audioProcessor.apvts, "PeakGain", peakGainSlider),
-peakQualitySliderAttachment(audioProcessor.apvts, "PeakQ", peakQualitySlider),
-lowCutFreqSliderAttachment(audioProcessor.apvts, "LowCutFreq", lowCutFreqSlider),
-lowCutSlopeSliderAttachment(audioProcessor.apvts, "LowCutSlope", lowCutSlopeSlider),
-highCutFreqSliderAttachment(audioProcessor.apvts, "HiCutFreq", highCutFreqSlider),
-highCutSlopeSliderAttachment(audioProcessor.apvts, "HiCutSlope", highCutSlopeSlider),
-
-lowCutBypassButtonAttachment(audioProcessor.apvts, "LowCutBypassed", lowCutBypassButton),
-peakBypassButtonAttachment(audioProcessor.apvts, "PeakBypassed", peakBypassButton),
-highCutBypassButtonAttachment(audioProcessor.apvts, "HighCutBypassed", highCutBypassButton)
+responseCurveComponent(audioProcessor)
 
 {
     // Make sure that before the constructor has finished, you've set the
@@ -502,12 +903,12 @@ highCutBypassButtonAttachment(audioProcessor.apvts, "HighCutBypassed", highCutBy
     peakQualitySlider.labels.add({0.f, "Q"});
     highCutFreqSlider.labels.add({0.f, "20hz"});
     highCutFreqSlider.labels.add({1.f, "20khz"});
-    highCutSlopeSlider.labels.add({0.f, "12"});
-    highCutSlopeSlider.labels.add({1.f, "48"});
+    highCutSlopeSlider.labels.add({0.f, "6"});
+    highCutSlopeSlider.labels.add({1.f, "LR48"});
     lowCutFreqSlider.labels.add({0.f, "20hz"});
     lowCutFreqSlider.labels.add({1.f, "20khz"});
-    lowCutSlopeSlider.labels.add({0.f, "12"});
-    lowCutSlopeSlider.labels.add({1.f, "48"});
+    lowCutSlopeSlider.labels.add({0.f, "6"});
+    lowCutSlopeSlider.labels.add({1.f, "LR48"});
     
     //making our components(knob, curve) appear
     for(auto* comp : GetComps())
@@ -515,15 +916,27 @@ highCutBypassButtonAttachment(audioProcessor.apvts, "HighCutBypassed", highCutBy
         addAndMakeVisible(comp);
     }
     
-    peakBypassButton.setLookAndFeel(&lnf);
-    lowCutBypassButton.setLookAndFeel(&lnf);
-    highCutBypassButton.setLookAndFeel(&lnf);
+    peakBypassButton.setLookAndFeel(lnf.get());
+    lowCutBypassButton.setLookAndFeel(lnf.get());
+    highCutBypassButton.setLookAndFeel(lnf.get());
+    
+    //the knobs start on the main set, the curve's menu moves them to the right/side set
+    AttachParameterSet(0);
+    responseCurveComponent.onEditParameterSet = [this](int parameterSet) { AttachParameterSet(parameterSet); };
     
+    audioProcessor.setEditorVisible(true);
+    
+    //the static layers are cached at whatever size and scale they were last drawn, so dragging the corner is cheap
+    //the limits keep those caches a sensible size
+    setResizable(true, true);
+    setResizeLimits(450, 300, 1500, 1000);
     setSize (600, 400);
 }
 
 SimpleEQAudioProcessorEditor::~SimpleEQAudioProcessorEditor()
 {
+    audioProcessor.setEditorVisible(false);
+    
     peakBypassButton.setLookAndFeel(nullptr);
     lowCutBypassButton.setLookAndFeel(nullptr);
     highCutBypassButton.setLookAndFeel(nullptr);
@@ -537,6 +950,7 @@ void SimpleEQAudioProcessorEditor::paint (juce::Graphics& g)
 
 void SimpleEQAudioProcessorEditor::resized()
 {
+    SIMPLEEQ_TIMELINE_SCOPE("SimpleEQAudioProcessorEditor::resized");
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
     
@@ -570,6 +984,44 @@ void SimpleEQAudioProcessorEditor::resized()
     peakQualitySlider.setBounds(bounds);
 }
 
+void SimpleEQAudioProcessorEditor::AttachParameterSet(int parameterSet)
+{
+    auto& apvts = audioProcessor.apvts;
+    const auto& ids = GetChainParameterIDs(parameterSet);
+    
+    //the old attachments go first, otherwise moving a knob to its new parameter's value would move the old parameter too
+    peakFreqSliderAttachment.reset();
+    peakGainSliderAttachment.reset();
+    peakQualitySliderAttachment.reset();
+    lowCutFreqSliderAttachment.reset();
+    highCutFreqSliderAttachment.reset();
+    lowCutSlopeSliderAttachment.reset();
+    highCutSlopeSliderAttachment.reset();
+    lowCutBypassButtonAttachment.reset();
+    peakBypassButtonAttachment.reset();
+    highCutBypassButtonAttachment.reset();
+    
+    peakFreqSlider.setParameter(*apvts.getParameter(ids.peakFreq));
+    peakGainSlider.setParameter(*apvts.getParameter(ids.peakGain));
+    peakQualitySlider.setParameter(*apvts.getParameter(ids.peakQuality));
+    lowCutFreqSlider.setParameter(*apvts.getParameter(ids.lowCutFreq));
+    highCutFreqSlider.setParameter(*apvts.getParameter(ids.highCutFreq));
+    lowCutSlopeSlider.setParameter(*apvts.getParameter(ids.lowCutSlope));
+    highCutSlopeSlider.setParameter(*apvts.getParameter(ids.highCutSlope));
+    
+    peakFreqSliderAttachment = std::make_unique<Attachment>(apvts, ids.peakFreq, peakFreqSlider);
+    peakGainSliderAttachment = std::make_unique<Attachment>(apvts, ids.peakGain, peakGainSlider);
+    peakQualitySliderAttachment = std::make_unique<Attachment>(apvts, ids.peakQuality, peakQualitySlider);
+    lowCutFreqSliderAttachment = std::make_unique<Attachment>(apvts, ids.lowCutFreq, lowCutFreqSlider);
+    highCutFreqSliderAttachment = std::make_unique<Attachment>(apvts, ids.highCutFreq, highCutFreqSlider);
+    lowCutSlopeSliderAttachment = std::make_unique<SlopeSliderAttachment>(*apvts.getParameter(ids.lowCutSlope), lowCutSlopeSlider);
+    highCutSlopeSliderAttachment = std::make_unique<SlopeSliderAttachment>(*apvts.getParameter(ids.highCutSlope), highCutSlopeSlider);
+    
+    lowCutBypassButtonAttachment = std::make_unique<ButtonAttachment>(apvts, ids.lowCutBypassed, lowCutBypassButton);
+    peakBypassButtonAttachment = std::make_unique<ButtonAttachment>(apvts, ids.peakBypassed, peakBypassButton);
+    highCutBypassButtonAttachment = std::make_unique<ButtonAttachment>(apvts, ids.highCutBypassed, highCutBypassButton);
+}
+
 std::vector<juce::Component*> SimpleEQAudioProcessorEditor::GetComps()
 {
     return
@@ -12,6 +12,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "BiquadDesign.h"
 
 struct LookAndFeel: juce::LookAndFeel_V4
 {
@@ -22,12 +23,54 @@ struct LookAndFeel: juce::LookAndFeel_V4
                                    float rotaryEndAngle,
                                    juce::Slider& slider) override;
     
+    //the two halves of drawRotarySlider, so the knobs can keep the body in a cached layer and only draw the pointer
+    void drawRotarySliderBody (juce::Graphics& g, juce::Rectangle<float> bounds);
+    void drawRotarySliderPointer (juce::Graphics& g, juce::Rectangle<float> bounds, float sliderPosProportional,
+                                  float rotaryStartAngle, float rotaryEndAngle, juce::Slider& slider);
+    
     void drawToggleButton (juce::Graphics &g,
                            juce::ToggleButton &toggleButton,
                            bool shouldDrawButtonAsHighlighted,
                            bool shouldDrawButtonAsDown) override;
 };
 
+//a layer that never changes between resizes (grid, labels, knob bodies) drawn once at the screen's physical
+//resolution and then just blitted. there's an image for each of the last maxScales scale factors it was painted at,
+//so moving the window between a retina and a normal screen doesn't redraw it either
+//while the size is changing paint stretches whatever image it already has, and the real redraw waits until the
+//size has stayed put for settleMs. each image is capped at maxPixels, past that it's drawn at a lower resolution
+//and scaled up, so the editor's memory stays bounded whatever size and screen it's on
+class CachedLayer : private juce::Timer
+{
+public:
+    static constexpr int settleMs = 150;
+    static constexpr int maxScales = 2;
+    
+    CachedLayer(juce::Component& owner, int maxPixels);
+    
+    //render draws the layer in the owner's coordinates, the scaling to the image is already done
+    void draw(juce::Graphics& g, const std::function<void(juce::Graphics&)>& render);
+    
+private:
+    struct Entry
+    {
+        float scale {0};
+        int width {0}, height {0};
+        juce::Image image;
+        juce::uint32 lastUsed {0};
+    };
+    
+    void timerCallback() override;
+    void Render(Entry& entry, int width, int height, float scale, const std::function<void(juce::Graphics&)>& render);
+    
+    juce::Component& owner;
+    int maxPixels;
+    std::array<Entry, maxScales> entries;
+    juce::uint32 useCounter {0};
+    int lastWidth {0}, lastHeight {0};
+    juce::uint32 sizeChangedAt {0};
+};
+
 //creating a struct for creating knobs because they will all be the same
 struct KnobWithText : juce::Slider
 {
@@ -36,7 +79,7 @@ struct KnobWithText : juce::Slider
     param(&rap),
     suffix(unitSuffix)
     {
-        setLookAndFeel(&lnf);
+        setLookAndFeel(lnf.get());
     }
     
     ~KnobWithText()
@@ -56,11 +99,37 @@ struct KnobWithText : juce::Slider
     juce::Rectangle<int> getSliderBounds() const;
     int getTextHeight() const {return 14;}
     juce::String getDisplayString() const;
+    //the editor moves the knobs between the two sets of parameters when the stereo mode is unlinked
+    void setParameter(juce::RangedAudioParameter& rap) { param = &rap; repaint(); }
     
     private:
-    LookAndFeel lnf;
+    static float GetStartAngle() { return juce::degreesToRadians(180.f + 45.f); }
+    static float GetEndAngle() { return juce::degreesToRadians(180.f - 45.f) + juce::MathConstants<float>::twoPi; }
+    //the body and the min/max labels, everything but the pointer and the value
+    void DrawStaticLayer(juce::Graphics& g);
+    
+    //one look and feel shared by every knob of every open editor
+    juce::SharedResourcePointer<LookAndFeel> lnf;
     juce::RangedAudioParameter* param;
     juce::String suffix;
+    CachedLayer staticLayer {*this, 1 << 19};
+};
+
+//attaches a slope knob to its choice parameter with the slopes in order of steepness (6, 12, 18 ... 96, then LR)
+//the parameter keeps its choices in the order they were added, so saved sessions and automation keep their values
+class SlopeSliderAttachment : private juce::Slider::Listener
+{
+public:
+    SlopeSliderAttachment(juce::RangedAudioParameter& parameter, juce::Slider& slider);
+    ~SlopeSliderAttachment() override;
+    
+private:
+    void sliderValueChanged(juce::Slider*) override;
+    void sliderDragStarted(juce::Slider*) override;
+    void sliderDragEnded(juce::Slider*) override;
+    
+    juce::Slider& slider;
+    juce::ParameterAttachment attachment;
 };
 
 struct ResponseCurveComponent: juce::Component, juce::AudioProcessorParameter::Listener, juce::Timer
@@ -74,15 +143,46 @@ struct ResponseCurveComponent: juce::Component, juce::AudioProcessorParameter::L
     void timerCallback() override;
     void paint(juce::Graphics& g) override;
     void resized() override;
+    //right click for the spectrogram settings, the match, the morph and the stereo mode
+    void mouseDown(const juce::MouseEvent& e) override;
+    
+    //called when the menu picks which set of parameters the knobs edit, 0 for the main set and 1 for the right/side set
+    std::function<void(int parameterSet)> onEditParameterSet;
     
     private:
     SimpleEQAudioProcessor& audioProcessor;
     juce::Atomic<bool> parametersChanged {false};
-    MonoChain monochain;
+    //every section of each set's curve that's switched on, the same designs the processor runs
+    //the second set is only drawn while the stereo mode gives the right/side channel its own settings
+    std::array<std::vector<BiquadCoefficients>, 2> sections;
+    bool linked {true};
+    int editedParameterSet {0};
     
     void UpdateGraph();
-    
-    juce::Image background;
+    void EditParameterSet(int parameterSet);
+    
+    //the curves only change with the parameters or the size, so they're built then and paint just strokes them
+    std::array<juce::Path, 2> responseCurves;
+    void UpdateResponseCurve();
+    
+    //the spectrogram behind the curve is a ring of columns: a new column overwrites the oldest one and paint draws
+    //the ring in two pieces, so it scrolls without the image ever being redrawn
+    juce::Image spectrogramImage;
+    int spectrogramWriteX {0};
+    std::array<juce::Colour, 256> spectrogramColours;
+    void DrawSpectrogramColumn(const uint8_t* levels, int numRows);
+    void ClearSpectrogram();
+    void ShowContextMenu();
+    void HandleMenuResult(int result);
+    
+    //the match's reference file or the automation trace, kept while the chooser is open
+    std::unique_ptr<juce::FileChooser> fileChooser;
+    void ChooseMatchReference();
+    void ChooseAutomationFile();
+    
+    //the grid and its labels
+    CachedLayer background {*this, 1 << 21};
+    void DrawBackground(juce::Graphics& g);
     juce::Rectangle<int> getRenderArea();
     juce::Rectangle<int> getAnalysisArea();
 };
@@ -122,25 +222,31 @@ private:
     using Attachment = apvts::SliderAttachment;
     
     //now we create the attachments
-    Attachment peakFreqSliderAttachment,
-               peakGainSliderAttachment,
-               peakQualitySliderAttachment,
-               lowCutFreqSliderAttachment,
-               lowCutSlopeSliderAttachment,
-               highCutFreqSliderAttachment,
-               highCutSlopeSliderAttachment;
+    //they're remade when the knobs move to the other set of parameters, so they're held by pointer
+    std::unique_ptr<Attachment> peakFreqSliderAttachment,
+                                peakGainSliderAttachment,
+                                peakQualitySliderAttachment,
+                                lowCutFreqSliderAttachment,
+                                highCutFreqSliderAttachment;
+    
+    //the slope knobs show the choices in a different order to the parameter's
+    std::unique_ptr<SlopeSliderAttachment> lowCutSlopeSliderAttachment,
+                                           highCutSlopeSliderAttachment;
     
     juce::ToggleButton lowCutBypassButton, peakBypassButton, highCutBypassButton;
     
     using ButtonAttachment = apvts::ButtonAttachment;
     
-    ButtonAttachment lowCutBypassButtonAttachment,
-                     peakBypassButtonAttachment,
-                     highCutBypassButtonAttachment;
+    std::unique_ptr<ButtonAttachment> lowCutBypassButtonAttachment,
+                                      peakBypassButtonAttachment,
+                                      highCutBypassButtonAttachment;
+    
+    //points the knobs and buttons at one set of parameters, 0 for the main set and 1 for the right/side set
+    void AttachParameterSet(int parameterSet);
     
     //making vector to iterate through knobs
     std::vector<juce::Component*> GetComps();
-    LookAndFeel lnf;
+    juce::SharedResourcePointer<LookAndFeel> lnf;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessorEditor)
 };
@@ -1,5 +1,18 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "LinearPhaseEQ.h"
+#include "SvfEQ.h"
+#include "MultiBandEQ.h"
+#include "StateFormat.h"
+#include "PresetBank.h"
+#include "SnapshotMorph.h"
+#include "RenderEQ.h"
+#include "Crossover.h"
+#include "MatchEQ.h"
+#include "AutoGain.h"
+#include "AutomationRecorder.h"
+#include "Spectrogram.h"
+#include "Timeline.h"
 
 //==============================================================================
 SimpleEQAudioProcessor::SimpleEQAudioProcessor()
@@ -8,16 +21,40 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                       //the crossover bands, off until the host connects them
+                       .withOutput ("Crossover 1", juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("Crossover 2", juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("Crossover 3", juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("Crossover 4", juce::AudioChannelSet::stereo(), false)
                      #endif
                        )
 #endif
 {
+    leftLinearPhase = std::make_unique<LinearPhaseEQ>();
+    rightLinearPhase = std::make_unique<LinearPhaseEQ>();
+    leftSvf = std::make_unique<SvfEQ>();
+    rightSvf = std::make_unique<SvfEQ>();
+    renderEQ = std::make_unique<RenderEQ>();
+    multiBand = std::make_unique<MultiBandEQ>();
+    crossover = std::make_unique<Crossover>();
+    matchEQ = std::make_unique<MatchEQ>(apvts);
+    autoGain = std::make_unique<AutoGain>();
+    automationRecorder = std::make_unique<AutomationRecorder>(*this);
+    spectrogram = std::make_unique<SpectrogramAnalyser>();
+    
+    programCoefficients = std::make_unique<ProgramCoefficients>();
+    presetBank = std::make_unique<PresetBank>(apvts);
+    presetBank->loadBank(PresetBank::getDefaultBankFile());
+    
+    snapshotMorph = std::make_unique<SnapshotMorph>();
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
 {
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -60,43 +97,126 @@ double SimpleEQAudioProcessor::getTailLengthSeconds() const
 
 int SimpleEQAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return juce::jmax(1, presetBank->getNumPresets());   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                                                        // so this should be at least 1, even if you're not really implementing programs.
 }
 
 int SimpleEQAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void SimpleEQAudioProcessor::setCurrentProgram (int index)
 {
+    if(index < 0 || index >= presetBank->getNumPresets())
+        return;
+    
+    //the audio thread switches to the precomputed coefficients on its next block
+    //then the parameters are brought into line, by which point the chains already match them
+    RequestProgram(index);
+    presetBank->applyPresetParameters(index);
+    programParametersPending = false;
 }
 
 const juce::String SimpleEQAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return presetBank->getPresetName(index);
 }
 
 void SimpleEQAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    presetBank->renamePreset(index, newName);
+}
+
+void SimpleEQAudioProcessor::RequestProgram(int index)
+{
+    currentProgram = index;
+    programParametersPending = true;
+    pendingProgram = index;
+}
+
+void SimpleEQAudioProcessor::handleAsyncUpdate()
+{
+    //midi program changes arrive on the audio thread, the parameters are set from here
+    presetBank->applyPresetParameters(currentProgram);
+    programParametersPending = false;
 }
 
 //==============================================================================
 void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    //we need to create a ProcessSpec to tell our chain how it will process audio
+    //hosts call this again whenever the block size or transport state changes, sometimes in the middle of playback
+    //nothing we run depends on the block size (the render path splits up anything longer than it was prepared for),
+    //so unless the sample rate (or one of the fir or render settings) has changed
+    //the filters keep their coefficients and state and nothing gets allocated
+    auto sampleRateChanged = sampleRate != preparedSampleRate;
+    //the crossover's band buses aren't ours to filter, so this is just the main bus
+    auto numChannels = getMainBusNumOutputChannels();
+    
+    //the first call reads the environment and fills the kernel table, which has to happen here rather than on the first block
+    kernelVariant = BiquadKernels::GetActiveVariant(numChannels);
+    DBG("SimpleEQ biquad kernel: " << BiquadKernels::GetVariantName(kernelVariant));
+    
+    if(sampleRateChanged)
+    {
+        //the chains are plain coefficients with nothing to allocate, only the cascade's state needs clearing
+        chains.cascade.reset();
+        
+        UpdateAllFilters();
+        
+        leftSvf->prepare(sampleRate, 2);
+        rightSvf->prepare(sampleRate, 1);
+        
+        peakDynamics.prepare(sampleRate);
+        
+        //redesign every preset for the new sample rate in the background
+        appliedProgram = -1;
+        presetBank->precompute(sampleRate);
+    }
+    
+    //the fir length and partition size choices are powers of 2 so we can shift
+    //4096, 8192, 16384, 32768 and 64, 128, ... 2048
+    auto firLength = 4096 << int(apvts.getRawParameterValue("FirLength")->load());
+    auto partitionSize = 64 << int(apvts.getRawParameterValue("PartitionSize")->load());
+    if(sampleRateChanged || firLength != preparedFirLength || partitionSize != preparedPartitionSize)
+    {
+        leftLinearPhase->prepare(sampleRate, 2, firLength, partitionSize);
+        rightLinearPhase->prepare(sampleRate, 1, firLength, partitionSize);
+    }
     
-    juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock; //how many samples per block/how many it will process at once
-    spec.numChannels = 1; //how many channels to process
-    spec.sampleRate = sampleRate; //sample rate
+    svfActive = apvts.getRawParameterValue("FilterEngine")->load() > 0.5f;
+    
+    //the render path is prepared whenever it's switched on, not just when we're told we're rendering,
+    //because some hosts start a bounce without preparing again
+    auto renderQuality = apvts.getRawParameterValue("RenderQuality")->load() > 0.5f;
+    auto oversamplingFactor = 1 << int(apvts.getRawParameterValue("RenderOversampling")->load());
+    auto renderThreads = apvts.getRawParameterValue("RenderMultithreaded")->load() > 0.5f;
+    if(renderQuality && (sampleRateChanged || numChannels != preparedNumChannels || oversamplingFactor != preparedOversamplingFactor
+                         || renderThreads != preparedRenderThreads || !renderEQ->isPrepared()))
+    {
+        renderEQ->prepare(sampleRate, numChannels, samplesPerBlock, oversamplingFactor, renderThreads);
+        preparedOversamplingFactor = oversamplingFactor;
+        preparedRenderThreads = renderThreads;
+    }
     
-    //now we pass this spec to each chain
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    linearPhaseActive = apvts.getRawParameterValue("LinearPhase")->load() > 0.5f;
+    renderActive = IsRenderPathEnabled();
+    UpdateLatency();
     
-    UpdateAllFilters();
+    if(sampleRateChanged || numChannels != preparedNumChannels)
+    {
+        multiBand->prepare(sampleRate, numChannels);
+        multiBand->setChainSettings(getChainSettings(apvts));
+        crossover->prepare(sampleRate, numChannels);
+        autoGain->prepare(sampleRate);
+    }
+    matchEQ->prepare(sampleRate);
+    spectrogram->prepare(sampleRate);
+    
+    preparedSampleRate = sampleRate;
+    preparedFirLength = firLength;
+    preparedPartitionSize = partitionSize;
+    preparedNumChannels = numChannels;
 }
 
 void SimpleEQAudioProcessor::releaseResources()
@@ -124,7 +244,25 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+    
+    // The sidechain is optional, but if the host connects it it has to be mono or stereo
+    if (layouts.inputBuses.size() > 1)
+    {
+        auto sidechain = layouts.getChannelSet(true, 1);
+        if (! sidechain.isDisabled()
+         && sidechain != juce::AudioChannelSet::mono()
+         && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
+    
+    // The crossover band outputs are optional too, and each one has the same channels as the main output
+    for (int bus = 1; bus < layouts.outputBuses.size(); bus++)
+    {
+        auto band = layouts.getChannelSet(false, bus);
+        if (! band.isDisabled() && band != layouts.getMainOutputChannelSet())
+            return false;
+    }
 
     return true;
   #endif
@@ -134,6 +272,8 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 //THIS IS WHERE WE GET THE BLOCK OF AUDIO DATA IN THE FORM OF A BUFFER AND MIDI MESSAGES
 void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    SIMPLEEQ_TIMELINE_THREAD("Audio");
+    SIMPLEEQ_TIMELINE_SCOPE("processBlock");
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -141,22 +281,463 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
+    //the parameters as this block sees them, before anything below acts on them
+    automationRecorder->recordBlock(buffer.getNumSamples());
+    
+    //program changes from midi are handled before anything else so they land in this block
+    for(const auto metadata : midiMessages)
+    {
+        auto message = metadata.getMessage();
+        if(message.isProgramChange() && message.getProgramChangeNumber() < presetBank->getNumPresets())
+        {
+            RequestProgram(message.getProgramChangeNumber());
+            triggerAsyncUpdate();
+        }
+    }
+    
+    ApplyPendingProgram();
+    
     //1. Update filter coefficients based on knob parameters
-    UpdateAllFilters();
+    //each side is only redesigned when its own parameters have changed
+    //until a new program's parameters have landed we keep using the program's settings, so nothing gets redesigned
+    ChainSettings leftSettings, rightSettings;
+    auto stereoMode = static_cast<StereoMode>(int(apvts.getRawParameterValue("StereoMode")->load()));
+    if(programParametersPending && appliedProgram == currentProgram)
+    {
+        leftSettings = programCoefficients->left;
+        rightSettings = programCoefficients->right;
+        stereoMode = static_cast<StereoMode>(programCoefficients->stereoMode);
+    }
+    else
+    {
+        GetSideChainSettings(leftSettings, rightSettings);
+    }
+    
+    //while morphing the chains only get the cheap closed form designs, and only as often as the morph moves
+    auto morphEnabled = apvts.getRawParameterValue("MorphEnabled")->load() > 0.5f;
+    auto morphPosition = apvts.getRawParameterValue("Morph")->load();
+    auto morphing = morphEnabled && snapshotMorph->getMorphedSettings(morphPosition, buffer.getNumSamples(), leftSettings, rightSettings);
+    
+    //linked, or two sets that happen to match: every design is worked out for the left side and copied to the right
+    auto sidesMatch = leftSettings == rightSettings;
+    auto linked = stereoMode == StereoMode::Linked;
+    if(stereoMode != activeStereoMode)
+    {
+        activeStereoMode = stereoMode;
+        leftLinearPhase->reset();
+        rightLinearPhase->reset();
+        leftSvf->reset();
+        rightSvf->reset();
+    }
+    
+    if(morphing)
+    {
+        UpdateChainFiltersClosedForm(chains.left, leftChainSettings, leftSettings);
+        if(sidesMatch)
+            CopyLeftChainToRight();
+        else
+            UpdateChainFiltersClosedForm(chains.right, rightChainSettings, rightSettings);
+    }
+    else
+    {
+        UpdateAllFilters(leftSettings, rightSettings);
+    }
+    
+    //the render designs follow along during playback too, so a bounce starts with them already in place
+    renderEQ->setChainSettings(leftSettings, rightSettings);
+    
+    //the firs are only designed while they're in use, a design is a few big ffts on the pool for every knob move
+    //switching on asks for the current settings, until they land it plays the last kernel it had (silence if it never
+    //had one, the same as at load) and then crossfades like any other change
+    auto linearPhaseEnabled = apvts.getRawParameterValue("LinearPhase")->load() > 0.5f;
+    if(linearPhaseEnabled)
+    {
+        leftLinearPhase->setChainSettings(leftSettings);
+        if(!linked)
+            rightLinearPhase->setChainSettings(rightSettings);
+    }
+    
+    if(linearPhaseEnabled != linearPhaseActive)
+    {
+        linearPhaseActive = linearPhaseEnabled;
+        //throw away whatever audio was left in the firs from the last time they were on
+        leftLinearPhase->reset();
+        rightLinearPhase->reset();
+        UpdateLatency();
+    }
     
     //the processorchain requires a processing context to run audio through the chain
     //we need to extract left channel and right channel from the block given from the DAW
     //2. Initializing a block with our buffer
-    juce::dsp::AudioBlock<float> block(buffer);
+    //the buffer also holds the sidechain channels so we only take the main bus
+    auto mainBuffer = getBusBuffer(buffer, false, 0);
+    juce::dsp::AudioBlock<float> block(mainBuffer);
+    
+    //a match capture wants the input before anything has touched it
+    matchEQ->pushInput(block);
+    
+    //so does the auto gain's loudness measurement, the makeup for this block is worked out straight away
+    auto autoGainEnabled = apvts.getRawParameterValue("AutoGain")->load() > 0.5f;
+    if(autoGainEnabled != autoGainActive)
+    {
+        autoGainActive = autoGainEnabled;
+        autoGain->reset();
+    }
+    if(autoGainActive)
+    {
+        autoGain->setChainSettings(leftSettings, rightSettings);
+        autoGain->measureInput(block);
+        autoGain->updateGain((int) block.getNumSamples());
+    }
+    
+    //mid = (l + r) / 2 and side = (l - r) / 2, then l = mid + side and r = mid - side
+    //no pass of its own: whichever engine runs first encodes as it reads, and whatever runs last decodes as it writes
+    auto midSide = stereoMode == StereoMode::MidSide && block.getNumChannels() > 1;
+    
+    if(linearPhaseActive)
+    {
+        //the firs replace the whole iir chain
+        if(midSide)
+        {
+            //the mid fir encodes on the way into its fifo and the side fir decodes on the way out of its own
+            leftLinearPhase->process(block, LinearPhaseEQ::MidSide::encodeMid);
+            rightLinearPhase->process(block, LinearPhaseEQ::MidSide::decodeSide);
+        }
+        else if(linked)
+        {
+            //one fir, one design, both channels
+            leftLinearPhase->process(block);
+        }
+        else
+        {
+            auto leftBlock = block.getSingleChannelBlock(0);
+            leftLinearPhase->process(leftBlock);
+            if(block.getNumChannels() > 1)
+            {
+                auto rightBlock = block.getSingleChannelBlock(1);
+                rightLinearPhase->process(rightBlock);
+            }
+        }
+        
+        if(autoGainActive)
+        {
+            autoGain->applyGain(block);
+            autoGain->measureOutput(block);
+        }
+        spectrogram->pushOutput(block);
+        ProcessCrossover(buffer, block);
+        return;
+    }
+    
+    auto svfEnabled = apvts.getRawParameterValue("FilterEngine")->load() > 0.5f;
+    if(svfEnabled != svfActive)
+    {
+        svfActive = svfEnabled;
+        leftSvf->reset();
+        rightSvf->reset();
+    }
+    
+    //offline bounces get the oversampled double precision path, playback goes back to the lean one
+    auto renderEnabled = IsRenderPathEnabled();
+    if(renderEnabled != renderActive)
+    {
+        renderActive = renderEnabled;
+        renderEQ->reset();
+        UpdateLatency();
+    }
+    
+    //the extra bands are already baked into the fir, for the other engines they run afterwards
+    //they are always linked, so they use the first set
+    multiBand->setChainSettings(leftSettings);
+    
+    auto peakDynamicSettings = getPeakDynamicSettings(apvts);
+    auto peakDynamic = peakDynamicSettings.enabled && !leftSettings.peakBypassed;
+    if(!peakDynamic)
+    {
+        RestoreStaticPeakFilter(chains.left, leftChainSettings);
+        if(sidesMatch)
+            CopyLeftChainToRight();
+        else
+            RestoreStaticPeakFilter(chains.right, rightChainSettings);
+    }
+    
+    if(peakDynamic)
+    {
+        peakDynamics.setDetector(leftSettings.peakFreq, leftSettings.peakQuality);
+        peakDynamics.setDynamics(peakDynamicSettings);
+        
+        //listen to the sidechain if it's asked for and the host has actually connected it, otherwise the input
+        //the input is heard as mid/side in mid/side mode, the way the eq sees it, and the sidechain as it comes
+        juce::dsp::AudioBlock<float> detectorBlock(block);
+        auto detectorMidSide = midSide;
+        if(peakDynamicSettings.useSidechain && getBusCount(true) > 1)
+        {
+            auto numSidechainChannels = getChannelCountOfBus(true, 1);
+            if(numSidechainChannels > 0)
+            {
+                detectorBlock = juce::dsp::AudioBlock<float>(buffer).getSubsetChannelBlock((size_t) getChannelIndexInProcessBlockBuffer(true, 1, 0),
+                                                                                            (size_t) numSidechainChannels);
+                detectorMidSide = false;
+            }
+        }
+        
+        auto numSamples = block.getNumSamples();
+        if(renderActive)
+        {
+            //the render path gets as much of the block as it can take in one go, with every control period's gain
+            //worked out up front. the detector hears the same thing, it still sees each period before it gets eq'd
+            auto chunkLength = size_t(RenderEQ::maxPeakPeriods * DynamicBand::controlInterval);
+            for(size_t chunk = 0; chunk < numSamples; chunk += chunkLength)
+            {
+                auto chunkBlock = block.getSubBlock(chunk, juce::jmin(chunkLength, numSamples - chunk));
+                for(size_t start = 0; start < chunkBlock.getNumSamples(); start += DynamicBand::controlInterval)
+                {
+                    auto length = juce::jmin(size_t(DynamicBand::controlInterval), chunkBlock.getNumSamples() - start);
+                    auto gainChange = peakDynamics.process(detectorBlock.getSubBlock(chunk + start, length), detectorMidSide);
+                    renderEQ->addPeakGains(juce::jmax(-48.f, leftSettings.peakGainInDb + gainChange),
+                                           juce::jmax(-48.f, rightSettings.peakGainInDb + gainChange));
+                }
+                
+                renderEQ->process(chunkBlock, midSide);
+            }
+        }
+        else
+        {
+            //run the chain in control periods, working out the band's gain before each one
+            for(size_t start = 0; start < numSamples; start += DynamicBand::controlInterval)
+            {
+                auto length = juce::jmin(size_t(DynamicBand::controlInterval), numSamples - start);
+                //the detector has to see this period before it gets eq'd in place
+                auto gainChange = peakDynamics.process(detectorBlock.getSubBlock(start, length), detectorMidSide);
+                
+                //both sides move by the same amount from their own static gain
+                auto leftDynamic = leftSettings;
+                auto rightDynamic = rightSettings;
+                leftDynamic.peakGainInDb = juce::jmax(-48.f, leftSettings.peakGainInDb + gainChange);
+                rightDynamic.peakGainInDb = juce::jmax(-48.f, rightSettings.peakGainInDb + gainChange);
+                
+                auto subBlock = block.getSubBlock(start, length);
+                if(!svfActive)
+                {
+                    UpdateDynamicPeakGain(chains.left, leftChainSettings, leftDynamic.peakGainInDb);
+                    if(sidesMatch)
+                        CopyLeftChainToRight();
+                    else
+                        UpdateDynamicPeakGain(chains.right, rightChainSettings, rightDynamic.peakGainInDb);
+                }
+                
+                ProcessChains(subBlock, leftDynamic, rightDynamic, midSide, linked);
+            }
+        }
+    }
+    else if(renderActive)
+    {
+        //the chain and the extra bands in one go
+        renderEQ->process(block, midSide);
+    }
+    else
+    {
+        ProcessChains(block, leftSettings, rightSettings, midSide, linked);
+    }
+    
+    //6. Run the extra bands over both channels
+    //in mid/side mode the decode back to left/right happens inside the same loop, and so does the auto gain's makeup
+    if(!renderActive)
+        multiBand->process(block, midSide, autoGainActive ? autoGain->getStartGain() : 1.f, autoGainActive ? autoGain->getEndGain() : 1.f);
+    else if(autoGainActive)
+        autoGain->applyGain(block);
+    
+    if(autoGainActive)
+        autoGain->measureOutput(block);
+    spectrogram->pushOutput(block);
+    
+    //7. Split the result into the crossover bands
+    ProcessCrossover(buffer, block);
+}
+
+void SimpleEQAudioProcessor::ProcessCrossover(juce::AudioBuffer<float>& buffer, const juce::dsp::AudioBlock<float>& block)
+{
+    //the band buses are views straight onto the host's channels, so the crossover writes the bands in place
+    std::array<juce::dsp::AudioBlock<float>, Crossover::maxBands> bands;
+    for(int band = 0; band < Crossover::maxBands && band + 1 < getBusCount(false); band++)
+    {
+        if(getChannelCountOfBus(false, band + 1) > 0)
+            bands[(size_t) band] = juce::dsp::AudioBlock<float>(buffer).getSubsetChannelBlock((size_t) getChannelIndexInProcessBlockBuffer(false, band + 1, 0),
+                                                                                                  (size_t) getChannelCountOfBus(false, band + 1));
+    }
+    
+    auto crossoverSettings = getCrossoverSettings(apvts);
+    crossover->setSettings(crossoverSettings);
+    crossover->process(block, bands);
+    
+    //the band buses share their channels with the inputs (the sidechain lands in the first one),
+    //so whatever the crossover isn't writing to has to be cleared
+    auto numActiveBands = crossover->isActive() ? crossoverSettings.numBands : 0;
+    for(int band = numActiveBands; band < Crossover::maxBands; band++)
+        bands[(size_t) band].clear();
+}
+
+void SimpleEQAudioProcessor::ApplyPendingProgram()
+{
+    auto program = pendingProgram.exchange(-1);
+    if(program < 0)
+        return;
+    
+    //if the background designs aren't ready yet the parameters will be designed the normal way when they land
+    if(!presetBank->getProgramCoefficients(program, getSampleRate(), *programCoefficients))
+        return;
+    
+    ApplySideCoefficients(chains.left, leftChainSettings, programCoefficients->leftCoefficients, programCoefficients->left);
+    if(programCoefficients->right == programCoefficients->left)
+        CopyLeftChainToRight();
+    else
+        ApplySideCoefficients(chains.right, rightChainSettings, programCoefficients->rightCoefficients, programCoefficients->right);
+    appliedProgram = program;
+}
+
+void SimpleEQAudioProcessor::ApplySideCoefficients(PackedChain& chain, ChainSettings& currentSettings, const SideCoefficients& coefficients, const ChainSettings& chainSettings)
+{
+    //just copies, the designing was done on the preset bank's thread
+    CopyCutFilter(chain, PackedChain::lowCutStage, coefficients.lowCut, static_cast<Slope>(chainSettings.lowCutSlope), chainSettings.lowCutBypassed);
+    CopyPeakFilter(chain, coefficients.peak, chainSettings.peakBypassed);
+    CopyCutFilter(chain, PackedChain::highCutStage, coefficients.highCut, static_cast<Slope>(chainSettings.highCutSlope), chainSettings.highCutBypassed);
+    
+    //UpdateChainFilters compares against this, so matching parameters won't be redesigned
+    currentSettings = chainSettings;
+}
+
+void SimpleEQAudioProcessor::UpdateChainFiltersClosedForm(PackedChain& chain, ChainSettings& currentSettings, const ChainSettings& chainSettings)
+{
+    if(chainSettingsValid && chainSettings == currentSettings)
+        return;
+    
+    ApplySideCoefficients(chain, currentSettings, MakeSideCoefficients(chainSettings, getSampleRate()), chainSettings);
+}
+
+void SimpleEQAudioProcessor::storeSnapshot(int slot)
+{
+    ChainSettings leftSettings, rightSettings;
+    GetSideChainSettings(leftSettings, rightSettings);
+    snapshotMorph->setSnapshot(slot, leftSettings, rightSettings);
+    
+    //the snapshots are saved with the state, so the host should know it changed
+    updateHostDisplay(ChangeDetails().withNonParameterStateChanged(true));
+}
+
+void SimpleEQAudioProcessor::clearSnapshot(int slot)
+{
+    snapshotMorph->clearSnapshot(slot);
+    updateHostDisplay(ChangeDetails().withNonParameterStateChanged(true));
+}
+
+void SimpleEQAudioProcessor::setEditorVisible(bool isVisible)
+{
+    auto priority = isVisible ? WorkerPool::visible : WorkerPool::normal;
+    leftLinearPhase->setWorkerPriority(priority);
+    rightLinearPhase->setWorkerPriority(priority);
+    presetBank->setWorkerPriority(priority);
+    matchEQ->setWorkerPriority(priority);
+}
+
+SimpleEQAudioProcessor::MemoryFootprint SimpleEQAudioProcessor::getMemoryFootprint() const
+{
+    MemoryFootprint footprint;
+    //the chains, the cascade and the dynamics are all inside the processor itself, the auto gain is small enough to count with it
+    footprint.processor = sizeof(*this) + sizeof(ProgramCoefficients) + sizeof(AutoGain);
+    footprint.linearPhase = leftLinearPhase->getMemoryUsageInBytes() + rightLinearPhase->getMemoryUsageInBytes();
+    footprint.svf = leftSvf->getMemoryUsageInBytes() + rightSvf->getMemoryUsageInBytes();
+    footprint.multiBand = sizeof(MultiBandEQ);
+    footprint.presets = presetBank->getMemoryUsageInBytes();
+    footprint.morph = sizeof(SnapshotMorph);
+    footprint.render = renderEQ->getMemoryUsageInBytes();
+    footprint.crossover = sizeof(Crossover);
+    footprint.match = matchEQ->getMemoryUsageInBytes();
+    footprint.recorder = automationRecorder->getMemoryUsageInBytes();
+    footprint.spectrogram = spectrogram->getMemoryUsageInBytes();
+    return footprint;
+}
+
+bool SimpleEQAudioProcessor::hasPendingDesigns() const
+{
+    //only the firs are designed in the background, everything else is designed on the audio thread when it's needed
+    return linearPhaseActive && (leftLinearPhase->isDesignPending() || rightLinearPhase->isDesignPending());
+}
+
+bool SimpleEQAudioProcessor::IsRenderPathEnabled()
+{
+    //the svf engine is picked for how it modulates, so it stays as it is when rendering
+    return isNonRealtime() && !svfActive && renderEQ->isPrepared()
+        && apvts.getRawParameterValue("RenderQuality")->load() > 0.5f;
+}
+
+void SimpleEQAudioProcessor::UpdateLatency()
+{
+    //the fir replaces everything else, the render path included
+    if(linearPhaseActive)
+        setLatencySamples(leftLinearPhase->getLatencyInSamples());
+    else
+        setLatencySamples(renderActive ? renderEQ->getLatencyInSamples() : 0);
+}
+
+void SimpleEQAudioProcessor::ProcessChains(juce::dsp::AudioBlock<float>& block, const ChainSettings& leftSettings, const ChainSettings& rightSettings,
+                                           bool encodeMidSide, bool linked)
+{
     //3. Extract individual channels from block
     auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
-    //4. Create Processing Context for each channel
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
-    //5. Process left and right hain
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    auto hasRight = block.getNumChannels() > 1;
+    
+    if(svfActive)
+    {
+        //in mid/side the left svf takes both channels, encodes them sample by sample and leaves the side for the right one
+        //linked it runs both channels itself, so the per sample redesigns while a knob glides only happen once
+        leftSvf->setChainSettings(leftSettings);
+        if(linked)
+        {
+            leftSvf->process(block);
+            return;
+        }
+        if(encodeMidSide)
+            leftSvf->process(block, true);
+        else
+            leftSvf->process(leftBlock);
+        if(hasRight)
+        {
+            auto rightBlock = block.getSingleChannelBlock(1);
+            rightSvf->setChainSettings(rightSettings);
+            rightSvf->process(rightBlock);
+        }
+        return;
+    }
+    
+    //4. Gather the active stages of both chains into one cascade, left and right side by side
+    //5. Process both channels at once with the kernel picked for this cpu, encoding mid/side as they're gathered
+    UpdateChainCascade(hasRight ? 2 : 1);
+    chains.cascade.process(block, encodeMidSide);
+}
+
+void SimpleEQAudioProcessor::UpdateChainCascade(int numChannels)
+{
+    //just copies, a stage keeps its state in the cascade as long as one of the channels is using it
+    const PackedChain* sides[] = { &chains.left, &chains.right };
+    
+    chains.cascade.beginUpdate();
+    for(int stage = 0; stage < PackedChain::numStages; stage++)
+    {
+        for(int channel = 0; channel < numChannels; channel++)
+        {
+            if(sides[channel]->active[(size_t) stage])
+                chains.cascade.setSection(stage, channel, sides[channel]->stages[(size_t) stage]);
+        }
+    }
+    chains.cascade.endUpdate();
+}
+
+void SimpleEQAudioProcessor::GetSideChainSettings(ChainSettings& leftSettings, ChainSettings& rightSettings)
+{
+    //in stereo mode both sides follow the first set of parameters
+    auto stereoMode = static_cast<StereoMode>(int(apvts.getRawParameterValue("StereoMode")->load()));
+    leftSettings = getChainSettings(apvts);
+    rightSettings = stereoMode == StereoMode::Linked ? leftSettings : getChainSettings(apvts, 1);
 }
 
 //==============================================================================
@@ -177,13 +758,29 @@ juce::AudioProcessorEditor* SimpleEQAudioProcessor::createEditor()
 void SimpleEQAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
     //we are creating a way to save parameters when opening and closing the plugin
-    juce::MemoryOutputStream memoryOutputStream (destData, true);
-    apvts.state.writeToStream(memoryOutputStream);
+    //the state is a small fixed layout binary blob (see StateFormat.h) rather than the whole ValueTree
+    StateFormat::WriteBinaryState(apvts, destData);
+    
+    //the morph snapshots go after the parameters
+    juce::MemoryOutputStream stream (destData, true);
+    snapshotMorph->writeToStream(stream);
 }
 
 void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {  
     //here we restore the saved parameters from memory
+    //the binary format goes straight into the parameters
+    if(StateFormat::ReadBinaryState(apvts, data, sizeInBytes))
+    {
+        auto parametersSize = StateFormat::GetBinaryStateSize(data, sizeInBytes);
+        juce::MemoryInputStream stream (static_cast<const char*>(data) + parametersSize, size_t(sizeInBytes - parametersSize), false);
+        snapshotMorph->readFromStream(stream);
+        
+        UpdateAllFilters();
+        return;
+    }
+    
+    //sessions saved before the binary format are a ValueTree
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     if(tree.isValid())
     {
@@ -192,79 +789,180 @@ void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBy
     }
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts, int parameterSet)
 {
-    ChainSettings settings;
-    
     //get values from apvts
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCutFreq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HiCutFreq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("PeakFreq")->load();
-    settings.peakGainInDb = apvts.getRawParameterValue("PeakGain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("PeakQ")->load();
-    settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue("LowCutSlope")->load());
-    settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue("HiCutSlope")->load());
-    settings.lowCutBypassed = apvts.getRawParameterValue("LowCutBypassed")->load() > 0.5f;
-    settings.highCutBypassed = apvts.getRawParameterValue("HighCutBypassed")->load() > 0.5f;
-    settings.peakBypassed = apvts.getRawParameterValue("PeakBypassed")->load() > 0.5f;
+    return ReadChainSettings([&apvts](const juce::String& id) { return apvts.getRawParameterValue(id)->load(); }, parameterSet);
+}
+
+DynamicSettings getPeakDynamicSettings(juce::AudioProcessorValueTreeState& apvts)
+{
+    DynamicSettings settings;
+    
+    settings.enabled = apvts.getRawParameterValue("PeakDynamic")->load() > 0.5f;
+    settings.useSidechain = apvts.getRawParameterValue("PeakSidechain")->load() > 0.5f;
+    settings.thresholdInDb = apvts.getRawParameterValue("PeakThreshold")->load();
+    settings.ratio = apvts.getRawParameterValue("PeakRatio")->load();
+    settings.attackMs = apvts.getRawParameterValue("PeakAttack")->load();
+    settings.releaseMs = apvts.getRawParameterValue("PeakRelease")->load();
     
     return settings;
 }
 
-Coefficients MakePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+const ChainParameterIDs& GetChainParameterIDs(int parameterSet)
 {
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, chainSettings.peakFreq, chainSettings.peakQuality, juce::Decibels::decibelsToGain(chainSettings.peakGainInDb));
+    static const auto table = []
+    {
+        std::array<ChainParameterIDs, 2> ids;
+        ids[0] = { "LowCutFreq", "HiCutFreq", "PeakFreq", "PeakGain", "PeakQ",
+                   "LowCutSlope", "HiCutSlope", "LowCutBypassed", "PeakBypassed", "HighCutBypassed" };
+        
+        const auto& main = ids[0];
+        ids[1] = { main.lowCutFreq + "2", main.highCutFreq + "2", main.peakFreq + "2", main.peakGain + "2", main.peakQuality + "2",
+                   main.lowCutSlope + "2", main.highCutSlope + "2", main.lowCutBypassed + "2", main.peakBypassed + "2", main.highCutBypassed + "2" };
+        return ids;
+    }();
+    
+    jassert(parameterSet == 0 || parameterSet == 1);
+    return table[(size_t) parameterSet];
 }
 
-void UpdateCoefficients(Coefficients &old, const Coefficients &replacement)
+const BandParameterIDs& GetBandParameterIDs(int bandIndex)
 {
-    *old = *replacement;
+    //built the first time we ask for them and never touched again
+    static const auto table = []
+    {
+        std::array<BandParameterIDs, ChainSettings::numExtraBands> ids;
+        for (int i = 0; i < ChainSettings::numExtraBands; i++)
+        {
+            juce::String prefix ("Band" + juce::String(i + 1));
+            ids[(size_t) i] = { prefix + "Type", prefix + "Freq", prefix + "Gain", prefix + "Q", prefix + "Enabled" };
+        }
+        return ids;
+    }();
+    
+    jassert(bandIndex >= 0 && bandIndex < ChainSettings::numExtraBands);
+    return table[(size_t) bandIndex];
 }
 
-void SimpleEQAudioProcessor::UpdateLowCutFilters(const ChainSettings &chainSettings)
+void CopyCutFilter(PackedChain& chain, int firstStage, const std::array<BiquadCoefficients, maxCutSections>& sections, const Slope& slope, bool bypassed)
 {
-    auto lowCutCoefficients = MakeLowCutFilter(chainSettings, getSampleRate());
-    //remember we need to split channels
-    auto &leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto &rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    //only the sections the slope uses are switched on, the rest pass straight through
+    auto numSections = GetNumCutSections(slope);
+    for (int i = 0; i < maxCutSections; i++)
+    {
+        chain.stages[(size_t) (firstStage + i)] = sections[(size_t) i];
+        chain.active[(size_t) (firstStage + i)] = !bypassed && i < numSections;
+    }
+}
+
+void CopyPeakFilter(PackedChain& chain, const BiquadCoefficients& peak, bool bypassed)
+{
+    chain.stages[PackedChain::peakStage] = peak;
+    chain.active[PackedChain::peakStage] = !bypassed;
+    chain.peakIsDynamic = false;
+}
+
+SideCoefficients MakeSideCoefficients(const ChainSettings& chainSettings, double sampleRate)
+{
+    SideCoefficients side;
     
-    leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+    MakeLowCutSections(chainSettings, sampleRate, side.lowCut);
+    MakeHighCutSections(chainSettings, sampleRate, side.highCut);
     
-    UpdateCutFilter(leftLowCut, lowCutCoefficients, static_cast<Slope>(chainSettings.lowCutSlope));
-    UpdateCutFilter(rightLowCut, lowCutCoefficients, static_cast<Slope>(chainSettings.lowCutSlope));
+    side.peak = MakeBellBiquad(sampleRate, chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDb);
+    return side;
 }
 
-void SimpleEQAudioProcessor::UpdateHighCutFilters(const ChainSettings &chainSettings)
+void SimpleEQAudioProcessor::UpdateLowCutFilters(PackedChain& chain, const ChainSettings &chainSettings)
 {
-    auto highCutCoefficients = MakeHighCutFilter(chainSettings, getSampleRate());
-    auto &leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto &rightHighCut = rightChain.get<ChainPositions::HighCut>();
+    SIMPLEEQ_TIMELINE_SCOPE("LowCut design");
+    std::array<BiquadCoefficients, maxCutSections> sections {};
+    MakeLowCutSections(chainSettings, getSampleRate(), sections);
     
-    leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    CopyCutFilter(chain, PackedChain::lowCutStage, sections, static_cast<Slope>(chainSettings.lowCutSlope), chainSettings.lowCutBypassed);
+}
+
+void SimpleEQAudioProcessor::UpdateHighCutFilters(PackedChain& chain, const ChainSettings &chainSettings)
+{
+    SIMPLEEQ_TIMELINE_SCOPE("HighCut design");
+    std::array<BiquadCoefficients, maxCutSections> sections {};
+    MakeHighCutSections(chainSettings, getSampleRate(), sections);
+    
+    CopyCutFilter(chain, PackedChain::highCutStage, sections, static_cast<Slope>(chainSettings.highCutSlope), chainSettings.highCutBypassed);
+}
+
+void SimpleEQAudioProcessor::UpdatePeakFilter(PackedChain& chain, const ChainSettings& chainSettings)
+{
+    SIMPLEEQ_TIMELINE_SCOPE("Peak design");
+    auto peak = MakeBellBiquad(getSampleRate(), chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDb);
     
-    UpdateCutFilter(leftHighCut, highCutCoefficients, static_cast<Slope>(chainSettings.highCutSlope));
-    UpdateCutFilter(rightHighCut, highCutCoefficients, static_cast<Slope>(chainSettings.highCutSlope));
+    CopyPeakFilter(chain, peak, chainSettings.peakBypassed);
 }
 
-void SimpleEQAudioProcessor::UpdatePeakFilter(const ChainSettings& chainSettings)
+void SimpleEQAudioProcessor::UpdateChainFilters(PackedChain& chain, ChainSettings& currentSettings, const ChainSettings& chainSettings)
 {
-    auto peakCoefficients = MakePeakFilter(chainSettings, getSampleRate());
+    //only the bands whose knobs have moved get redesigned
+    auto redesignAll = !chainSettingsValid;
     
-    leftChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    rightChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
+    if(redesignAll || chainSettings.lowCutFreq != currentSettings.lowCutFreq || chainSettings.lowCutSlope != currentSettings.lowCutSlope
+       || chainSettings.lowCutBypassed != currentSettings.lowCutBypassed)
+        UpdateLowCutFilters(chain, chainSettings);
     
-    UpdateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    UpdateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    if(redesignAll || chainSettings.peakFreq != currentSettings.peakFreq || chainSettings.peakGainInDb != currentSettings.peakGainInDb
+       || chainSettings.peakQuality != currentSettings.peakQuality || chainSettings.peakBypassed != currentSettings.peakBypassed)
+        UpdatePeakFilter(chain, chainSettings);
+    
+    if(redesignAll || chainSettings.highCutFreq != currentSettings.highCutFreq || chainSettings.highCutSlope != currentSettings.highCutSlope
+       || chainSettings.highCutBypassed != currentSettings.highCutBypassed)
+        UpdateHighCutFilters(chain, chainSettings);
+    
+    currentSettings = chainSettings;
 }
 
 void SimpleEQAudioProcessor::UpdateAllFilters()
 {
-    auto chainSettings = getChainSettings(apvts);
-    UpdateLowCutFilters(chainSettings);
-    UpdatePeakFilter(chainSettings);
-    UpdateHighCutFilters(chainSettings);
+    //used when the sample rate or the whole state changes, so everything gets redesigned
+    chainSettingsValid = false;
+    
+    ChainSettings leftSettings, rightSettings;
+    GetSideChainSettings(leftSettings, rightSettings);
+    UpdateAllFilters(leftSettings, rightSettings);
+}
+
+void SimpleEQAudioProcessor::UpdateAllFilters(const ChainSettings& leftSettings, const ChainSettings& rightSettings)
+{
+    SIMPLEEQ_TIMELINE_SCOPE("UpdateAllFilters");
+    UpdateChainFilters(chains.left, leftChainSettings, leftSettings);
+    if(rightSettings != leftSettings)
+        UpdateChainFilters(chains.right, rightChainSettings, rightSettings);
+    else if(!chainSettingsValid || rightChainSettings != leftSettings)
+        CopyLeftChainToRight();
+    chainSettingsValid = true;
+}
+
+void SimpleEQAudioProcessor::CopyLeftChainToRight()
+{
+    //a few hundred bytes of coefficients, the dynamic peak's gain included
+    chains.right = chains.left;
+    rightChainSettings = leftChainSettings;
+}
+
+void SimpleEQAudioProcessor::UpdateDynamicPeakGain(PackedChain& chain, const ChainSettings& currentSettings, float gainInDb)
+{
+    //closed form design written straight into the existing coefficients
+    //no allocation so it's cheap enough to run every control period
+    chain.stages[PackedChain::peakStage] = MakeBellBiquad(getSampleRate(), currentSettings.peakFreq, currentSettings.peakQuality, gainInDb);
+    
+    //the settings keep the static gain, so UpdateChainFilters only redesigns the peak when its knobs move
+    chain.peakIsDynamic = true;
+}
+
+void SimpleEQAudioProcessor::RestoreStaticPeakFilter(PackedChain& chain, const ChainSettings& currentSettings)
+{
+    //once, when the dynamics stop
+    if(chain.peakIsDynamic)
+        UpdatePeakFilter(chain, currentSettings);
 }
 
 //DECLARING THE AUDIOPROCESSORVALUETREESTATE PARAMETER LAYOUT
@@ -291,26 +989,119 @@ juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::crea
     layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("PeakQ", 1), "Q",
         juce::NormalisableRange<float>(.1f, 10.f, .05f, 1.), 1.f));
     
-    //our low and high cut bands will have 4 choices of steepness to their cutoff
+    //our low and high cut bands have a choice of steepness to their cutoff, in the same order as the Slope enum
+    //new slopes only ever go on the end, so the choices saved sessions and automation point at don't move
     //so we create a JUCE choice parameter which takes a string array with your choices
     
     //creating the string array of choices
     juce::StringArray cutoffChoiceStringArray;
-    for (int i = 0; i < 4; i++)
+    for (int i = 0; i < numSlopes; i++)
     {
         juce::String str; //make a new string
-        str << (12 + i*12); //12, 24, 36, 48
+        if (i >= Slope::Slope_LR12)
+            str << "LR "; //linkwitz-riley
+        str << GetCutSectionTable(i).order * 6; //6db per order
         str << " db/Oct"; //append with db/oct
         cutoffChoiceStringArray.add(str); //add to array
     }
     
     //creating the audioparameter choices
-    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("LowCutSlope", 1), "LowCut Slope", cutoffChoiceStringArray, 0));
-    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("HiCutSlope", 1), "HiCut Slope", cutoffChoiceStringArray, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("LowCutSlope", 1), "LowCut Slope", cutoffChoiceStringArray, Slope::Slope_12));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("HiCutSlope", 1), "HiCut Slope", cutoffChoiceStringArray, Slope::Slope_12));
     
     layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("LowCutBypassed", 1), "LowCut Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("PeakBypassed", 1), "Peak Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("HighCutBypassed", 1), "HighCut Bypassed", false));
+    
+    //how the channels are processed, and the second set of knobs for the right or side channel
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("StereoMode", 1), "Stereo Mode",
+                                                            juce::StringArray {"Stereo", "Left/Right", "Mid/Side"}, 0));
+    
+    const auto& sideIds = GetChainParameterIDs(1);
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(sideIds.lowCutFreq, 1), "LowCut Freq 2",
+                                                           juce::NormalisableRange<float>(20.f, 20000.f, 1.f, .25f), 20.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(sideIds.highCutFreq, 1), "HiCut Freq 2",
+                                                           juce::NormalisableRange<float>(20.f, 20000.f, 1.f, .25f), 20000.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(sideIds.peakFreq, 1), "Peak Freq 2",
+                                                           juce::NormalisableRange<float>(20.f, 20000.f, 1.f, .25f), 750.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(sideIds.peakGain, 1), "Peak Gain 2",
+                                                           juce::NormalisableRange<float>(-24.f, 24.f, .5f, 1.), 0.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(sideIds.peakQuality, 1), "Q 2",
+                                                           juce::NormalisableRange<float>(.1f, 10.f, .05f, 1.), 1.f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(sideIds.lowCutSlope, 1), "LowCut Slope 2", cutoffChoiceStringArray, Slope::Slope_12));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(sideIds.highCutSlope, 1), "HiCut Slope 2", cutoffChoiceStringArray, Slope::Slope_12));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(sideIds.lowCutBypassed, 1), "LowCut Bypassed 2", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(sideIds.peakBypassed, 1), "Peak Bypassed 2", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(sideIds.highCutBypassed, 1), "HighCut Bypassed 2", false));
+    
+    //dynamics for the peak band - above the threshold the peak gain gets pulled down by the ratio
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("PeakDynamic", 1), "Peak Dynamic", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("PeakThreshold", 1), "Peak Threshold",
+                                                           juce::NormalisableRange<float>(-60.f, 0.f, .5f, 1.f), -20.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("PeakRatio", 1), "Peak Ratio",
+                                                           juce::NormalisableRange<float>(1.f, 20.f, .1f, .5f), 2.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("PeakAttack", 1), "Peak Attack",
+                                                           juce::NormalisableRange<float>(.1f, 200.f, .1f, .4f), 10.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("PeakRelease", 1), "Peak Release",
+                                                           juce::NormalisableRange<float>(5.f, 2000.f, 1.f, .4f), 100.f));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("PeakSidechain", 1), "Peak Sidechain", false));
+    
+    //linear phase mode + the fir settings that trade latency for cpu
+    //fir length and partition size are only picked up in prepareToPlay
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("LinearPhase", 1), "Linear Phase", false));
+    //biquads are the default, the svf engine is for smooth modulation of the peak and cut frequencies
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("FilterEngine", 1), "Filter Engine",
+                                                            juce::StringArray {"Biquad", "SVF"}, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("FirLength", 1), "FIR Length",
+                                                            juce::StringArray {"4096", "8192", "16384", "32768"}, 1));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("PartitionSize", 1), "Partition Size",
+                                                            juce::StringArray {"64", "128", "256", "512", "1024", "2048"}, 3));
+    
+    //what an offline bounce runs instead of the realtime chain, the oversampling is only picked up in prepareToPlay
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("RenderQuality", 1), "Render Quality", true));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("RenderOversampling", 1), "Render Oversampling",
+                                                            juce::StringArray {"1x", "2x", "4x", "8x"}, 2));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("RenderMultithreaded", 1), "Render Multithreaded", true));
+    
+    //turns the output down (or up) by however much louder the eq has made things, for fair a/b comparisons
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("AutoGain", 1), "Auto Gain", false));
+    
+    //splits the output into linkwitz-riley bands on the extra output buses, the main output stays full band
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("Crossover", 1), "Crossover",
+                                                            juce::StringArray {"Off", "2 Bands", "3 Bands", "4 Bands"}, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("CrossoverSlope", 1), "Crossover Slope",
+                                                            juce::StringArray {"LR 12 db/Oct", "LR 24 db/Oct", "LR 48 db/Oct"}, 1));
+    float crossoverDefaults[] = { 120.f, 1000.f, 6000.f };
+    for (int i = 0; i < 3; i++)
+    {
+        juce::String id ("CrossoverFreq" + juce::String(i + 1));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(id, 1), "Crossover Freq " + juce::String(i + 1),
+                                                               juce::NormalisableRange<float>(20.f, 20000.f, 1.f, .25f), crossoverDefaults[i]));
+    }
+    
+    //morphs through the stored snapshots, 0 is the first one and 1 the last
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("MorphEnabled", 1), "Morph Enabled", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("Morph", 1), "Morph",
+                                                           juce::NormalisableRange<float>(0.f, 1.f, .001f, 1.f), 0.f));
+    
+    //the extra bands - all off by default so old sessions sound the same
+    //default frequencies are spread out evenly on a log scale
+    juce::StringArray bandTypeChoices {"Bell", "Low Shelf", "High Shelf", "Notch", "Low Cut", "High Cut", "Tilt"};
+    for (int i = 0; i < ChainSettings::numExtraBands; i++)
+    {
+        const auto& ids = GetBandParameterIDs(i);
+        juce::String name ("Band " + juce::String(i + 1) + " ");
+        auto defaultFreq = juce::mapToLog10((i + .5f) / float(ChainSettings::numExtraBands), 20.f, 20000.f);
+        
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(ids.type, 1), name + "Type", bandTypeChoices, 0));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.freq, 1), name + "Freq",
+                                                               juce::NormalisableRange<float>(20.f, 20000.f, 1.f, .25f), std::round(defaultFreq)));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.gain, 1), name + "Gain",
+                                                               juce::NormalisableRange<float>(-24.f, 24.f, .5f, 1.), 0.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.quality, 1), name + "Q",
+                                                               juce::NormalisableRange<float>(.1f, 10.f, .05f, 1.), 1.f));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(ids.enabled, 1), name + "Enabled", false));
+    }
 
     return layout;
 }
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DynamicBand.h"
+#include "BiquadDesign.h"
+#include "BiquadKernels.h"
+#include "CutFilter.h"
 
 enum Channel
 {
@@ -8,110 +12,231 @@ enum Channel
     Left   //1
 };
 
-//enum for hi/low pass slope options
-enum Slope{
-    Slope_12,
-    Slope_24,
-    Slope_36,
-    Slope_48
+//enum for how the two channels are processed
+enum StereoMode
+{
+    Linked,    //both channels use the first set of parameters
+    LeftRight, //left uses the first set, right uses the second
+    MidSide    //mid uses the first set, side uses the second
+};
+
+//enum for the extra bands' filter types
+enum BandType
+{
+    Bell,
+    LowShelf,
+    HighShelf,
+    Notch,
+    BandLowCut,
+    BandHighCut,
+    Tilt
+};
+
+//settings for one of the extra bands that come after the lowcut/peak/highcut chain
+struct BandSettings
+{
+    int type {BandType::Bell};
+    float freq {1000.f}, gainInDb {0}, quality {1.f};
+    bool enabled {false};
 };
 
+inline bool operator==(const BandSettings& a, const BandSettings& b)
+{
+    return a.type == b.type && a.freq == b.freq && a.gainInDb == b.gainInDb && a.quality == b.quality && a.enabled == b.enabled;
+}
+
+inline bool operator!=(const BandSettings& a, const BandSettings& b)
+{
+    return !(a == b);
+}
+
 //struct for all of our parameters
 struct ChainSettings
 {
+    static constexpr int numExtraBands = 16;
+    
     float peakFreq {0}, peakGainInDb{0}, peakQuality {.1f};
     float lowCutFreq{0}, highCutFreq{0};
     int lowCutSlope{Slope::Slope_12}, highCutSlope {Slope::Slope_12};
     bool lowCutBypassed{false}, peakBypassed{false}, highCutBypassed{false};
+    std::array<BandSettings, numExtraBands> bands;
 };
 
-//now declaring a function to get these values, implemented in .cpp
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
-
-//each filter type in IIR filter class has a response of 12db, so if we want a 48db slope we need 4 filters
-//so we set up a chain and process context which will run through each element of the chain automatically
-using Filter = juce::dsp::IIR::Filter<float>;
-using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
+//comparing settings lets us skip redesigning filters when nothing has changed
+inline bool operator==(const ChainSettings& a, const ChainSettings& b)
+{
+    return a.peakFreq == b.peakFreq && a.peakGainInDb == b.peakGainInDb && a.peakQuality == b.peakQuality
+        && a.lowCutFreq == b.lowCutFreq && a.highCutFreq == b.highCutFreq
+        && a.lowCutSlope == b.lowCutSlope && a.highCutSlope == b.highCutSlope
+        && a.lowCutBypassed == b.lowCutBypassed && a.peakBypassed == b.peakBypassed && a.highCutBypassed == b.highCutBypassed
+        && a.bands == b.bands;
+}
 
-//now we link together our cutfilters and filter to create the entire mono processing chain : Lowpass filter, peak EQ, Hipass filter
+inline bool operator!=(const ChainSettings& a, const ChainSettings& b)
+{
+    return !(a == b);
+}
 
-//most of the dsp modules process in mono so we will have a lot of duplicates
-//so we will create some type aliases to eliminate some namespace and type definitions
-using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+//now declaring a function to get these values, implemented in .cpp
+//parameterSet 0 is the main set of knobs, 1 is the right/side set used by the unlinked stereo modes
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts, int parameterSet = 0);
 
-//we create an enum to represent each link's position in the chain to make it easier
-enum ChainPositions{
-    LowCut,
-    Peak,
-    HighCut
+//ids for the lowcut/peak/highcut parameters of each set
+//set 0 uses the original ids, set 1 adds a "2" on the end
+struct ChainParameterIDs
+{
+    juce::String lowCutFreq, highCutFreq, peakFreq, peakGain, peakQuality;
+    juce::String lowCutSlope, highCutSlope, lowCutBypassed, peakBypassed, highCutBypassed;
 };
+const ChainParameterIDs& GetChainParameterIDs(int parameterSet);
 
-//creating helper function to update filter coefficients
-using Coefficients = Filter::CoefficientsPtr;
-void UpdateCoefficients(Coefficients& old, const Coefficients& replacement);
+//the dynamics for the peak band live in their own struct so they don't trigger curve redesigns
+DynamicSettings getPeakDynamicSettings(juce::AudioProcessorValueTreeState& apvts);
 
-Coefficients MakePeakFilter(const ChainSettings& chainSettings, double sampleRate);
+//the extra bands have 5 parameters each, "Band1Freq" etc.
+//the ids are built once so we don't allocate strings every block
+struct BandParameterIDs
+{
+    juce::String type, freq, gain, quality, enabled;
+};
+const BandParameterIDs& GetBandParameterIDs(int bandIndex);
 
-//creating helper function + template to simplify code in slope switch case
-template<int Index, typename ChainType, typename CoefficientType>
-void UpdateChain(ChainType& chain, const CoefficientType& cutCoefficients)
+//reads a ChainSettings from anything that can give us a parameter's value from its id
+//getChainSettings reads from the apvts, the preset bank reads from the values stored in a preset
+template <typename ValueForID>
+ChainSettings ReadChainSettings(ValueForID&& valueForID, int parameterSet)
 {
-    UpdateCoefficients(chain.template get<Index>().coefficients, cutCoefficients[Index]);
-    chain.template setBypassed<Index>(false);
+    ChainSettings settings;
+    const auto& ids = GetChainParameterIDs(parameterSet);
+    
+    settings.lowCutFreq = valueForID(ids.lowCutFreq);
+    settings.highCutFreq = valueForID(ids.highCutFreq);
+    settings.peakFreq = valueForID(ids.peakFreq);
+    settings.peakGainInDb = valueForID(ids.peakGain);
+    settings.peakQuality = valueForID(ids.peakQuality);
+    settings.lowCutSlope = static_cast<Slope>(valueForID(ids.lowCutSlope));
+    settings.highCutSlope = static_cast<Slope>(valueForID(ids.highCutSlope));
+    settings.lowCutBypassed = valueForID(ids.lowCutBypassed) > 0.5f;
+    settings.highCutBypassed = valueForID(ids.highCutBypassed) > 0.5f;
+    settings.peakBypassed = valueForID(ids.peakBypassed) > 0.5f;
+    
+    for (int i = 0; i < ChainSettings::numExtraBands; i++)
+    {
+        const auto& bandIds = GetBandParameterIDs(i);
+        auto& band = settings.bands[(size_t) i];
+        band.type = static_cast<BandType>(valueForID(bandIds.type));
+        band.freq = valueForID(bandIds.freq);
+        band.gainInDb = valueForID(bandIds.gain);
+        band.quality = valueForID(bandIds.quality);
+        band.enabled = valueForID(bandIds.enabled) > 0.5f;
+    }
+    
+    return settings;
 }
 
-//creating helper function to update hi/locut filter
-//templates allow you to pass any type of variable and it will interpret it the same
-template<typename ChainType, typename CoefficientType>
-void UpdateCutFilter(ChainType& cutChain, const CoefficientType& cutCoefficients, const Slope& lowCutSlope)
-{
-    //we need to bypass all the links in the chain first
-    cutChain.template setBypassed<0>(true);
-    cutChain.template setBypassed<1>(true);
-    cutChain.template setBypassed<2>(true);
-    cutChain.template setBypassed<3>(true);
-    //now we can switch between slopes with a switch case
-    //note that we are not breaking between switch cases and that we are going in reverse order (48->12)
-    //this is so that if the slope is 48, all the other cases also occur - all the filters will be activated
-    //and if the slope is 12, only the 12 case will be used
-    switch (lowCutSlope)
+//hands just the extra bands to setValueForID(id, value), for things that only ever work out the bands (like a match)
+template <typename SetValueForID>
+void WriteBandSettings(SetValueForID&& setValueForID, const std::array<BandSettings, ChainSettings::numExtraBands>& bands)
+{
+    for (int i = 0; i < ChainSettings::numExtraBands; i++)
     {
-        case Slope_48:
-        {
-            UpdateChain<3>(cutChain, cutCoefficients);
-        }
-        case Slope_36:
-        {
-            UpdateChain<2>(cutChain, cutCoefficients);
-        }
-        case Slope_24:
-        {
-            UpdateChain<1>(cutChain, cutCoefficients);
-        }
-        case Slope_12:
-        {
-            UpdateChain<0>(cutChain, cutCoefficients);
-        }
+        const auto& bandIds = GetBandParameterIDs(i);
+        const auto& band = bands[(size_t) i];
+        setValueForID(bandIds.type, float(band.type));
+        setValueForID(bandIds.freq, band.freq);
+        setValueForID(bandIds.gain, band.gainInDb);
+        setValueForID(bandIds.quality, band.quality);
+        setValueForID(bandIds.enabled, band.enabled ? 1.f : 0.f);
     }
 }
 
-inline auto MakeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
+//the other way round, hands every value of a ChainSettings to setValueForID(id, value)
+//used to apply settings worked out somewhere else as ordinary parameter changes
+template <typename SetValueForID>
+void WriteChainSettings(SetValueForID&& setValueForID, const ChainSettings& settings, int parameterSet)
 {
-    //now we create our lowcut filter coefficients
-    //last argument = order aka how many 12db filters it will create
-    //for some reason it creates one filter for every 2 orders
-    //since we want 12/24/36/48db slopes we need max 8 orders
-    //so we pass 2*(lowcutslope+1) to order (0->2, 1->4, 2->6, 3->8)
-    return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq, sampleRate, 2*(chainSettings.lowCutSlope + 1));
+    const auto& ids = GetChainParameterIDs(parameterSet);
+    
+    setValueForID(ids.lowCutFreq, settings.lowCutFreq);
+    setValueForID(ids.highCutFreq, settings.highCutFreq);
+    setValueForID(ids.peakFreq, settings.peakFreq);
+    setValueForID(ids.peakGain, settings.peakGainInDb);
+    setValueForID(ids.peakQuality, settings.peakQuality);
+    setValueForID(ids.lowCutSlope, float(settings.lowCutSlope));
+    setValueForID(ids.highCutSlope, float(settings.highCutSlope));
+    setValueForID(ids.lowCutBypassed, settings.lowCutBypassed ? 1.f : 0.f);
+    setValueForID(ids.highCutBypassed, settings.highCutBypassed ? 1.f : 0.f);
+    setValueForID(ids.peakBypassed, settings.peakBypassed ? 1.f : 0.f);
+    
+    WriteBandSettings(setValueForID, settings.bands);
 }
 
-inline auto MakeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
+//each biquad has a response of 12db, so the steeper slopes run several of them one after another
+//the cuts come from the constexpr section tables in CutFilter.h, only the frequency warp is worked out here
+//returns how many of the sections the slope uses
+template<typename SampleType = float>
+int MakeLowCutSections(const ChainSettings& chainSettings, double sampleRate, std::array<BiquadCoefficientsOf<SampleType>, maxCutSections>& sections)
 {
-    return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq, sampleRate, 2*(chainSettings.highCutSlope + 1));
+    return MakeCutSections<SampleType>(true, sampleRate, chainSettings.lowCutFreq, chainSettings.lowCutSlope, sections);
 }
 
+template<typename SampleType = float>
+int MakeHighCutSections(const ChainSettings& chainSettings, double sampleRate, std::array<BiquadCoefficientsOf<SampleType>, maxCutSections>& sections)
+{
+    return MakeCutSections<SampleType>(false, sampleRate, chainSettings.highCutFreq, chainSettings.highCutSlope, sections);
+}
+
+//every section of one side as flat biquads, so a whole design can be prepared off the audio thread and copied in
+struct SideCoefficients
+{
+    std::array<BiquadCoefficients, maxCutSections> lowCut, highCut;
+    BiquadCoefficients peak;
+};
+//every design in it is closed form (the cut tables and MakeBellBiquad), nothing is allocated, so it's cheap enough to run while morphing
+SideCoefficients MakeSideCoefficients(const ChainSettings& chainSettings, double sampleRate);
+
+//the lowcut, peak and highcut of one side: the first maxCutSections stages are the lowcut, then the peak, then the highcut
+//this used to be a ProcessorChain of IIR::Filters, each with its own heap allocated coefficients and state,
+//now it's just the designed coefficients and which stages are switched on, and the state lives in the cascade
+struct PackedChain
+{
+    static constexpr int numStages = 2 * maxCutSections + 1;
+    static constexpr int lowCutStage = 0, peakStage = maxCutSections, highCutStage = maxCutSections + 1;
+    
+    std::array<BiquadCoefficients, numStages> stages {};
+    std::array<bool, numStages> active {};
+    //the dynamics have put their own gain in the peak stage, designing the peak again puts the static one back
+    bool peakIsDynamic {false};
+};
+
+//the slope picks how many of the cut's stages are used (6db -> 1, 96db -> 8), bypassing switches them all off
+void CopyCutFilter(PackedChain& chain, int firstStage, const std::array<BiquadCoefficients, maxCutSections>& sections, const Slope& slope, bool bypassed);
+void CopyPeakFilter(PackedChain& chain, const BiquadCoefficients& peak, bool bypassed);
+
+//how many bytes of a vector's storage we're holding on to
+template<typename T>
+size_t GetVectorBytes(const std::vector<T>& vector)
+{
+    return vector.capacity() * sizeof(T);
+}
+
+//the alternative engines live in their own files, we only hold pointers to them here
+class LinearPhaseEQ;
+class SvfEQ;
+class MultiBandEQ;
+class PresetBank;
+class SnapshotMorph;
+class RenderEQ;
+class Crossover;
+class MatchEQ;
+class AutoGain;
+class AutomationRecorder;
+class SpectrogramAnalyser;
+struct ProgramCoefficients;
+
 //==============================================================================
-class SimpleEQAudioProcessor  : public juce::AudioProcessor
+class SimpleEQAudioProcessor  : public juce::AudioProcessor,
+                                private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -170,16 +295,137 @@ public:
     //declaring audio processor value tree state
     juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters", createParameterLayout()};
     
+    //the programs the host and midi program changes switch between
+    PresetBank& getPresetBank() { return *presetBank; }
+    
+    //snapshots the morph parameter blends between
+    SnapshotMorph& getSnapshotMorph() { return *snapshotMorph; }
+    void storeSnapshot(int slot);
+    void clearSnapshot(int slot);
+    
+    //matches the extra bands to a reference file's spectrum
+    MatchEQ& getMatchEQ() { return *matchEQ; }
+    
+    //opt in recording of every parameter change processBlock sees, for replaying in the soak test
+    AutomationRecorder& getAutomationRecorder() { return *automationRecorder; }
+    
+    //the output spectrum over time, for the editor
+    SpectrogramAnalyser& getSpectrogram() { return *spectrogram; }
+    
+    //background work from an instance with its editor open runs ahead of everyone else's on the shared pool
+    void setEditorVisible(bool isVisible);
+    
+    //bytes one instance holds on to, split up by engine so it can be tracked from release to release
+    //this is our own state and buffers, not the parameter objects and value tree juce keeps for us
+    struct MemoryFootprint
+    {
+        size_t processor {0}, linearPhase {0}, svf {0}, multiBand {0}, presets {0}, morph {0}, render {0}, crossover {0}, match {0}, recorder {0}, spectrogram {0};
+        size_t getTotal() const { return processor + linearPhase + svf + multiBand + presets + morph + render + crossover + match + recorder + spectrogram; }
+    };
+    MemoryFootprint getMemoryFootprint() const;
+    
+    //audio thread, true while a design the output depends on is still being worked out in the background
+    //offline tools (the regression test) keep processing until it's false before they look at the output
+    bool hasPendingDesigns() const;
+    
+    //the biquad kernel the cascade runs with, worked out in prepareToPlay
+    BiquadKernels::Variant getKernelVariant() const { return kernelVariant.load(); }
+    
     private:
 
     //declare left and right chains
-    MonoChain leftChain, rightChain;
+    //the chains hold the designed coefficients and which stages are on, the audio itself runs through the cascade:
+    //every active stage of both chains with a lane per channel, run by the best simd kernel for this cpu
+    //all three sit in one cache aligned block, so a block of audio touches one piece of memory for all of its filters
+    struct alignas(64) ChainStorage
+    {
+        PackedChain left, right;
+        BiquadCascade cascade;
+    };
+    ChainStorage chains;
+    void UpdateChainCascade(int numChannels);
+    
+    //the settings each chain was last designed with, so a side is only redesigned when its own knobs move
+    ChainSettings leftChainSettings, rightChainSettings;
+    bool chainSettingsValid {false};
+    //both sides have the same settings (always in linked mode), so the right side's designs are copies of the left's
+    void CopyLeftChainToRight();
+    
+    //fir version of the same curve for mastering, adds latency
+    //one per side so the unlinked stereo modes can have different curves, in linked mode the left one runs both
+    //channels (it's prepared with two) and the right one is left alone, so each design happens once
+    std::unique_ptr<LinearPhaseEQ> leftLinearPhase, rightLinearPhase;
+    bool linearPhaseActive {false};
+    
+    //state variable filter version of the chain for fast per sample modulation, linked the same way as the firs
+    std::unique_ptr<SvfEQ> leftSvf, rightSvf;
+    bool svfActive {false};
+    
+    //the left engines have the right channel's history in linked mode and the right ones in the others,
+    //so changing mode clears them
+    StereoMode activeStereoMode {StereoMode::Linked};
+    
+    //the extra bands run after whichever chain is active, as one packed biquad cascade
+    std::unique_ptr<MultiBandEQ> multiBand;
+    
+    //oversampled double precision chain and extra bands for offline bounces
+    std::unique_ptr<RenderEQ> renderEQ;
+    bool renderActive {false};
+    bool IsRenderPathEnabled();
+    void UpdateLatency();
+    
+    //splits the finished output into bands on the extra output buses
+    std::unique_ptr<Crossover> crossover;
+    void ProcessCrossover(juce::AudioBuffer<float>& buffer, const juce::dsp::AudioBlock<float>& block);
+    
+    //captures the input and fits the extra bands to a reference in the background
+    std::unique_ptr<MatchEQ> matchEQ;
+    
+    //makeup gain that keeps the output as loud as the input
+    std::unique_ptr<AutoGain> autoGain;
+    bool autoGainActive {false};
+    
+    std::unique_ptr<AutomationRecorder> automationRecorder;
+    std::unique_ptr<SpectrogramAnalyser> spectrogram;
+    
+    //envelope follower that turns the peak band into a dynamic band
+    DynamicBand peakDynamics;
+    
+    //presets with coefficients designed ahead of time for the current sample rate
+    std::unique_ptr<PresetBank> presetBank;
+    std::unique_ptr<ProgramCoefficients> programCoefficients;
+    std::atomic<int> currentProgram {0}, pendingProgram {-1};
+    //true from a program change until its parameters have landed, the chains follow the program until then
+    std::atomic<bool> programParametersPending {false};
+    int appliedProgram {-1};
+    
+    void handleAsyncUpdate() override;
+    void RequestProgram(int index);
+    void ApplyPendingProgram();
+    //blends between stored snapshots, the chains are then updated with the closed form designs
+    std::unique_ptr<SnapshotMorph> snapshotMorph;
+    void UpdateChainFiltersClosedForm(PackedChain& chain, ChainSettings& currentSettings, const ChainSettings& chainSettings);
+    
+    void ApplySideCoefficients(PackedChain& chain, ChainSettings& currentSettings, const SideCoefficients& coefficients, const ChainSettings& chainSettings);
+    
+    //what we were last prepared with, so a re-prepare that changes nothing that matters costs nothing
+    double preparedSampleRate {0};
+    int preparedFirLength {0}, preparedPartitionSize {0}, preparedNumChannels {0}, preparedOversamplingFactor {0};
+    bool preparedRenderThreads {false};
+    std::atomic<BiquadKernels::Variant> kernelVariant {BiquadKernels::Variant::Scalar};
     
     //refactoring
-    void UpdatePeakFilter(const ChainSettings& chainSettings);
-    void UpdateLowCutFilters(const ChainSettings& chainSettings);
-    void UpdateHighCutFilters(const ChainSettings& chainSettings);
+    void UpdatePeakFilter(PackedChain& chain, const ChainSettings& chainSettings);
+    void UpdateLowCutFilters(PackedChain& chain, const ChainSettings& chainSettings);
+    void UpdateHighCutFilters(PackedChain& chain, const ChainSettings& chainSettings);
+    void UpdateChainFilters(PackedChain& chain, ChainSettings& currentSettings, const ChainSettings& chainSettings);
     void UpdateAllFilters();
+    void UpdateAllFilters(const ChainSettings& leftSettings, const ChainSettings& rightSettings);
+    void UpdateDynamicPeakGain(PackedChain& chain, const ChainSettings& currentSettings, float gainInDb);
+    void RestoreStaticPeakFilter(PackedChain& chain, const ChainSettings& currentSettings);
+    void GetSideChainSettings(ChainSettings& leftSettings, ChainSettings& rightSettings);
+    void ProcessChains(juce::dsp::AudioBlock<float>& block, const ChainSettings& leftSettings, const ChainSettings& rightSettings,
+                       bool encodeMidSide, bool linked);
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessor)
@@ -0,0 +1,339 @@
+#include "PresetBank.h"
+#include "StateFormat.h"
+
+PresetBank::PresetBank(juce::AudioProcessorValueTreeState& state) : apvts(state)
+{
+    //ranges and defaults never change so we only collect them once
+    for (auto* parameter : apvts.processor.getParameters())
+    {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+        jassert(ranged != nullptr);
+        parameters[ranged->paramID.hashCode()] = { ranged, ranged->convertFrom0to1(ranged->getDefaultValue()) };
+    }
+}
+
+juce::File PresetBank::getDefaultBankFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("SimpleEQ")
+        .getChildFile("Presets.seqbank");
+}
+
+bool PresetBank::loadBank(const juce::File& file)
+{
+    auto loaded = [this, &file]
+    {
+        const juce::ScopedLock lock(bankLock);
+
+        bankFile = file;
+        mappedFile.reset();
+        index.clear();
+        numPresets = 0;
+
+        if (!file.existsAsFile())
+            return false;
+
+        auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+        auto* data = static_cast<const char*>(mapped->getData());
+        auto size = (int) mapped->getSize();
+
+        if (data == nullptr || size < headerSize)
+            return false;
+
+        juce::MemoryInputStream header (data, (size_t) size, false);
+        if (header.readInt() != magic)
+            return false;
+
+        auto version = header.readInt();
+        if (version < 1 || version > currentVersion)
+            return false;
+
+        auto numStored = header.readInt();
+        if (numStored < 0 || juce::int64(size) < headerSize + juce::int64(numStored) * indexEntrySize)
+            return false;
+
+        //only the index is read now, names and states stay in the mapped file until someone asks for them
+        index.resize((size_t) numStored);
+        for (auto& entry : index)
+        {
+            entry.nameOffset = header.readInt();
+            entry.nameSize = header.readInt();
+            entry.stateOffset = header.readInt();
+            entry.stateSize = header.readInt();
+
+            //a damaged entry is kept as an empty preset rather than reading past the end of the file
+            auto fits = [size](int offset, int length)
+            {
+                return offset >= 0 && length >= 0 && offset <= size - length;
+            };
+            if (!fits(entry.nameOffset, entry.nameSize) || !fits(entry.stateOffset, entry.stateSize))
+                entry = {};
+        }
+
+        mappedFile = std::move(mapped);
+        numPresets = numStored;
+        return true;
+    }();
+
+    //the new presets need designing, and the old designs have to go even if the file couldn't be read
+    precompute(requestedSampleRate);
+    return loaded;
+}
+
+juce::String PresetBank::getPresetName(int presetIndex) const
+{
+    juce::String name;
+    ReadPreset(presetIndex, &name, nullptr);
+    return name;
+}
+
+bool PresetBank::ReadPreset(int presetIndex, juce::String* name, juce::MemoryBlock* state) const
+{
+    const juce::ScopedLock lock(bankLock);
+
+    if (mappedFile == nullptr || presetIndex < 0 || presetIndex >= (int) index.size())
+        return false;
+
+    auto* data = static_cast<const char*>(mappedFile->getData());
+    const auto& entry = index[(size_t) presetIndex];
+
+    if (name != nullptr)
+        *name = juce::String::fromUTF8(data + entry.nameOffset, entry.nameSize);
+    if (state != nullptr)
+        state->replaceAll(data + entry.stateOffset, (size_t) entry.stateSize);
+
+    return true;
+}
+
+bool PresetBank::applyPresetParameters(int presetIndex)
+{
+    juce::MemoryBlock state;
+    if (!ReadPreset(presetIndex, nullptr, &state))
+        return false;
+
+    return StateFormat::ReadBinaryState(apvts, state.getData(), (int) state.getSize());
+}
+
+bool PresetBank::addPreset(const juce::String& name)
+{
+    juce::StringArray names;
+    juce::Array<juce::MemoryBlock> states;
+    for (int i = 0; i < getNumPresets(); i++)
+    {
+        juce::String presetName;
+        juce::MemoryBlock state;
+        ReadPreset(i, &presetName, &state);
+        names.add(presetName);
+        states.add(state);
+    }
+
+    juce::MemoryBlock state;
+    StateFormat::WriteBinaryState(apvts, state);
+    names.add(name);
+    states.add(state);
+
+    return RewriteBank(names, states);
+}
+
+bool PresetBank::renamePreset(int presetIndex, const juce::String& newName)
+{
+    if (presetIndex < 0 || presetIndex >= getNumPresets())
+        return false;
+
+    juce::StringArray names;
+    juce::Array<juce::MemoryBlock> states;
+    for (int i = 0; i < getNumPresets(); i++)
+    {
+        juce::String presetName;
+        juce::MemoryBlock state;
+        ReadPreset(i, &presetName, &state);
+        names.add(i == presetIndex ? newName : presetName);
+        states.add(state);
+    }
+
+    return RewriteBank(names, states);
+}
+
+bool PresetBank::RewriteBank(juce::StringArray names, juce::Array<juce::MemoryBlock> states)
+{
+    auto file = [this]
+    {
+        const juce::ScopedLock lock(bankLock);
+        //the mapping has to go before the file underneath it can be replaced
+        mappedFile.reset();
+        index.clear();
+        numPresets = 0;
+        return bankFile == juce::File() ? getDefaultBankFile() : bankFile;
+    }();
+
+    auto written = writeBankFile(file, names, states);
+    loadBank(file);
+    return written;
+}
+
+bool PresetBank::writeBankFile(const juce::File& file, const juce::StringArray& names, const juce::Array<juce::MemoryBlock>& states)
+{
+    jassert(names.size() == states.size());
+    auto numToWrite = juce::jmin(names.size(), states.size());
+
+    juce::MemoryBlock data;
+    juce::MemoryOutputStream stream (data, false);
+
+    stream.writeInt(magic);
+    stream.writeInt(currentVersion);
+    stream.writeInt(numToWrite);
+
+    //names and states follow the index back to back
+    auto offset = headerSize + numToWrite * indexEntrySize;
+    for (int i = 0; i < numToWrite; i++)
+    {
+        auto nameSize = (int) names[i].getNumBytesAsUTF8();
+        auto stateSize = (int) states.getReference(i).getSize();
+        stream.writeInt(offset);
+        stream.writeInt(nameSize);
+        stream.writeInt(offset + nameSize);
+        stream.writeInt(stateSize);
+        offset += nameSize + stateSize;
+    }
+
+    for (int i = 0; i < numToWrite; i++)
+    {
+        stream.write(names[i].toRawUTF8(), names[i].getNumBytesAsUTF8());
+        stream.write(states.getReference(i).getData(), states.getReference(i).getSize());
+    }
+
+    stream.flush();
+
+    //write next to the old bank and swap it in so a failed save doesn't lose the library
+    if (!file.getParentDirectory().createDirectory())
+        return false;
+
+    juce::TemporaryFile temporary (file);
+    if (!temporary.getFile().replaceWithData(data.getData(), data.getSize()))
+        return false;
+
+    return temporary.overwriteTargetFileWithTemporary();
+}
+
+void PresetBank::precompute(double sampleRate)
+{
+    requestedSampleRate = sampleRate;
+    if (sampleRate <= 0)
+        return;
+
+    //loading a bank always asks again, so a changed bank with the same size still gets redesigned
+    auto generation = ++designGeneration;
+    workers.submitLatest(0, [this, sampleRate, generation] { DesignPrograms(sampleRate, generation); });
+}
+
+bool PresetBank::getProgramCoefficients(int presetIndex, double sampleRate, ProgramCoefficients& destination)
+{
+    juce::SpinLock::ScopedTryLockType lock(programsLock);
+    if (!lock.isLocked())
+        return false;
+
+    if (programsSampleRate != sampleRate || presetIndex < 0 || presetIndex >= (int) programs.size())
+        return false;
+
+    destination = programs[(size_t) presetIndex];
+    return true;
+}
+
+size_t PresetBank::getMemoryUsageInBytes() const
+{
+    auto bytes = sizeof(*this) + parameters.size() * sizeof(std::pair<const int, ParameterInfo>);
+
+    {
+        const juce::ScopedLock lock(bankLock);
+        bytes += GetVectorBytes(index);
+    }
+
+    const juce::SpinLock::ScopedLockType lock(programsLock);
+    return bytes + GetVectorBytes(programs);
+}
+
+bool PresetBank::getPresetSettings(int presetIndex, ChainSettings& left, ChainSettings& right) const
+{
+    juce::MemoryBlock state;
+    if (!ReadPreset(presetIndex, nullptr, &state))
+        return false;
+
+    auto program = DecodeProgram(state);
+    left = program.left;
+    right = program.right;
+    return true;
+}
+
+ProgramCoefficients PresetBank::DecodeProgram(const juce::MemoryBlock& state) const
+{
+    //start from the defaults and overlay whatever the preset stored, the same way ReadBinaryState would
+    std::unordered_map<int, float> values;
+    for (const auto& [hash, info] : parameters)
+        values[hash] = info.defaultValue;
+
+    juce::MemoryInputStream stream (state, false);
+    if (state.getSize() >= 12 && stream.readInt() == StateFormat::magic)
+    {
+        stream.readInt();
+        auto numStored = stream.readInt();
+
+        for (int i = 0; i < numStored && stream.getNumBytesRemaining() >= 8; i++)
+        {
+            auto idHash = stream.readInt();
+            auto value = stream.readFloat();
+
+            //round trip through the parameter so we end up with exactly what the parameter will hold
+            //otherwise the first block after the parameters land would see a tiny change and redesign
+            auto found = parameters.find(idHash);
+            if (found != parameters.end())
+            {
+                auto* parameter = found->second.parameter;
+                values[idHash] = parameter->convertFrom0to1(parameter->convertTo0to1(value));
+            }
+        }
+    }
+
+    auto valueForID = [&values](const juce::String& id)
+    {
+        auto found = values.find(id.hashCode());
+        return found != values.end() ? found->second : 0.f;
+    };
+
+    ProgramCoefficients program;
+    program.stereoMode = int(valueForID("StereoMode"));
+    program.left = ReadChainSettings(valueForID, 0);
+    program.right = program.stereoMode == StereoMode::Linked ? program.left : ReadChainSettings(valueForID, 1);
+    return program;
+}
+
+ProgramCoefficients PresetBank::DesignProgram(const juce::MemoryBlock& state, double sampleRate) const
+{
+    auto program = DecodeProgram(state);
+    program.leftCoefficients = MakeSideCoefficients(program.left, sampleRate);
+    program.rightCoefficients = MakeSideCoefficients(program.right, sampleRate);
+    return program;
+}
+
+void PresetBank::DesignPrograms(double sampleRate, int generation)
+{
+    auto numToDesign = getNumPresets();
+    std::vector<ProgramCoefficients> designed;
+    designed.reserve((size_t) numToDesign);
+
+    for (int i = 0; i < numToDesign; i++)
+    {
+        if (WorkerPool::isCurrentJobCancelled())
+            return;
+
+        juce::MemoryBlock state;
+        ReadPreset(i, nullptr, &state);
+        designed.push_back(DesignProgram(state, sampleRate));
+    }
+
+    //the old designs are freed after the lock is released
+    const juce::SpinLock::ScopedLockType lock(programsLock);
+    if (generation != designGeneration.load())
+        return;
+    std::swap(programs, designed);
+    programsSampleRate = sampleRate;
+}
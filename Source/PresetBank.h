@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "WorkerPool.h"
+
+//everything a program needs on the audio thread, designed ahead of time for one sample rate
+struct ProgramCoefficients
+{
+    int stereoMode {StereoMode::Linked};
+    ChainSettings left, right;
+    SideCoefficients leftCoefficients, rightCoefficients;
+};
+
+//bank of presets stored in one indexed file
+//
+//layout (little endian):
+//  int   magic ("SEQP")
+//  int   version
+//  int   number of presets
+//  then for every preset:
+//  int   name offset, int name size, int state offset, int state size
+//  then the utf8 names and the state blobs (see StateFormat.h) the offsets point at
+//
+//the file is memory mapped, so opening a large library only touches the index. once we know the sample rate
+//a job on the shared worker pool turns every preset into ready made coefficients, so switching programs on the
+//audio thread is just a copy
+class PresetBank
+{
+public:
+    explicit PresetBank(juce::AudioProcessorValueTreeState& apvts);
+
+    static juce::File getDefaultBankFile();
+
+    //message thread
+    bool loadBank(const juce::File& file);
+    //any thread, the audio thread included, it never takes the bank's lock
+    int getNumPresets() const { return numPresets.load(); }
+    juce::String getPresetName(int index) const;
+    bool applyPresetParameters(int index);
+    //decodes a preset's settings without touching the parameters, safe from any thread
+    bool getPresetSettings(int index, ChainSettings& left, ChainSettings& right) const;
+    bool addPreset(const juce::String& name);
+    bool renamePreset(int index, const juce::String& newName);
+
+    static bool writeBankFile(const juce::File& file, const juce::StringArray& names, const juce::Array<juce::MemoryBlock>& states);
+
+    //starts designing every preset for this sample rate in the background, a design still running is abandoned
+    void precompute(double sampleRate);
+    void setWorkerPriority(WorkerPool::Priority priority) { workers.setPriority(priority); }
+
+    //audio thread, never blocks
+    //returns false if the coefficients for this preset aren't ready at this sample rate yet
+    bool getProgramCoefficients(int index, double sampleRate, ProgramCoefficients& destination);
+
+    //the index and the precomputed designs, the mapped file itself is paged in by the os and not counted
+    size_t getMemoryUsageInBytes() const;
+
+private:
+    static constexpr int magic = 0x50514553; //"SEQP"
+    static constexpr int currentVersion = 1;
+    static constexpr int headerSize = 12, indexEntrySize = 16;
+
+    struct IndexEntry
+    {
+        int nameOffset {0}, nameSize {0}, stateOffset {0}, stateSize {0};
+    };
+
+    void DesignPrograms(double sampleRate, int generation);
+    bool ReadPreset(int index, juce::String* name, juce::MemoryBlock* state) const;
+    bool RewriteBank(juce::StringArray names, juce::Array<juce::MemoryBlock> states);
+    ProgramCoefficients DecodeProgram(const juce::MemoryBlock& state) const;
+    ProgramCoefficients DesignProgram(const juce::MemoryBlock& state, double sampleRate) const;
+
+    juce::AudioProcessorValueTreeState& apvts;
+
+    //the mapped file and its index, shared between the message thread and the design job
+    juce::CriticalSection bankLock;
+    juce::File bankFile;
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    std::vector<IndexEntry> index;
+    //the index's size, kept outside the lock because the lock is held while the file is read and written
+    std::atomic<int> numPresets {0};
+
+    //every parameter's range and default, so presets can be decoded without touching the live parameters
+    struct ParameterInfo
+    {
+        juce::RangedAudioParameter* parameter;
+        float defaultValue;
+    };
+    std::unordered_map<int, ParameterInfo> parameters;
+
+    std::atomic<double> requestedSampleRate {0};
+    //only the newest design gets swapped in, one that was cancelled late might finish after it
+    std::atomic<int> designGeneration {0};
+
+    //the finished designs, swapped in under the spin lock so the audio thread can skip a block rather than wait
+    juce::SpinLock programsLock;
+    std::vector<ProgramCoefficients> programs;
+    double programsSampleRate {0};
+
+    //last, so the design job is finished before anything it uses goes
+    WorkerPool::Client workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetBank)
+};
@@ -0,0 +1,355 @@
+#include "RenderEQ.h"
+
+RenderEQ::RenderEQ()
+{
+}
+
+RenderEQ::~RenderEQ()
+{
+    helperTrigger.stop();
+}
+
+void RenderEQ::prepare(double sampleRate, int newNumChannels, int newMaxBlockSize, int newOversamplingFactor, bool shouldUseThreads)
+{
+    //the helper reads the buffers we are about to replace so it has to stop first
+    helperTrigger.stop();
+    helperClaimed = true;
+    helperFinished.reset();
+
+    numChannels = juce::jlimit(1, maxChannels, newNumChannels);
+    maxBlockSize = juce::jmax(1, newMaxBlockSize);
+    oversamplingFactor = juce::jlimit(1, 8, juce::nextPowerOfTwo(newOversamplingFactor));
+    designRate = sampleRate * oversamplingFactor;
+
+    inputBuffer.setSize(numChannels, maxBlockSize);
+    oversampling.reset();
+    latency = 0;
+    if (oversamplingFactor > 1)
+    {
+        //max quality polyphase iirs, steep enough that nothing folds back and with far less latency than the fir version
+        oversampling = std::make_unique<juce::dsp::Oversampling<double>>((size_t) numChannels, (size_t) juce::roundToInt(std::log2(oversamplingFactor)),
+                                                                          juce::dsp::Oversampling<double>::filterHalfBandPolyphaseIIR, true, true);
+        oversampling->initProcessing((size_t) maxBlockSize);
+        latency = juce::roundToInt(oversampling->getLatencyInSamples());
+    }
+
+    //everything gets designed again at the new rate
+    for (auto& side : sides)
+        side.hasSettings = false;
+    hasBands = false;
+    reset();
+
+    //nothing is started here, the pool only gets work once a bounce is actually running through process
+    multithreaded = shouldUseThreads && numChannels > 1;
+    numPeakPeriods = 0;
+    helperTrigger.start();
+}
+
+void RenderEQ::reset()
+{
+    for (auto& state : states)
+    {
+        state.lowCut.reset();
+        state.highCut.reset();
+        state.s1.fill(0.0);
+        state.s2.fill(0.0);
+    }
+
+    if (oversampling != nullptr)
+        oversampling->reset();
+}
+
+void RenderEQ::setChainSettings(const ChainSettings& left, const ChainSettings& right)
+{
+    if (!isPrepared())
+        return;
+
+    const ChainSettings* settings[] = { &left, &right };
+    for (int i = 0; i < maxChannels; i++)
+    {
+        auto& side = sides[(size_t) i];
+        if (side.hasSettings && side.settings == *settings[i])
+            continue;
+
+        //linked sides are designed once, the right one is a copy of the left's sections
+        if (i > 0 && *settings[i] == left)
+            side = sides[0];
+        else
+            DesignSide(side, *settings[i]);
+    }
+
+    //the extra bands are always linked, so they follow the first set like MultiBandEQ
+    if (!hasBands || bands != left.bands)
+        DesignBands(left);
+}
+
+void RenderEQ::addPeakGains(float leftGainInDb, float rightGainInDb)
+{
+    if (numPeakPeriods == maxPeakPeriods)
+    {
+        jassertfalse;
+        return;
+    }
+
+    //a period with the same gain as the one before it doesn't need designing again
+    float gains[] = { leftGainInDb, rightGainInDb };
+    auto& period = peakPeriods[(size_t) numPeakPeriods];
+    for (int i = 0; i < maxChannels; i++)
+    {
+        const auto& side = sides[(size_t) i];
+        if (numPeakPeriods > 0 && lastPeakGains[(size_t) i] == gains[i])
+            period[(size_t) i] = peakPeriods[(size_t) numPeakPeriods - 1][(size_t) i];
+        else if (i > 0 && gains[i] == gains[0] && side.settings == sides[0].settings)
+            period[(size_t) i] = period[0];
+        else
+            period[(size_t) i] = MakeBellBiquad<double>(designRate, side.settings.peakFreq, side.settings.peakQuality, gains[i]);
+        lastPeakGains[(size_t) i] = gains[i];
+    }
+
+    numPeakPeriods++;
+}
+
+void RenderEQ::DesignSide(Side& side, const ChainSettings& chainSettings)
+{
+    //the same section tables as the realtime cuts, a bypassed cut runs no sections at all
+    auto numLowCutSections = MakeLowCutSections<double>(chainSettings, designRate, side.lowCut.sections);
+    side.lowCut.numSections = chainSettings.lowCutBypassed ? 0 : numLowCutSections;
+
+    auto numHighCutSections = MakeHighCutSections<double>(chainSettings, designRate, side.highCut.sections);
+    side.highCut.numSections = chainSettings.highCutBypassed ? 0 : numHighCutSections;
+
+    side.sections[peakSlot] = MakeBellBiquad<double>(designRate, chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDb);
+    side.active[peakSlot] = !chainSettings.peakBypassed;
+
+    side.settings = chainSettings;
+    side.hasSettings = true;
+}
+
+void RenderEQ::DesignBands(const ChainSettings& chainSettings)
+{
+    //every band has its own slots, so switching one band on or off doesn't move the others' state around
+    std::array<Section, maxSectionsPerBand> bandSections;
+    for (int band = 0; band < ChainSettings::numExtraBands; band++)
+    {
+        auto numSections = MakeBandSections(chainSettings.bands[(size_t) band], designRate, bandSections);
+        for (int section = 0; section < maxSectionsPerBand; section++)
+        {
+            auto slot = (size_t) (firstBandSlot + band * maxSectionsPerBand + section);
+            for (auto& side : sides)
+            {
+                side.sections[slot] = bandSections[(size_t) section];
+                side.active[slot] = section < numSections;
+            }
+        }
+    }
+
+    bands = chainSettings.bands;
+    hasBands = true;
+}
+
+void RenderEQ::process(juce::dsp::AudioBlock<float>& block, bool midSide)
+{
+    //the peak gains are only for this block, whatever happens
+    const juce::ScopeGuard clearPeakGains { [this] { numPeakPeriods = 0; } };
+
+    if (!isPrepared())
+        return;
+
+    auto channels = juce::jmin((size_t) numChannels, block.getNumChannels());
+    midSide = midSide && channels > 1;
+
+    for (size_t start = 0; start < block.getNumSamples(); start += (size_t) maxBlockSize)
+    {
+        auto length = juce::jmin((size_t) maxBlockSize, block.getNumSamples() - start);
+        auto subBlock = block.getSubBlock(start, length);
+
+        juce::dsp::AudioBlock<double> input = juce::dsp::AudioBlock<double>(inputBuffer).getSubsetChannelBlock(0, channels).getSubBlock(0, length);
+        auto firstCopied = size_t(0);
+        if (midSide)
+        {
+            //encoded in single precision, the same as the other engines
+            auto* left = subBlock.getChannelPointer(0);
+            auto* right = subBlock.getChannelPointer(1);
+            auto* mid = input.getChannelPointer(0);
+            auto* side = input.getChannelPointer(1);
+            for (size_t i = 0; i < length; i++)
+            {
+                mid[i] = (left[i] + right[i]) * .5f;
+                side[i] = (left[i] - right[i]) * .5f;
+            }
+            firstCopied = 2;
+        }
+
+        for (size_t channel = firstCopied; channel < channels; channel++)
+        {
+            auto* source = subBlock.getChannelPointer(channel);
+            auto* destination = input.getChannelPointer(channel);
+            for (size_t i = 0; i < length; i++)
+                destination[i] = source[i];
+        }
+
+        oversampledBlock = oversampling != nullptr ? oversampling->processSamplesUp(input) : input;
+        oversampledBlockStart = start * (size_t) oversamplingFactor;
+
+        if (midSide)
+        {
+            //the chain runs on mid/side, the extra bands on left/right
+            ProcessPart(Part::Chain);
+
+            auto* mid = oversampledBlock.getChannelPointer(0);
+            auto* side = oversampledBlock.getChannelPointer(1);
+            for (size_t i = 0; i < oversampledBlock.getNumSamples(); i++)
+            {
+                auto left = mid[i] + side[i];
+                auto right = mid[i] - side[i];
+                mid[i] = left;
+                side[i] = right;
+            }
+
+            ProcessPart(Part::Bands);
+        }
+        else
+        {
+            ProcessPart(Part::Everything);
+        }
+
+        if (oversampling != nullptr)
+            oversampling->processSamplesDown(input);
+
+        for (size_t channel = 0; channel < channels; channel++)
+        {
+            auto* source = input.getChannelPointer(channel);
+            auto* destination = subBlock.getChannelPointer(channel);
+            for (size_t i = 0; i < length; i++)
+                destination[i] = float(source[i]);
+        }
+    }
+}
+
+void RenderEQ::ProcessPart(Part part)
+{
+    auto channels = (int) oversampledBlock.getNumChannels();
+    if (!multithreaded || channels < 2)
+    {
+        for (int channel = 0; channel < channels; channel++)
+            ProcessChannel(channel, part);
+        return;
+    }
+
+    //a whole block of a part goes to the helper at once
+    jobPart = part;
+    helperClaimed = false;
+    helperTrigger.fireAndWake();
+
+    for (int channel = 0; channel < channels; channel += 2)
+        ProcessChannel(channel, part);
+
+    //no worker has got to it yet, so it's quicker to do the odd channels here than to wait for one
+    if (!helperClaimed.exchange(true))
+    {
+        for (int channel = 1; channel < channels; channel += 2)
+            ProcessChannel(channel, part);
+        return;
+    }
+
+    helperFinished.wait();
+}
+
+void RenderEQ::ProcessHelperChannels()
+{
+    //a run left over from a block the calling thread finished by itself
+    if (helperClaimed.exchange(true))
+        return;
+
+    for (int channel = 1; channel < (int) oversampledBlock.getNumChannels(); channel += 2)
+        ProcessChannel(channel, jobPart);
+
+    helperFinished.signal();
+}
+
+void RenderEQ::ProcessChannel(int channel, Part part)
+{
+    if (part != Part::Bands)
+    {
+        //each cut runs the loop specialised for its slope's section count
+        const auto& side = sides[(size_t) channel];
+        auto& state = states[(size_t) channel];
+        auto* samples = oversampledBlock.getChannelPointer((size_t) channel);
+        auto numSamples = oversampledBlock.getNumSamples();
+
+        ProcessCutFilter(side.lowCut, state.lowCut, samples, numSamples);
+        if (numPeakPeriods > 0)
+            ProcessDynamicPeak(channel);
+        else
+            ProcessSlots(channel, peakSlot, firstBandSlot);
+        ProcessCutFilter(side.highCut, state.highCut, samples, numSamples);
+    }
+
+    if (part != Part::Chain)
+        ProcessSlots(channel, firstBandSlot, numSlots);
+}
+
+//same transposed direct form II as IIR::Filter but in double
+//the state is copied out so the compiler doesn't have to assume writing a sample could change it
+static void ProcessSection(const BiquadCoefficientsOf<double>& c, double& state1, double& state2, double* samples, size_t numSamples)
+{
+    auto s1 = state1;
+    auto s2 = state2;
+    for (size_t i = 0; i < numSamples; i++)
+    {
+        auto in = samples[i];
+        auto out = in * c.b0 + s1;
+        s1 = (in * c.b1) - (out * c.a1) + s2;
+        s2 = (in * c.b2) - (out * c.a2);
+        samples[i] = out;
+    }
+    state1 = s1;
+    state2 = s2;
+}
+
+void RenderEQ::ProcessDynamicPeak(int channel)
+{
+    if (!sides[(size_t) channel].active[peakSlot])
+        return;
+
+    auto& state = states[(size_t) channel];
+    auto* samples = oversampledBlock.getChannelPointer((size_t) channel);
+    auto numSamples = oversampledBlock.getNumSamples();
+    auto periodLength = (size_t) (DynamicBand::controlInterval * oversamplingFactor);
+
+    //a run of samples per control period, each with that period's section and the state carried across
+    for (size_t i = 0; i < numSamples;)
+    {
+        auto period = (oversampledBlockStart + i) / periodLength;
+        auto end = juce::jmin(numSamples, (period + 1) * periodLength - oversampledBlockStart);
+        const auto& section = peakPeriods[juce::jmin(period, (size_t) numPeakPeriods - 1)][(size_t) channel];
+        ProcessSection(section, state.s1[(size_t) peakSlot], state.s2[(size_t) peakSlot], samples + i, end - i);
+        i = end;
+    }
+}
+
+void RenderEQ::ProcessSlots(int channel, int firstSlot, int lastSlot)
+{
+    const auto& side = sides[(size_t) channel];
+    auto& state = states[(size_t) channel];
+    auto* samples = oversampledBlock.getChannelPointer((size_t) channel);
+    auto numSamples = oversampledBlock.getNumSamples();
+
+    //section by section over the whole block
+    for (int slot = firstSlot; slot < lastSlot; slot++)
+    {
+        if (side.active[(size_t) slot])
+            ProcessSection(side.sections[(size_t) slot], state.s1[(size_t) slot], state.s2[(size_t) slot], samples, numSamples);
+    }
+}
+
+size_t RenderEQ::getMemoryUsageInBytes() const
+{
+    auto bytes = sizeof(*this) + size_t(inputBuffer.getNumChannels()) * size_t(inputBuffer.getNumSamples()) * sizeof(double);
+
+    //each oversampling stage keeps a buffer at its own rate: 2x, 4x, ... up to the factor
+    if (oversampling != nullptr)
+        bytes += sizeof(*oversampling) + size_t(numChannels) * size_t(maxBlockSize) * size_t(2 * oversamplingFactor - 2) * sizeof(double);
+
+    return bytes;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "MultiBandEQ.h"
+#include "WorkerPool.h"
+
+//the offline bounce version of the biquad chain and the extra bands
+//when the host renders faster than realtime we have the time for oversampling, double precision coefficients and state,
+//and a worker from the shared pool so the channels are filtered side by side
+//the designs are kept up to date during playback too, so switching over when a bounce starts costs nothing
+class RenderEQ
+{
+public:
+    static constexpr int maxChannels = 2;
+    //the peak first, then a fixed slot for every section of every extra band, the cuts have their own CutFilters
+    static constexpr int peakSlot = 0, firstBandSlot = 1;
+    static constexpr int numSlots = firstBandSlot + ChainSettings::numExtraBands * maxSectionsPerBand;
+    //how many of the dynamic peak's control periods one process call can take
+    static constexpr int maxPeakPeriods = 64;
+
+    RenderEQ();
+    ~RenderEQ();
+
+    //oversamplingFactor is 1, 2, 4 or 8, this allocates so it only gets called from prepareToPlay
+    //blocks longer than maxBlockSize are split up, so the block size doesn't need to be exact
+    void prepare(double sampleRate, int numChannels, int maxBlockSize, int oversamplingFactor, bool multithreaded);
+    void reset();
+    bool isPrepared() const { return designRate > 0; }
+
+    //closed form designs at the oversampled rate, each side and the bands are only redesigned when they change
+    void setChainSettings(const ChainSettings& left, const ChainSettings& right);
+    //the dynamic peak band, the same as UpdateDynamicPeakGain does for the realtime chains but for a whole block:
+    //each call adds the gains of the next DynamicBand::controlInterval samples, and the next process call uses them
+    //instead of the static gain. a block can't be longer than maxPeakPeriods of them
+    void addPeakGains(float leftGainInDb, float rightGainInDb);
+
+    //midSide turns channels 0/1 from left/right into mid/side as they're copied in, and back into left/right
+    //between the chain and the extra bands, like MultiBandEQ
+    void process(juce::dsp::AudioBlock<float>& block, bool midSide);
+
+    //whole samples, the oversampling filters are set up for integer latency
+    int getLatencyInSamples() const { return latency; }
+
+    //the conversion buffer and the oversampler's stage buffers
+    size_t getMemoryUsageInBytes() const;
+
+private:
+    using Section = BiquadCoefficientsOf<double>;
+
+    struct Side
+    {
+        CutSections<double> lowCut, highCut;
+        std::array<Section, numSlots> sections {};
+        std::array<bool, numSlots> active {};
+        ChainSettings settings;
+        bool hasSettings {false};
+    };
+
+    struct ChannelState
+    {
+        CutState<double> lowCut, highCut;
+        std::array<double, numSlots> s1 {}, s2 {};
+    };
+
+    //the chain (lowcut, peak, highcut) runs on mid/side, the extra bands always on left/right
+    enum class Part
+    {
+        Chain,
+        Bands,
+        Everything
+    };
+
+    void DesignSide(Side& side, const ChainSettings& chainSettings);
+    void DesignBands(const ChainSettings& chainSettings);
+    void ProcessPart(Part part);
+    void ProcessHelperChannels();
+    void ProcessChannel(int channel, Part part);
+    void ProcessDynamicPeak(int channel);
+    void ProcessSlots(int channel, int firstSlot, int lastSlot);
+
+    double designRate {0};
+    int numChannels {0}, maxBlockSize {0}, oversamplingFactor {1}, latency {0};
+
+    std::array<Side, maxChannels> sides;
+    std::array<BandSettings, ChainSettings::numExtraBands> bands;
+    bool hasBands {false};
+    std::array<ChannelState, maxChannels> states;
+
+    juce::AudioBuffer<double> inputBuffer;
+    std::unique_ptr<juce::dsp::Oversampling<double>> oversampling;
+    //the block being filtered right now, at the oversampled rate, and where it starts in the block process was given
+    juce::dsp::AudioBlock<double> oversampledBlock;
+    size_t oversampledBlockStart {0};
+
+    //the dynamic peak's sections for each control period of the next process call, one per side
+    std::array<std::array<Section, maxChannels>, maxPeakPeriods> peakPeriods {};
+    std::array<float, maxChannels> lastPeakGains {};
+    int numPeakPeriods {0};
+
+    //a pool worker takes the odd channels while the calling thread does the even ones, and whichever of them gets to
+    //helperClaimed first does them, so a busy pool means the calling thread does them itself instead of waiting
+    bool multithreaded {false};
+    std::atomic<bool> helperClaimed {true};
+    juce::WaitableEvent helperFinished;
+    Part jobPart {Part::Everything};
+
+    //last, so the trigger is stopped before anything its job uses is destroyed, and before its client
+    WorkerPool::Client workers;
+    WorkerPool::Trigger helperTrigger {workers, [this] { ProcessHelperChannels(); }};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderEQ)
+};
@@ -0,0 +1,201 @@
+#include "ResponseAnalysis.h"
+#include "MultiBandEQ.h"
+
+std::vector<BiquadCoefficients> MakeChainSections(const ChainSettings& chainSettings, double sampleRate)
+{
+    std::vector<BiquadCoefficients> sections;
+    auto side = MakeSideCoefficients(chainSettings, sampleRate);
+
+    //only the sections each slope uses, same as CopyCutFilter
+    if (!chainSettings.lowCutBypassed)
+        sections.insert(sections.end(), side.lowCut.begin(), side.lowCut.begin() + GetNumCutSections(chainSettings.lowCutSlope));
+    if (!chainSettings.peakBypassed)
+        sections.push_back(side.peak);
+    if (!chainSettings.highCutBypassed)
+        sections.insert(sections.end(), side.highCut.begin(), side.highCut.begin() + GetNumCutSections(chainSettings.highCutSlope));
+
+    std::array<BiquadCoefficients, maxSectionsPerBand> bandSections;
+    for (const auto& band : chainSettings.bands)
+    {
+        auto numSections = MakeBandSections(band, sampleRate, bandSections);
+        sections.insert(sections.end(), bandSections.begin(), bandSections.begin() + numSections);
+    }
+
+    return sections;
+}
+
+std::vector<double> MakeLogFrequencyGrid(int numPoints, double low, double high)
+{
+    std::vector<double> frequencies((size_t) juce::jmax(0, numPoints));
+    for (int i = 0; i < numPoints; i++)
+        frequencies[(size_t) i] = numPoints > 1 ? low * std::pow(high / low, double(i) / (numPoints - 1)) : low;
+    return frequencies;
+}
+
+ResponseCurve AnalyseResponse(const std::vector<BiquadCoefficients>& sections, const std::vector<double>& frequencies, double sampleRate)
+{
+    ResponseCurve curve;
+    curve.magnitudeInDb.resize(frequencies.size());
+    curve.phaseInRadians.resize(frequencies.size());
+    curve.groupDelayInSamples.resize(frequencies.size());
+
+    for (size_t f = 0; f < frequencies.size(); f++)
+    {
+        auto omega = juce::MathConstants<double>::twoPi * frequencies[f] / sampleRate;
+        std::complex<double> z1 = std::polar(1.0, -omega);
+        std::complex<double> z2 = z1 * z1;
+
+        std::complex<double> response (1.0, 0.0);
+        double groupDelay = 0;
+
+        for (const auto& c : sections)
+        {
+            auto numerator = double(c.b0) + double(c.b1) * z1 + double(c.b2) * z2;
+            auto denominator = 1.0 + double(c.a1) * z1 + double(c.a2) * z2;
+            response *= numerator / denominator;
+
+            //the group delay of a polynomial in z^-1 is re(sum(k * p_k * z^-k) / sum(p_k * z^-k)),
+            //and a section's is its numerator's minus its denominator's
+            auto numeratorRamp = double(c.b1) * z1 + 2.0 * double(c.b2) * z2;
+            auto denominatorRamp = double(c.a1) * z1 + 2.0 * double(c.a2) * z2;
+            if (std::abs(numerator) > 0)
+                groupDelay += (numeratorRamp / numerator).real();
+            groupDelay -= (denominatorRamp / denominator).real();
+        }
+
+        curve.magnitudeInDb[f] = juce::Decibels::gainToDecibels(std::abs(response), -300.0);
+        curve.phaseInRadians[f] = std::arg(response);
+        curve.groupDelayInSamples[f] = groupDelay;
+    }
+
+    return curve;
+}
+
+std::vector<float> RenderImpulseResponse(const std::vector<BiquadCoefficients>& sections, int length)
+{
+    std::vector<float> impulse((size_t) juce::jmax(0, length), 0.f);
+    if (impulse.empty())
+        return impulse;
+
+    impulse[0] = 1.f;
+
+    //section by section over the whole buffer, same transposed direct form II as IIR::Filter
+    for (const auto& c : sections)
+    {
+        float s1 = 0, s2 = 0;
+        for (auto& sample : impulse)
+        {
+            auto in = sample;
+            auto out = in * c.b0 + s1;
+            s1 = (in * c.b1) - (out * c.a1) + s2;
+            s2 = (in * c.b2) - (out * c.a2);
+            sample = out;
+        }
+    }
+
+    return impulse;
+}
+
+std::vector<ResponseResult> AnalyseResponses(const std::vector<ChainSettings>& settings, double sampleRate,
+                                             const std::vector<double>& frequencies, int impulseLength, int numThreads)
+{
+    std::vector<ResponseResult> results(settings.size());
+
+    auto analyseRange = [&](size_t start, size_t end)
+    {
+        for (auto i = start; i < end; i++)
+        {
+            auto sections = MakeChainSections(settings[i], sampleRate);
+            results[i].curve = AnalyseResponse(sections, frequencies, sampleRate);
+            if (impulseLength > 0)
+                results[i].impulse = RenderImpulseResponse(sections, impulseLength);
+        }
+    };
+
+    if (numThreads <= 0)
+        numThreads = juce::SystemStats::getNumCpus();
+
+    //not worth starting threads for a handful
+    if (numThreads == 1 || settings.size() < 64)
+    {
+        analyseRange(0, settings.size());
+        return results;
+    }
+
+    //a few chunks per thread so a slow chunk doesn't hold everyone up
+    auto numChunks = (size_t) numThreads * 4;
+    auto chunkSize = (settings.size() + numChunks - 1) / numChunks;
+
+    juce::ThreadPool pool (numThreads);
+    juce::WaitableEvent finished;
+    std::atomic<int> remaining { 0 };
+
+    for (size_t start = 0; start < settings.size(); start += chunkSize)
+        remaining++;
+
+    for (size_t start = 0; start < settings.size(); start += chunkSize)
+    {
+        auto end = juce::jmin(settings.size(), start + chunkSize);
+        pool.addJob([&, start, end]
+        {
+            analyseRange(start, end);
+            if (--remaining == 0)
+                finished.signal();
+        });
+    }
+
+    finished.wait();
+    return results;
+}
+
+void WriteResponsesCsv(juce::OutputStream& stream, const juce::StringArray& labels, const std::vector<double>& frequencies,
+                       const std::vector<ResponseResult>& results)
+{
+    stream << "label,frequency,magnitude_db,phase_rad,group_delay_samples\n";
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        auto label = labels[(int) r].replace(",", ";");
+        const auto& curve = results[r].curve;
+        for (size_t f = 0; f < frequencies.size(); f++)
+            stream << label << "," << frequencies[f] << "," << curve.magnitudeInDb[f] << ","
+                   << curve.phaseInRadians[f] << "," << curve.groupDelayInSamples[f] << "\n";
+    }
+
+    //impulse responses come after all the curves as their own table
+    if (results.empty() || results.front().impulse.empty())
+        return;
+
+    stream << "\nlabel,sample,value\n";
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        auto label = labels[(int) r].replace(",", ";");
+        const auto& impulse = results[r].impulse;
+        for (size_t n = 0; n < impulse.size(); n++)
+            stream << label << "," << (int) n << "," << impulse[n] << "\n";
+    }
+}
+
+void WriteResponsesBinary(juce::OutputStream& stream, const std::vector<double>& frequencies, int impulseLength,
+                          const std::vector<ResponseResult>& results)
+{
+    stream.writeInt(0x52514553); //"SEQR"
+    stream.writeInt(1);
+    stream.writeInt((int) results.size());
+    stream.writeInt((int) frequencies.size());
+    stream.writeInt(impulseLength);
+
+    for (auto frequency : frequencies)
+        stream.writeDouble(frequency);
+
+    for (const auto& result : results)
+    {
+        for (auto value : result.curve.magnitudeInDb)
+            stream.writeFloat(float(value));
+        for (auto value : result.curve.phaseInRadians)
+            stream.writeFloat(float(value));
+        for (auto value : result.curve.groupDelayInSamples)
+            stream.writeFloat(float(value));
+        for (int n = 0; n < impulseLength; n++)
+            stream.writeFloat(n < (int) result.impulse.size() ? result.impulse[(size_t) n] : 0.f);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//offline analysis of the eq curve straight from the coefficients, no audio gets rendered through the plugin
+//the sections are designed with the same designers the processor uses, so the numbers match what it plays
+
+//every biquad one side of the eq runs, in processing order (cuts and peak first, then the extra bands)
+std::vector<BiquadCoefficients> MakeChainSections(const ChainSettings& chainSettings, double sampleRate);
+
+//log spaced frequencies from low to high, both included
+std::vector<double> MakeLogFrequencyGrid(int numPoints, double low = 20.0, double high = 20000.0);
+
+struct ResponseCurve
+{
+    std::vector<double> magnitudeInDb, phaseInRadians, groupDelayInSamples;
+};
+
+ResponseCurve AnalyseResponse(const std::vector<BiquadCoefficients>& sections, const std::vector<double>& frequencies, double sampleRate);
+std::vector<float> RenderImpulseResponse(const std::vector<BiquadCoefficients>& sections, int length);
+
+struct ResponseResult
+{
+    ResponseCurve curve;
+    std::vector<float> impulse;
+};
+
+//analyses every ChainSettings, split across numThreads workers (0 = one per core)
+//impulseLength 0 skips the impulse responses
+std::vector<ResponseResult> AnalyseResponses(const std::vector<ChainSettings>& settings, double sampleRate,
+                                             const std::vector<double>& frequencies, int impulseLength, int numThreads = 0);
+
+//one row per frequency (and per impulse sample), labels name each result
+void WriteResponsesCsv(juce::OutputStream& stream, const juce::StringArray& labels, const std::vector<double>& frequencies,
+                       const std::vector<ResponseResult>& results);
+
+//layout (little endian):
+//  int    magic ("SEQR")
+//  int    version
+//  int    number of results, int number of frequencies, int impulse length
+//  double frequencies
+//  then for every result: float magnitudes in db, float phases, float group delays, float impulse
+void WriteResponsesBinary(juce::OutputStream& stream, const std::vector<double>& frequencies, int impulseLength,
+                          const std::vector<ResponseResult>& results);
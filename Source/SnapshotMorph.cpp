@@ -0,0 +1,250 @@
+#include "SnapshotMorph.h"
+
+void SnapshotMorph::setSnapshot(int slot, const ChainSettings& left, const ChainSettings& right)
+{
+    jassert(slot >= 0 && slot < maxSnapshots);
+    {
+        const juce::SpinLock::ScopedLockType lock(snapshotsLock);
+        snapshots[(size_t) slot] = { true, left, right };
+    }
+    snapshotsChanged = true;
+}
+
+void SnapshotMorph::clearSnapshot(int slot)
+{
+    jassert(slot >= 0 && slot < maxSnapshots);
+    {
+        const juce::SpinLock::ScopedLockType lock(snapshotsLock);
+        snapshots[(size_t) slot] = {};
+    }
+    snapshotsChanged = true;
+}
+
+SnapshotMorph::Snapshot SnapshotMorph::getSnapshot(int slot) const
+{
+    jassert(slot >= 0 && slot < maxSnapshots);
+    const juce::SpinLock::ScopedLockType lock(snapshotsLock);
+    return snapshots[(size_t) slot];
+}
+
+static void WriteSettings(juce::OutputStream& stream, const ChainSettings& settings)
+{
+    stream.writeFloat(settings.lowCutFreq);
+    stream.writeFloat(settings.highCutFreq);
+    stream.writeFloat(settings.peakFreq);
+    stream.writeFloat(settings.peakGainInDb);
+    stream.writeFloat(settings.peakQuality);
+    stream.writeInt(settings.lowCutSlope);
+    stream.writeInt(settings.highCutSlope);
+    stream.writeBool(settings.lowCutBypassed);
+    stream.writeBool(settings.peakBypassed);
+    stream.writeBool(settings.highCutBypassed);
+
+    for (const auto& band : settings.bands)
+    {
+        stream.writeInt(band.type);
+        stream.writeFloat(band.freq);
+        stream.writeFloat(band.gainInDb);
+        stream.writeFloat(band.quality);
+        stream.writeBool(band.enabled);
+    }
+}
+
+static void ReadSettings(juce::InputStream& stream, ChainSettings& settings)
+{
+    settings.lowCutFreq = stream.readFloat();
+    settings.highCutFreq = stream.readFloat();
+    settings.peakFreq = stream.readFloat();
+    settings.peakGainInDb = stream.readFloat();
+    settings.peakQuality = stream.readFloat();
+    settings.lowCutSlope = juce::jlimit(0, numSlopes - 1, stream.readInt());
+    settings.highCutSlope = juce::jlimit(0, numSlopes - 1, stream.readInt());
+    settings.lowCutBypassed = stream.readBool();
+    settings.peakBypassed = stream.readBool();
+    settings.highCutBypassed = stream.readBool();
+
+    for (auto& band : settings.bands)
+    {
+        band.type = stream.readInt();
+        band.freq = stream.readFloat();
+        band.gainInDb = stream.readFloat();
+        band.quality = stream.readFloat();
+        band.enabled = stream.readBool();
+    }
+}
+
+void SnapshotMorph::writeToStream(juce::OutputStream& stream) const
+{
+    const juce::SpinLock::ScopedLockType lock(snapshotsLock);
+
+    stream.writeInt(magic);
+    stream.writeInt(currentVersion);
+    stream.writeInt(maxSnapshots);
+
+    for (const auto& snapshot : snapshots)
+    {
+        stream.writeBool(snapshot.stored);
+        if (snapshot.stored)
+        {
+            WriteSettings(stream, snapshot.left);
+            WriteSettings(stream, snapshot.right);
+        }
+    }
+}
+
+bool SnapshotMorph::readFromStream(juce::InputStream& stream)
+{
+    if (stream.getNumBytesRemaining() < 12 || stream.readInt() != magic)
+        return false;
+
+    auto version = stream.readInt();
+    if (version < 1 || version > currentVersion)
+        return false;
+
+    std::array<Snapshot, maxSnapshots> loaded;
+    auto numStored = stream.readInt();
+    for (int i = 0; i < numStored && !stream.isExhausted(); i++)
+    {
+        Snapshot snapshot;
+        snapshot.stored = stream.readBool();
+        if (snapshot.stored)
+        {
+            ReadSettings(stream, snapshot.left);
+            ReadSettings(stream, snapshot.right);
+        }
+
+        if (i < maxSnapshots)
+            loaded[(size_t) i] = snapshot;
+    }
+
+    {
+        const juce::SpinLock::ScopedLockType lock(snapshotsLock);
+        snapshots = loaded;
+    }
+    snapshotsChanged = true;
+    return true;
+}
+
+ChainSettings SnapshotMorph::Interpolate(const ChainSettings& a, const ChainSettings& b, float amount)
+{
+    auto lerp = [amount](float from, float to) { return from + (to - from) * amount; };
+    auto logLerp = [amount](float from, float to) { return from * std::pow(to / from, amount); };
+    auto pick = [amount](auto from, auto to) { return amount < .5f ? from : to; };
+
+    ChainSettings result;
+
+    result.lowCutFreq = logLerp(a.lowCutFreq, b.lowCutFreq);
+    result.highCutFreq = logLerp(a.highCutFreq, b.highCutFreq);
+    result.lowCutSlope = pick(a.lowCutSlope, b.lowCutSlope);
+    result.highCutSlope = pick(a.highCutSlope, b.highCutSlope);
+    result.lowCutBypassed = pick(a.lowCutBypassed, b.lowCutBypassed);
+    result.highCutBypassed = pick(a.highCutBypassed, b.highCutBypassed);
+
+    //a bypassed peak sounds the same as the other snapshot's peak at 0db, so it fades rather than switches
+    auto peakFrom = a;
+    auto peakTo = b;
+    if (a.peakBypassed && !b.peakBypassed)
+    {
+        peakFrom.peakFreq = b.peakFreq;
+        peakFrom.peakQuality = b.peakQuality;
+        peakFrom.peakGainInDb = 0.f;
+    }
+    if (b.peakBypassed && !a.peakBypassed)
+    {
+        peakTo.peakFreq = a.peakFreq;
+        peakTo.peakQuality = a.peakQuality;
+        peakTo.peakGainInDb = 0.f;
+    }
+    result.peakFreq = logLerp(peakFrom.peakFreq, peakTo.peakFreq);
+    result.peakQuality = logLerp(peakFrom.peakQuality, peakTo.peakQuality);
+    result.peakGainInDb = lerp(peakFrom.peakGainInDb, peakTo.peakGainInDb);
+    result.peakBypassed = a.peakBypassed && b.peakBypassed;
+
+    //same for the extra bands whose gain can go to 0db
+    auto canFade = [](const BandSettings& band)
+    {
+        return band.type == BandType::Bell || band.type == BandType::LowShelf
+            || band.type == BandType::HighShelf || band.type == BandType::Tilt;
+    };
+
+    for (size_t i = 0; i < result.bands.size(); i++)
+    {
+        auto from = a.bands[i];
+        auto to = b.bands[i];
+
+        if (!from.enabled && to.enabled && canFade(to))
+        {
+            from = to;
+            from.gainInDb = 0.f;
+        }
+        if (!to.enabled && from.enabled && canFade(from))
+        {
+            to = from;
+            to.gainInDb = 0.f;
+        }
+
+        auto& band = result.bands[i];
+        if (from.enabled == to.enabled && from.type == to.type)
+        {
+            band = from;
+            band.freq = logLerp(from.freq, to.freq);
+            band.quality = logLerp(from.quality, to.quality);
+            band.gainInDb = lerp(from.gainInDb, to.gainInDb);
+        }
+        else
+        {
+            band = pick(from, to);
+        }
+    }
+
+    return result;
+}
+
+bool SnapshotMorph::getMorphedSettings(float position, int numSamples, ChainSettings& left, ChainSettings& right)
+{
+    samplesSinceUpdate += numSamples;
+
+    //if the message thread is storing a snapshot right now we pick it up next block
+    if (snapshotsChanged.load())
+    {
+        juce::SpinLock::ScopedTryLockType lock(snapshotsLock);
+        if (lock.isLocked())
+        {
+            numActive = 0;
+            for (const auto& snapshot : snapshots)
+                if (snapshot.stored)
+                    activeSnapshots[(size_t) numActive++] = snapshot;
+
+            snapshotsChanged = false;
+            lastPosition = -1.f;
+        }
+    }
+
+    if (numActive < 2)
+        return false;
+
+    position = juce::jlimit(0.f, 1.f, position);
+
+    //the ends always land exactly so the morph can settle on a snapshot's own design
+    auto moved = position != lastPosition
+              && (std::abs(position - lastPosition) >= minPositionChange || position == 0.f || position == 1.f);
+
+    if (lastPosition < 0.f || (moved && samplesSinceUpdate >= updateInterval))
+    {
+        auto scaled = position * float(numActive - 1);
+        auto index = juce::jmin(int(scaled), numActive - 2);
+        auto amount = scaled - float(index);
+
+        const auto& from = activeSnapshots[(size_t) index];
+        const auto& to = activeSnapshots[(size_t) index + 1];
+        morphedLeft = Interpolate(from.left, to.left, amount);
+        morphedRight = Interpolate(from.right, to.right, amount);
+
+        lastPosition = position;
+        samplesSinceUpdate = 0;
+    }
+
+    left = morphedLeft;
+    right = morphedRight;
+    return true;
+}
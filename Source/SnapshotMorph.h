@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//blends between stored snapshots of both sides' ChainSettings
+//frequencies and Q are interpolated on a log scale and gains in db, which is where a sweep sounds even
+//switches (slopes, bypasses, band types) flip half way between two snapshots, except a band that is only
+//on in one snapshot, which fades its gain from 0db instead of popping in
+//the morphed settings only change every updateInterval samples and only once the position has moved far enough
+//to hear, so a sweep costs a few closed form designs per block rather than a full redesign
+class SnapshotMorph
+{
+public:
+    static constexpr int maxSnapshots = 4;
+    static constexpr int updateInterval = 64;
+    static constexpr float minPositionChange = 1.f / 1024.f;
+
+    struct Snapshot
+    {
+        bool stored {false};
+        ChainSettings left, right;
+    };
+
+    //message thread
+    void setSnapshot(int slot, const ChainSettings& left, const ChainSettings& right);
+    void clearSnapshot(int slot);
+    Snapshot getSnapshot(int slot) const;
+
+    //snapshots are saved after the parameters in the plugin state
+    void writeToStream(juce::OutputStream& stream) const;
+    bool readFromStream(juce::InputStream& stream);
+
+    //audio thread
+    //position 0..1 runs through the stored snapshots in slot order
+    //returns false if there aren't at least two snapshots to morph between
+    bool getMorphedSettings(float position, int numSamples, ChainSettings& left, ChainSettings& right);
+
+private:
+    static constexpr int magic = 0x4d514553; //"SEQM"
+    static constexpr int currentVersion = 1;
+
+    static ChainSettings Interpolate(const ChainSettings& a, const ChainSettings& b, float amount);
+
+    //written by the message thread, picked up by the audio thread when snapshotsChanged is set
+    mutable juce::SpinLock snapshotsLock;
+    std::array<Snapshot, maxSnapshots> snapshots;
+    std::atomic<bool> snapshotsChanged {true};
+
+    //audio thread copy with the empty slots packed out
+    std::array<Snapshot, maxSnapshots> activeSnapshots;
+    int numActive {0};
+    ChainSettings morphedLeft, morphedRight;
+    float lastPosition {-1.f};
+    int samplesSinceUpdate {0};
+
+    JUCE_LEAK_DETECTOR (SnapshotMorph)
+};
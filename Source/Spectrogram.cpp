@@ -0,0 +1,214 @@
+#include "Spectrogram.h"
+
+SpectrogramAnalyser::SpectrogramAnalyser()
+{
+}
+
+SpectrogramAnalyser::~SpectrogramAnalyser()
+{
+    active = false;
+    analyseTrigger.stop();
+}
+
+void SpectrogramAnalyser::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+}
+
+void SpectrogramAnalyser::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+    UpdateActive();
+}
+
+void SpectrogramAnalyser::setViewOpen(bool isOpen)
+{
+    viewOpen = isOpen;
+    UpdateActive();
+}
+
+void SpectrogramAnalyser::UpdateActive()
+{
+    auto shouldBeActive = enabled.load() && viewOpen.load();
+    if (shouldBeActive == active.load())
+        return;
+
+    if (shouldBeActive)
+    {
+        //nothing on the audio thread looks at the fifo until active is set
+        //the fifos aren't reset, the job might still be finishing off what it read before it was last turned off,
+        //and anything stale in them is only a few columns
+        if (sampleBuffer.empty())
+            sampleBuffer.resize((size_t) fifoSize);
+        if (columns.empty())
+            columns.resize((size_t) (numColumnSlots * maxRows));
+
+        active.store(true, std::memory_order_release);
+    }
+    else
+    {
+        //the audio thread stops firing the job, so there's nothing to stop
+        active.store(false, std::memory_order_release);
+    }
+}
+
+void SpectrogramAnalyser::setFftOrder(int order)
+{
+    fftOrder = juce::jlimit(minFftOrder, maxFftOrder, order);
+}
+
+void SpectrogramAnalyser::setColumnsPerSecond(float newColumnsPerSecond)
+{
+    columnsPerSecond = juce::jlimit(1.f, 500.f, newColumnsPerSecond);
+}
+
+void SpectrogramAnalyser::setNumRows(int newNumRows)
+{
+    numRows = juce::jlimit(1, maxRows, newNumRows);
+}
+
+void SpectrogramAnalyser::pushOutput(const juce::dsp::AudioBlock<float>& block)
+{
+    if (!active.load(std::memory_order_acquire))
+        return;
+
+    //if the analysis is behind the rest is dropped, a column or two goes missing
+    auto numChannels = block.getNumChannels();
+    {
+        const auto scope = sampleFifo.write((int) block.getNumSamples());
+        auto copy = [&](int destination, int size, int offset)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                float sum = 0;
+                for (size_t channel = 0; channel < numChannels; channel++)
+                    sum += block.getSample((int) channel, offset + i);
+                sampleBuffer[(size_t) (destination + i)] = sum;
+            }
+        };
+        copy(scope.startIndex1, scope.blockSize1, 0);
+        copy(scope.startIndex2, scope.blockSize2, scope.blockSize1);
+    }
+
+    //firing never blocks, and it's a no-op while a run is already queued
+    if (sampleFifo.getNumReady() >= analyseThreshold)
+        analyseTrigger.fire();
+}
+
+void SpectrogramAnalyser::Configure()
+{
+    configuredOrder = fftOrder.load();
+    configuredRows = numRows.load();
+    configuredSampleRate = sampleRate.load();
+
+    auto fftSize = 1 << configuredOrder;
+    fft = std::make_unique<juce::dsp::FFT>(configuredOrder);
+    window.resize((size_t) fftSize);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t) fftSize,
+                                                             juce::dsp::WindowingFunction<float>::hann, false);
+    history.assign((size_t) fftSize, 0.f);
+    fftBuffer.assign((size_t) fftSize * 2, 0.f);
+    historyPosition = 0;
+    samplesUntilColumn = 0;
+
+    //the rows are log spaced the same way as the curve, row 0 at 20hz
+    auto binWidth = configuredSampleRate / fftSize;
+    auto lastBin = fftSize / 2;
+    rowBins.resize((size_t) configuredRows);
+    for (int row = 0; row < configuredRows; row++)
+    {
+        auto low = juce::mapToLog10(double(row) / configuredRows, 20.0, 20000.0) / binWidth;
+        auto high = juce::mapToLog10(double(row + 1) / configuredRows, 20.0, 20000.0) / binWidth;
+
+        auto& bins = rowBins[(size_t) row];
+        bins.first = juce::jmin(lastBin, (int) std::ceil(low));
+        bins.last = juce::jmin(lastBin, (int) std::floor(high));
+        bins.fraction = 0;
+
+        if (bins.last < bins.first)
+        {
+            auto centre = juce::jmin(double(lastBin - 1), std::sqrt(low * high));
+            bins.first = (int) centre;
+            bins.last = -1;
+            bins.fraction = float(centre - bins.first);
+        }
+    }
+}
+
+void SpectrogramAnalyser::AnalyseFrame()
+{
+    auto fftSize = 1 << configuredOrder;
+
+    //the history is a ring, the oldest sample is the one about to be overwritten
+    for (int i = 0; i < fftSize; i++)
+        fftBuffer[(size_t) i] = history[(size_t) ((historyPosition + i) & (fftSize - 1))] * window[(size_t) i];
+    std::fill(fftBuffer.begin() + fftSize, fftBuffer.end(), 0.f);
+    fft->performFrequencyOnlyForwardTransform(fftBuffer.data(), true);
+
+    const auto scope = columnFifo.write(1);
+    if (scope.blockSize1 == 0)
+        return;
+
+    //a full scale sine through the hann window comes out at fftSize / 4
+    auto* levels = columns.data() + scope.startIndex1 * maxRows;
+    auto scale = 4.f / fftSize;
+    for (int row = 0; row < configuredRows; row++)
+    {
+        const auto& bins = rowBins[(size_t) row];
+        float magnitude = 0;
+        if (bins.last < 0)
+        {
+            magnitude = juce::jmap(bins.fraction, fftBuffer[(size_t) bins.first], fftBuffer[(size_t) bins.first + 1]);
+        }
+        else
+        {
+            for (int bin = bins.first; bin <= bins.last; bin++)
+                magnitude = juce::jmax(magnitude, fftBuffer[(size_t) bin]);
+        }
+
+        auto db = juce::Decibels::gainToDecibels(magnitude * scale, minDb);
+        levels[configuredRows - 1 - row] = (uint8_t) juce::jlimit(0, 255, juce::roundToInt(juce::jmap(db, minDb, maxDb, 0.f, 255.f)));
+    }
+    columnRows[(size_t) scope.startIndex1] = configuredRows;
+}
+
+void SpectrogramAnalyser::Analyse()
+{
+    if (!active.load(std::memory_order_acquire))
+        return;
+
+    if (configuredOrder != fftOrder.load() || configuredRows != numRows.load() || configuredSampleRate != sampleRate.load())
+        Configure();
+
+    auto fftSize = 1 << configuredOrder;
+    auto hop = configuredSampleRate / columnsPerSecond.load();
+
+    auto ready = sampleFifo.getNumReady();
+    if (ready == 0)
+        return;
+
+    const auto scope = sampleFifo.read(ready);
+    auto take = [&](int start, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            history[(size_t) historyPosition] = sampleBuffer[(size_t) (start + i)];
+            historyPosition = (historyPosition + 1) & (fftSize - 1);
+
+            //a column every hop samples, whatever the fft size
+            if (--samplesUntilColumn <= 0)
+            {
+                AnalyseFrame();
+                samplesUntilColumn += hop;
+            }
+        }
+    };
+    take(scope.startIndex1, scope.blockSize1);
+    take(scope.startIndex2, scope.blockSize2);
+}
+
+size_t SpectrogramAnalyser::getMemoryUsageInBytes() const
+{
+    return sizeof(*this) + sampleBuffer.capacity() * sizeof(float) + columns.capacity()
+         + (window.capacity() + history.capacity() + fftBuffer.capacity()) * sizeof(float) + rowBins.capacity() * sizeof(RowBins);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "WorkerPool.h"
+
+//the output spectrum over time for the spectrogram behind the response curve
+//the audio thread only mixes the output to mono into a fifo while something is showing it, and every so often fires
+//a job on the shared worker pool that does the ffts and turns each one into a finished column: one byte per pixel
+//row, log spaced from 20hz to 20khz
+//through tables worked out once per fft size and height. the editor just copies the columns it gets into its image
+//none of the settings are parameters, they're how the editor looks rather than part of the sound
+class SpectrogramAnalyser
+{
+public:
+    static constexpr int minFftOrder = 10, maxFftOrder = 14, defaultFftOrder = 12;
+    static constexpr int maxRows = 512;
+    static constexpr int fifoSize = 1 << 16;
+    static constexpr int numColumnSlots = 64;
+    //how many samples pile up before the audio thread asks for them to be analysed
+    static constexpr int analyseThreshold = 1024;
+    //the levels a column byte runs over, 0 and below, 255 and above
+    static constexpr float minDb = -100.f, maxDb = 0.f;
+
+    SpectrogramAnalyser();
+    ~SpectrogramAnalyser();
+
+    void prepare(double sampleRate);
+
+    //message thread
+    //whether the user wants it, and whether there's an editor open to show it. it only runs with both
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return enabled.load(); }
+    void setViewOpen(bool isOpen);
+
+    void setFftOrder(int order);
+    int getFftOrder() const { return fftOrder.load(); }
+    //how fast it scrolls, one column per pixel
+    void setColumnsPerSecond(float columnsPerSecond);
+    float getColumnsPerSecond() const { return columnsPerSecond.load(); }
+    //the height of the image the columns are drawn into, capped at maxRows
+    void setNumRows(int numRows);
+
+    //hands every column finished since the last call to drawColumn(const uint8_t* levels, int numRows), oldest first
+    //levels[0] is the top row (20khz)
+    template<typename DrawColumn>
+    int readColumns(DrawColumn&& drawColumn)
+    {
+        auto ready = columnFifo.getNumReady();
+        if (ready == 0)
+            return 0;
+
+        const auto scope = columnFifo.read(ready);
+        scope.forEach([&](int slot)
+        {
+            drawColumn(columns.data() + slot * maxRows, columnRows[(size_t) slot]);
+        });
+        return ready;
+    }
+
+    //audio thread, does nothing unless it's being shown
+    void pushOutput(const juce::dsp::AudioBlock<float>& block);
+
+    size_t getMemoryUsageInBytes() const;
+
+private:
+    //the fft bins one row of pixels covers, or when it's narrower than a bin the two bins either side of its centre
+    struct RowBins
+    {
+        int first {0}, last {0};
+        float fraction {0};
+    };
+
+    void Analyse();
+    void UpdateActive();
+    void Configure();
+    void AnalyseFrame();
+
+    std::atomic<bool> enabled {false}, viewOpen {false}, active {false};
+    std::atomic<int> fftOrder {defaultFftOrder}, numRows {128};
+    std::atomic<float> columnsPerSecond {50.f};
+    std::atomic<double> sampleRate {44100.0};
+
+    //samples from the audio thread, allocated the first time it's shown and kept
+    juce::AbstractFifo sampleFifo {fifoSize};
+    std::vector<float> sampleBuffer;
+
+    //finished columns on their way to the editor
+    juce::AbstractFifo columnFifo {numColumnSlots};
+    std::vector<uint8_t> columns;
+    std::array<int, numColumnSlots> columnRows {};
+
+    //only the analysis job touches these
+    int configuredOrder {0}, configuredRows {0};
+    double configuredSampleRate {0};
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> window, history, fftBuffer;
+    std::vector<RowBins> rowBins;
+    int historyPosition {0};
+    double samplesUntilColumn {0};
+
+    //it only runs with an editor open, so it's always at the front of the queue
+    WorkerPool::Client workers {WorkerPool::visible};
+    WorkerPool::Trigger analyseTrigger {workers, [this] { Analyse(); }};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrogramAnalyser)
+};
@@ -0,0 +1,108 @@
+#include "StateFormat.h"
+
+namespace StateFormat
+{
+
+void WriteBinaryState(juce::AudioProcessorValueTreeState& apvts, juce::MemoryBlock& destData)
+{
+    const auto& parameters = apvts.processor.getParameters();
+
+    destData.reset();
+    destData.ensureSize(size_t(12 + parameters.size() * 8));
+    juce::MemoryOutputStream stream (destData, false);
+
+    stream.writeInt(magic);
+    stream.writeInt(currentVersion);
+    stream.writeInt(parameters.size());
+
+    for (auto* parameter : parameters)
+    {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+        jassert(ranged != nullptr);
+
+        stream.writeInt(ranged->paramID.hashCode());
+        stream.writeFloat(ranged->convertFrom0to1(ranged->getValue()));
+    }
+}
+
+bool ReadBinaryState(juce::AudioProcessorValueTreeState& apvts, const void* data, int sizeInBytes)
+{
+    if (sizeInBytes < 12)
+        return false;
+
+    juce::MemoryInputStream stream (data, (size_t) sizeInBytes, false);
+
+    if (stream.readInt() != magic)
+        return false;
+
+    //a newer version might have changed the layout in ways we can't read
+    auto version = stream.readInt();
+    if (version < 1 || version > currentVersion)
+        return false;
+
+    //in 64 bits, a damaged count could overflow an int and pass the check
+    auto numStored = stream.readInt();
+    if (numStored < 0 || juce::int64(sizeInBytes) < 12 + juce::int64(numStored) * 8)
+        return false;
+
+    const auto& parameters = apvts.processor.getParameters();
+
+    for (int i = 0; i < numStored; i++)
+    {
+        auto idHash = stream.readInt();
+        auto value = stream.readFloat();
+
+        //almost always the parameter is in the same place it was saved from
+        juce::RangedAudioParameter* target = nullptr;
+        if (i < parameters.size())
+        {
+            auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameters.getUnchecked(i));
+            if (ranged != nullptr && ranged->paramID.hashCode() == idHash)
+                target = ranged;
+        }
+
+        //otherwise the layout has changed and we have to look for it
+        if (target == nullptr)
+        {
+            for (auto* parameter : parameters)
+            {
+                auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+                if (ranged != nullptr && ranged->paramID.hashCode() == idHash)
+                {
+                    target = ranged;
+                    break;
+                }
+            }
+        }
+
+        //parameters that don't exist anymore are skipped
+        if (target == nullptr)
+            continue;
+
+        //only parameters that actually change get touched, so listeners only fire for those
+        auto normalised = target->convertTo0to1(value);
+        if (normalised != target->getValue())
+            target->setValueNotifyingHost(normalised);
+    }
+
+    return true;
+}
+
+int GetBinaryStateSize(const void* data, int sizeInBytes)
+{
+    if (sizeInBytes < 12)
+        return 0;
+
+    juce::MemoryInputStream stream (data, (size_t) sizeInBytes, false);
+    if (stream.readInt() != magic)
+        return 0;
+
+    stream.readInt();
+    auto numStored = stream.readInt();
+    if (numStored < 0 || juce::int64(sizeInBytes) < 12 + juce::int64(numStored) * 8)
+        return 0;
+
+    return 12 + numStored * 8;
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//compact binary plugin state
+//
+//layout (little endian):
+//  int   magic ("SEQB")
+//  int   version
+//  int   number of parameters
+//  then for every parameter, in the order they were added to the layout:
+//  int   hash of the parameter id
+//  float denormalised value
+//
+//restoring goes straight into the parameters without building a ValueTree, and only parameters whose value
+//actually changes are touched. the id hashes let us find a parameter that moved if the layout changes
+//in a later version, and parameters that aren't in the blob keep their current value
+namespace StateFormat
+{
+    constexpr int magic = 0x42514553; //"SEQB"
+    constexpr int currentVersion = 1;
+
+    void WriteBinaryState(juce::AudioProcessorValueTreeState& apvts, juce::MemoryBlock& destData);
+
+    //returns false if the data isn't in the binary format (e.g. an old ValueTree session)
+    bool ReadBinaryState(juce::AudioProcessorValueTreeState& apvts, const void* data, int sizeInBytes);
+
+    //how many bytes the parameter blob at the start of data takes up, anything after it belongs to someone else
+    //returns 0 if the data isn't in the binary format
+    int GetBinaryStateSize(const void* data, int sizeInBytes);
+}
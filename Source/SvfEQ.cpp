@@ -0,0 +1,217 @@
+#include "SvfEQ.h"
+
+void SvfEQ::prepare(double newSampleRate, int numChannels)
+{
+    sampleRate = newSampleRate;
+    channels.resize(numChannels);
+
+    //20ms is fast enough to feel like automation and slow enough to not zipper
+    peakFreq.reset(sampleRate, 0.02);
+    peakQuality.reset(sampleRate, 0.02);
+    peakGainInDb.reset(sampleRate, 0.02);
+    lowCutFreq.reset(sampleRate, 0.02);
+    highCutFreq.reset(sampleRate, 0.02);
+
+    hasSettings = false;
+    reset();
+}
+
+void SvfEQ::reset()
+{
+    for (auto& state : channels)
+    {
+        for (auto& section : state.lowCut)
+            section.reset();
+        for (auto& section : state.highCut)
+            section.reset();
+        state.peak.reset();
+    }
+}
+
+void SvfEQ::setChainSettings(const ChainSettings& chainSettings)
+{
+    if (hasSettings && chainSettings == lastSettings)
+        return;
+
+    if (!hasSettings)
+    {
+        //first settings after prepare - jump straight there
+        peakFreq.setCurrentAndTargetValue(chainSettings.peakFreq);
+        peakQuality.setCurrentAndTargetValue(chainSettings.peakQuality);
+        peakGainInDb.setCurrentAndTargetValue(chainSettings.peakGainInDb);
+        lowCutFreq.setCurrentAndTargetValue(chainSettings.lowCutFreq);
+        highCutFreq.setCurrentAndTargetValue(chainSettings.highCutFreq);
+    }
+    else
+    {
+        peakFreq.setTargetValue(chainSettings.peakFreq);
+        peakQuality.setTargetValue(chainSettings.peakQuality);
+        peakGainInDb.setTargetValue(chainSettings.peakGainInDb);
+        lowCutFreq.setTargetValue(chainSettings.lowCutFreq);
+        highCutFreq.setTargetValue(chainSettings.highCutFreq);
+    }
+
+    //the same section tables as the cut filters in the biquad chain
+    auto oldLowCutResonances = lowCutResonances;
+    auto oldHighCutResonances = highCutResonances;
+    auto newLowCutSections = lowCutSections, newHighCutSections = highCutSections;
+    if (!hasSettings || chainSettings.lowCutSlope != lastSettings.lowCutSlope)
+        newLowCutSections = UpdateCutResonances(chainSettings.lowCutSlope, lowCutResonances);
+    if (!hasSettings || chainSettings.highCutSlope != lastSettings.highCutSlope)
+        newHighCutSections = UpdateCutResonances(chainSettings.highCutSlope, highCutResonances);
+
+    //a section that switches between first and second order can't keep its state
+    auto changedOrder = [](float oldK, float newK) { return (oldK == 0.f) != (newK == 0.f); };
+
+    //sections (and bands) that were switched off have stale state, so clear them before they come back in
+    for (auto& state : channels)
+    {
+        for (int i = 0; i < newLowCutSections; i++)
+            if (i >= lowCutSections || changedOrder(oldLowCutResonances[(size_t) i], lowCutResonances[(size_t) i]))
+                state.lowCut[(size_t) i].reset();
+        for (int i = 0; i < newHighCutSections; i++)
+            if (i >= highCutSections || changedOrder(oldHighCutResonances[(size_t) i], highCutResonances[(size_t) i]))
+                state.highCut[(size_t) i].reset();
+
+        if (lowCutBypassed && !chainSettings.lowCutBypassed)
+            for (auto& section : state.lowCut)
+                section.reset();
+        if (highCutBypassed && !chainSettings.highCutBypassed)
+            for (auto& section : state.highCut)
+                section.reset();
+        if (peakBypassed && !chainSettings.peakBypassed)
+            state.peak.reset();
+    }
+
+    lowCutSections = newLowCutSections;
+    highCutSections = newHighCutSections;
+    lowCutBypassed = chainSettings.lowCutBypassed;
+    peakBypassed = chainSettings.peakBypassed;
+    highCutBypassed = chainSettings.highCutBypassed;
+
+    lastSettings = chainSettings;
+    hasSettings = true;
+
+    UpdateCoefficients();
+}
+
+int SvfEQ::UpdateCutResonances(int slope, std::array<float, maxCutSections>& resonances)
+{
+    const auto& table = GetCutSectionTable(slope);
+    for (int i = 0; i < table.numSections; i++)
+    {
+        auto quality = table.qualities[(size_t) i];
+        resonances[(size_t) i] = quality == 0.0 ? 0.f : float(1.0 / quality);
+    }
+    return table.numSections;
+}
+
+void SvfEQ::UpdateCoefficients()
+{
+    //keep the warped frequency below nyquist where tan() blows up
+    auto maxFreq = float(sampleRate * 0.49);
+    auto warp = [this, maxFreq](float freq)
+    {
+        return std::tan(juce::MathConstants<float>::pi * juce::jmin(freq, maxFreq) / float(sampleRate));
+    };
+
+    //bell: k = 1 / (Q * A) and the band output is mixed back in by k * (A^2 - 1)
+    //this is the same curve as IIR::Coefficients::makePeakFilter
+    auto a = juce::Decibels::decibelsToGain(peakGainInDb.getCurrentValue() * .5f);
+    auto peakK = 1.f / (peakQuality.getCurrentValue() * a);
+    peakCoefficients = MakeSvfCoefficients(warp(peakFreq.getCurrentValue()), peakK);
+    peakGainFactor = peakK * (a * a - 1.f);
+
+    //every section of a cut filter shares the same frequency so it's only one tan() per filter
+    auto makeCutSection = [](float g, float k)
+    {
+        return k == 0.f ? MakeOnePoleSvfCoefficients(g) : MakeSvfCoefficients(g, k);
+    };
+
+    auto lowCutG = warp(lowCutFreq.getCurrentValue());
+    for (int i = 0; i < lowCutSections; i++)
+        lowCutCoefficients[(size_t) i] = makeCutSection(lowCutG, lowCutResonances[(size_t) i]);
+
+    auto highCutG = warp(highCutFreq.getCurrentValue());
+    for (int i = 0; i < highCutSections; i++)
+        highCutCoefficients[(size_t) i] = makeCutSection(highCutG, highCutResonances[(size_t) i]);
+}
+
+void SvfEQ::process(juce::dsp::AudioBlock<float>& block, bool encodeMidSide)
+{
+    auto numSamples = block.getNumSamples();
+    encodeMidSide = encodeMidSide && block.getNumChannels() > 1;
+    auto numChannels = juce::jmin(encodeMidSide ? size_t(1) : block.getNumChannels(), channels.size());
+    auto* left = encodeMidSide ? block.getChannelPointer(0) : nullptr;
+    auto* right = encodeMidSide ? block.getChannelPointer(1) : nullptr;
+
+    for (size_t i = 0; i < numSamples; i++)
+    {
+        //while anything is gliding we redesign every sample, this is what the svf is cheap for
+        if (peakFreq.isSmoothing() || peakQuality.isSmoothing() || peakGainInDb.isSmoothing()
+            || lowCutFreq.isSmoothing() || highCutFreq.isSmoothing())
+        {
+            peakFreq.getNextValue();
+            peakQuality.getNextValue();
+            peakGainInDb.getNextValue();
+            lowCutFreq.getNextValue();
+            highCutFreq.getNextValue();
+            UpdateCoefficients();
+        }
+
+        if (encodeMidSide)
+        {
+            auto mid = (left[i] + right[i]) * .5f;
+            auto side = (left[i] - right[i]) * .5f;
+            left[i] = mid;
+            right[i] = side;
+        }
+
+        for (size_t channel = 0; channel < numChannels; channel++)
+        {
+            auto& state = channels[channel];
+            auto* samples = block.getChannelPointer(channel);
+            auto x = samples[i];
+            float band, low;
+
+            //same order as the biquad chain: lowcut, peak, highcut
+            if (!lowCutBypassed)
+            {
+                for (int s = 0; s < lowCutSections; s++)
+                {
+                    auto& c = lowCutCoefficients[(size_t) s];
+                    if (c.k == 0.f)
+                    {
+                        x -= state.lowCut[(size_t) s].tickOnePole(c, x);
+                        continue;
+                    }
+                    state.lowCut[(size_t) s].tick(c, x, band, low);
+                    x = x - c.k * band - low;
+                }
+            }
+
+            if (!peakBypassed)
+            {
+                state.peak.tick(peakCoefficients, x, band, low);
+                x += peakGainFactor * band;
+            }
+
+            if (!highCutBypassed)
+            {
+                for (int s = 0; s < highCutSections; s++)
+                {
+                    auto& c = highCutCoefficients[(size_t) s];
+                    if (c.k == 0.f)
+                    {
+                        x = state.highCut[(size_t) s].tickOnePole(c, x);
+                        continue;
+                    }
+                    state.highCut[(size_t) s].tick(c, x, band, low);
+                    x = low;
+                }
+            }
+
+            samples[i] = x;
+        }
+    }
+}
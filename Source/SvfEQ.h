@@ -0,0 +1,110 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//zero delay feedback (topology preserving transform) state variable filter
+//the coefficients are one tan() for the frequency and a few multiplies for the resonance,
+//and the state stays well behaved when they change every sample, so we can modulate freely
+struct SvfCoefficients
+{
+    float k {2.f}, a1 {1.f}, a2 {0.f}, a3 {0.f};
+};
+
+//g = tan(pi * freq / sampleRate), k = 1 / Q
+inline SvfCoefficients MakeSvfCoefficients(float g, float k)
+{
+    SvfCoefficients c;
+    c.k = k;
+    c.a1 = 1.f / (1.f + g * (g + k));
+    c.a2 = g * c.a1;
+    c.a3 = g * c.a2;
+    return c;
+}
+
+//first order section for the odd slopes, k = 0 marks it and a1 is g / (1 + g)
+inline SvfCoefficients MakeOnePoleSvfCoefficients(float g)
+{
+    SvfCoefficients c;
+    c.k = 0.f;
+    c.a1 = g / (1.f + g);
+    c.a2 = c.a3 = 0.f;
+    return c;
+}
+
+struct SvfState
+{
+    float ic1eq {0}, ic2eq {0};
+
+    //runs one sample through the filter, band and low are the bandpass and lowpass outputs
+    inline void tick(const SvfCoefficients& c, float v0, float& band, float& low) noexcept
+    {
+        auto v3 = v0 - ic2eq;
+        band = c.a1 * ic1eq + c.a2 * v3;
+        low = ic2eq + c.a2 * ic1eq + c.a3 * v3;
+        ic1eq = 2.f * band - ic1eq;
+        ic2eq = 2.f * low - ic2eq;
+    }
+
+    //the one pole version, returns the lowpass output (the highpass is v0 minus it)
+    inline float tickOnePole(const SvfCoefficients& c, float v0) noexcept
+    {
+        auto v = c.a1 * (v0 - ic1eq);
+        auto low = v + ic1eq;
+        ic1eq = low + v;
+        return low;
+    }
+
+    void reset() noexcept { ic1eq = ic2eq = 0.f; }
+};
+
+//alternative to the biquad chain using svfs for every band
+//it takes the same ChainSettings, and the peak and cut frequencies, peak gain and Q are smoothed per sample
+class SvfEQ
+{
+public:
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+
+    //sets new targets, the filters glide to them over the smoothing time
+    void setChainSettings(const ChainSettings& chainSettings);
+
+    //with encodeMidSide the block is the left/right pair: this eq runs on the mid in channel 0, and the side is left
+    //in channel 1 for the other side's eq. both are worked out as each sample is read, not in a pass of their own
+    void process(juce::dsp::AudioBlock<float>& block, bool encodeMidSide = false);
+
+    size_t getMemoryUsageInBytes() const { return sizeof(*this) + GetVectorBytes(channels); }
+
+private:
+    struct ChannelState
+    {
+        std::array<SvfState, maxCutSections> lowCut, highCut;
+        SvfState peak;
+    };
+
+    void UpdateCoefficients();
+    //returns how many sections the slope uses
+    int UpdateCutResonances(int slope, std::array<float, maxCutSections>& resonances);
+
+    double sampleRate {44100.0};
+    std::vector<ChannelState> channels;
+
+    ChainSettings lastSettings;
+    bool hasSettings {false};
+
+    //frequencies and Q glide in the log domain, gain glides in db
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> peakFreq, peakQuality, lowCutFreq, highCutFreq;
+    juce::SmoothedValue<float> peakGainInDb;
+
+    int lowCutSections {1}, highCutSections {1};
+    bool lowCutBypassed {false}, peakBypassed {false}, highCutBypassed {false};
+
+    //k = 1 / Q for every section of each cut filter, 0 for a first order section
+    std::array<float, maxCutSections> lowCutResonances {}, highCutResonances {};
+
+    SvfCoefficients peakCoefficients;
+    std::array<SvfCoefficients, maxCutSections> lowCutCoefficients, highCutCoefficients;
+    float peakGainFactor {0};
+
+    JUCE_LEAK_DETECTOR (SvfEQ)
+};
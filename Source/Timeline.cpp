@@ -0,0 +1,131 @@
+#include "Timeline.h"
+
+#if SIMPLEEQ_TIMELINE
+
+std::atomic<bool> Timeline::recording {false};
+std::atomic<juce::int64> Timeline::sessionStart {0};
+std::atomic<int> Timeline::numThreads {0};
+std::array<Timeline::ThreadBuffer, Timeline::maxThreads> Timeline::threads;
+
+void Timeline::start()
+{
+    for (auto& buffer : threads)
+        if (buffer.events.empty())
+            buffer.events.resize((size_t) eventsPerThread);
+
+    //the rings aren't cleared, something still writing into them would race us. anything older is skipped on export
+    sessionStart = juce::Time::getHighResolutionTicks();
+    recording = true;
+}
+
+void Timeline::stop()
+{
+    recording = false;
+}
+
+Timeline::ThreadBuffer* Timeline::GetThreadBuffer() noexcept
+{
+    //claimed once per thread and kept, even after the thread's gone
+    static thread_local ThreadBuffer* buffer = nullptr;
+    static thread_local bool claimed = false;
+    if (claimed)
+        return buffer;
+
+    claimed = true;
+    auto index = numThreads++;
+    if (index >= maxThreads)
+        return nullptr;
+
+    buffer = &threads[(size_t) index];
+    juce::String name;
+    if (auto* messageManager = juce::MessageManager::getInstanceWithoutCreating(); messageManager != nullptr && messageManager->isThisTheMessageThread())
+        name = "Message thread";
+    else if (auto* thread = juce::Thread::getCurrentThread())
+        name = thread->getThreadName();
+    else
+        name = "Thread " + juce::String(index + 1);
+    name.copyToUTF8(buffer->threadName, sizeof(buffer->threadName));
+    return buffer;
+}
+
+void Timeline::nameThread(const char* name) noexcept
+{
+    if (!isRecording())
+        return;
+
+    if (auto* buffer = GetThreadBuffer())
+        buffer->label.store(name, std::memory_order_relaxed);
+}
+
+void Timeline::Record(const char* name, juce::int64 start, juce::int64 end) noexcept
+{
+    auto* buffer = GetThreadBuffer();
+    if (buffer == nullptr || !isRecording())
+        return;
+
+    auto index = buffer->numWritten.load(std::memory_order_relaxed);
+    buffer->events[(size_t) (index % eventsPerThread)] = { name, start, end };
+    buffer->numWritten.store(index + 1, std::memory_order_release);
+}
+
+bool Timeline::writeChromeTrace(const juce::File& file)
+{
+    file.deleteFile();
+    juce::FileOutputStream stream (file);
+    if (!stream.openedOk())
+        return false;
+
+    writeChromeTrace(stream);
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
+
+void Timeline::writeChromeTrace(juce::OutputStream& stream)
+{
+    auto origin = sessionStart.load();
+    auto microsecondsPerTick = 1.0e6 / double(juce::Time::getHighResolutionTicksPerSecond());
+    auto toMicroseconds = [&](juce::int64 ticks) { return juce::String(double(ticks - origin) * microsecondsPerTick, 3); };
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    auto separator = "\n";
+
+    auto numBuffers = juce::jmin(maxThreads, numThreads.load());
+    std::vector<Event> events;
+    for (int thread = 0; thread < numBuffers; thread++)
+    {
+        auto& buffer = threads[(size_t) thread];
+        if (buffer.events.empty())
+            continue;
+
+        auto* label = buffer.label.load(std::memory_order_relaxed);
+        stream << separator << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread + 1
+               << ",\"args\":{\"name\":" << juce::JSON::toString(juce::String(label != nullptr ? label : buffer.threadName)) << "}}";
+        separator = ",\n";
+
+        //the newest events, copied out while the thread might still be writing
+        auto end = buffer.numWritten.load(std::memory_order_acquire);
+        auto begin = end > (juce::uint64) eventsPerThread ? end - (juce::uint64) eventsPerThread : juce::uint64(0);
+        events.clear();
+        for (auto index = begin; index < end; index++)
+            events.push_back(buffer.events[(size_t) (index % eventsPerThread)]);
+
+        //whatever got written over while we were copying is thrown away
+        auto written = buffer.numWritten.load(std::memory_order_acquire);
+        auto firstIntact = written > (juce::uint64) eventsPerThread ? written - (juce::uint64) eventsPerThread : juce::uint64(0);
+        auto skip = (size_t) (juce::jmin(end, juce::jmax(begin, firstIntact)) - begin);
+
+        for (auto event = events.begin() + (std::ptrdiff_t) skip; event != events.end(); ++event)
+        {
+            if (event->start < origin || event->name == nullptr)
+                continue;
+
+            stream << separator << "{\"ph\":\"X\",\"name\":" << juce::JSON::toString(juce::String(event->name))
+                   << ",\"pid\":1,\"tid\":" << thread + 1 << ",\"ts\":" << toMicroseconds(event->start)
+                   << ",\"dur\":" << juce::String(double(event->end - event->start) * microsecondsPerTick, 3) << "}";
+        }
+    }
+
+    stream << "\n]}\n";
+}
+
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//timeline tracing, for lining an audio dropout up with what the gui and the design code were doing at the time
+//it's only built with SIMPLEEQ_TIMELINE=1 (add it to the exporter's preprocessor definitions), otherwise the
+//markers below are empty and none of this exists
+#ifndef SIMPLEEQ_TIMELINE
+ #define SIMPLEEQ_TIMELINE 0
+#endif
+
+#if SIMPLEEQ_TIMELINE
+
+//every thread that hits a marker gets its own ring of events the first time it does, so recording one is two
+//clock reads and a store with no locks. the rings are shared by every instance in the process and keep the most
+//recent events, the export is chrome's trace event json (chrome://tracing or ui.perfetto.dev)
+class Timeline
+{
+public:
+    //a few seconds of a busy audio thread each, a thread that turns up after they're all taken isn't recorded
+    static constexpr int maxThreads = 32;
+    static constexpr int eventsPerThread = 1 << 13;
+
+    //message thread
+    //the rings are allocated by the first start and kept, so a later start only forgets what's in them
+    static void start();
+    static void stop();
+    static bool isRecording() { return recording.load(std::memory_order_relaxed); }
+    //everything recorded since start, safe to call while still recording
+    static bool writeChromeTrace(const juce::File& file);
+    static void writeChromeTrace(juce::OutputStream& stream);
+
+    //what the calling thread shows up as, for threads that aren't juce::Threads (a host's audio thread)
+    //the name has to be a literal, only the pointer is kept
+    static void nameThread(const char* name) noexcept;
+
+    //one marker, from construction to destruction. the name has to be a literal, only the pointer is kept
+    class Scope
+    {
+    public:
+        explicit Scope(const char* eventName) noexcept
+            : name(eventName), start(isRecording() ? juce::Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (start != 0)
+                Record(name, start, juce::Time::getHighResolutionTicks());
+        }
+
+    private:
+        const char* name;
+        juce::int64 start;
+
+        JUCE_DECLARE_NON_COPYABLE (Scope)
+    };
+
+private:
+    struct Event
+    {
+        const char* name {nullptr};
+        juce::int64 start {0}, end {0};
+    };
+
+    struct ThreadBuffer
+    {
+        std::vector<Event> events;
+        //only ever goes up, the slot for event n is n % eventsPerThread
+        std::atomic<juce::uint64> numWritten {0};
+        std::atomic<const char*> label {nullptr};
+        char threadName[64] {};
+    };
+
+    static void Record(const char* name, juce::int64 start, juce::int64 end) noexcept;
+    static ThreadBuffer* GetThreadBuffer() noexcept;
+
+    static std::atomic<bool> recording;
+    static std::atomic<juce::int64> sessionStart;
+    static std::atomic<int> numThreads;
+    static std::array<ThreadBuffer, maxThreads> threads;
+};
+
+ #define SIMPLEEQ_TIMELINE_SCOPE(name) const Timeline::Scope JUCE_JOIN_MACRO (timelineScope, __LINE__) (name)
+ #define SIMPLEEQ_TIMELINE_THREAD(name) Timeline::nameThread (name)
+
+#else
+
+ #define SIMPLEEQ_TIMELINE_SCOPE(name)
+ #define SIMPLEEQ_TIMELINE_THREAD(name)
+
+#endif
@@ -0,0 +1,416 @@
+#include "WorkerPool.h"
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <semaphore.h>
+ #include <cerrno>
+#endif
+
+//posting is a single call that never locks on any of these (sem_post is even safe from a signal handler),
+//only the waiting side goes into the kernel
+struct WorkerPool::WakeSemaphore
+{
+   #if JUCE_WINDOWS
+    HANDLE handle {CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr)};
+    ~WakeSemaphore() { CloseHandle(handle); }
+    void post() noexcept { ReleaseSemaphore(handle, 1, nullptr); }
+    void wait() { WaitForSingleObject(handle, INFINITE); }
+   #elif JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_t handle {dispatch_semaphore_create(0)};
+    ~WakeSemaphore() { dispatch_release(handle); }
+    void post() noexcept { dispatch_semaphore_signal(handle); }
+    void wait() { dispatch_semaphore_wait(handle, DISPATCH_TIME_FOREVER); }
+   #else
+    sem_t handle;
+    WakeSemaphore() { sem_init(&handle, 0, 0); }
+    ~WakeSemaphore() { sem_destroy(&handle); }
+    void post() noexcept { sem_post(&handle); }
+    void wait() { while (sem_wait(&handle) != 0 && errno == EINTR) {} }
+   #endif
+};
+
+thread_local WorkerPool::Worker* WorkerPool::currentWorker = nullptr;
+thread_local WorkerPool::Job* WorkerPool::currentJob = nullptr;
+
+WorkerPool::WorkerPool() : wakeSemaphore(std::make_unique<WakeSemaphore>())
+{
+    //one core is left for the host's audio thread
+    auto numWorkers = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+    for (int i = 0; i < numWorkers; i++)
+        workers.add(new Worker(*this, i));
+
+    for (auto* worker : workers)
+        worker->startThread();
+}
+
+WorkerPool::~WorkerPool()
+{
+    //every client and trigger is gone by now, so nothing queued is still wanted
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+    //one post each, since every one of them might be asleep
+    for (int i = 0; i < workers.size(); i++)
+        wakeSemaphore->post();
+    for (auto* worker : workers)
+        worker->stopThread(5000);
+}
+
+bool WorkerPool::isCurrentJobCancelled()
+{
+    auto* job = currentJob;
+    if (job == nullptr)
+        return false;
+
+    if (job->trigger != nullptr)
+        return job->trigger->state.load() == Trigger::firedWhileRunning || job->trigger->stopped.load();
+
+    return job->cancelled.load() || job->client->closed.load();
+}
+
+WorkerPool::Worker::Worker(WorkerPool& owner, int workerIndex)
+    : juce::Thread("SimpleEQ Worker " + juce::String(workerIndex + 1)), pool(owner), index(workerIndex)
+{
+}
+
+void WorkerPool::Worker::run()
+{
+    currentWorker = this;
+
+    while (!threadShouldExit())
+    {
+        pool.QueueFiredTriggers();
+
+        if (auto job = pool.Take(*this))
+        {
+            //one wake-up can stand for several jobs or fires, so whatever's left goes to the next idle worker
+            if (pool.HasWork())
+                pool.Wake();
+
+            pool.Run(job);
+            continue;
+        }
+
+        //anything queued after we said we're idle sees us and wakes someone, anything before it this look finds
+        pool.numIdle++;
+        if (!pool.HasWork())
+        {
+            pool.wakeSemaphore->wait();
+            pool.wakePending = false;
+        }
+        pool.numIdle--;
+    }
+
+    currentWorker = nullptr;
+}
+
+void WorkerPool::Enqueue(const JobPointer& job)
+{
+    auto priority = juce::jlimit(0, numPriorities - 1, job->client->priority.load());
+
+    //a job a job submits stays on its worker, everything else is dealt round
+    auto* worker = currentWorker;
+    if (worker == nullptr || &worker->pool != this)
+        worker = workers.getUnchecked(int(nextWorker++ % (unsigned int) workers.size()));
+
+    {
+        const juce::ScopedLock lock(worker->lock);
+        worker->queues[(size_t) priority].push_back(job);
+        numQueued[(size_t) priority]++;
+    }
+
+    //whoever wakes up takes it, from its own queue or by stealing it
+    Wake();
+}
+
+void WorkerPool::Wake() noexcept
+{
+    if (numIdle.load() > 0 && !wakePending.exchange(true))
+        wakeSemaphore->post();
+}
+
+WorkerPool::JobPointer WorkerPool::Take(Worker& worker)
+{
+    for (int priority = numPriorities - 1; priority >= 0; priority--)
+    {
+        if (numQueued[(size_t) priority].load() == 0)
+            continue;
+
+        //our own queue oldest first, so one instance's jobs run in the order it asked for them
+        {
+            const juce::ScopedLock lock(worker.lock);
+            auto& queue = worker.queues[(size_t) priority];
+            if (!queue.empty())
+            {
+                auto job = std::move(queue.front());
+                queue.pop_front();
+                numQueued[(size_t) priority]--;
+                return job;
+            }
+        }
+
+        //then the newest from someone else's, which is the end its owner gets to last
+        for (int offset = 1; offset < workers.size(); offset++)
+        {
+            auto* victim = workers.getUnchecked((worker.index + offset) % workers.size());
+            const juce::ScopedLock lock(victim->lock);
+            auto& queue = victim->queues[(size_t) priority];
+            if (!queue.empty())
+            {
+                auto job = std::move(queue.back());
+                queue.pop_back();
+                numQueued[(size_t) priority]--;
+                return job;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+bool WorkerPool::HasWork() const
+{
+    if (firedTriggers.load() != nullptr)
+        return true;
+
+    for (const auto& count : numQueued)
+        if (count.load() > 0)
+            return true;
+
+    return false;
+}
+
+void WorkerPool::Run(const JobPointer& job)
+{
+    auto* previousJob = currentJob;
+    currentJob = job.get();
+
+    if (job->trigger != nullptr)
+    {
+        RunTrigger(job);
+    }
+    else
+    {
+        //cancelled jobs are left in the queues and just skipped when they come up
+        if (!job->cancelled.load() && !job->client->closed.load())
+            job->function();
+        job->client->numOutstanding--;
+    }
+
+    currentJob = previousJob;
+}
+
+void WorkerPool::RunTrigger(const JobPointer& job)
+{
+    auto& trigger = *job->trigger;
+    trigger.state = Trigger::running;
+    if (!trigger.stopped.load())
+        job->function();
+
+    auto expected = int(Trigger::running);
+    if (trigger.state.compare_exchange_strong(expected, Trigger::idle))
+        return;
+
+    //fired again while it was running, so it goes straight back in the queue
+    //once it's idle the trigger can be destroyed, so nothing here touches it after that
+    if (trigger.stopped.load())
+    {
+        trigger.state = Trigger::idle;
+        return;
+    }
+
+    trigger.state = Trigger::queued;
+    Enqueue(job);
+}
+
+void WorkerPool::QueueFiredTriggers()
+{
+    //taking the whole list at once means the pushes never have to worry about a pop in the middle of them
+    auto* trigger = firedTriggers.exchange(nullptr);
+    while (trigger != nullptr)
+    {
+        //read before queueing, once it's queued it can run and be fired again
+        auto* next = trigger->nextFired;
+        Enqueue(trigger->job);
+        trigger = next;
+    }
+}
+
+void WorkerPool::RemoveQueued(const ClientState& client)
+{
+    for (auto* worker : workers)
+    {
+        const juce::ScopedLock lock(worker->lock);
+        for (size_t priority = 0; priority < worker->queues.size(); priority++)
+        {
+            auto& queue = worker->queues[priority];
+            for (auto it = queue.begin(); it != queue.end();)
+            {
+                //a trigger's job stays, its trigger is waiting for it to come round
+                if ((*it)->client.get() != &client || (*it)->trigger != nullptr)
+                {
+                    ++it;
+                    continue;
+                }
+
+                (*it)->client->numOutstanding--;
+                it = queue.erase(it);
+                numQueued[priority]--;
+            }
+        }
+    }
+}
+
+void WorkerPool::Requeue(const ClientState& client, int newPriority)
+{
+    for (auto* worker : workers)
+    {
+        const juce::ScopedLock lock(worker->lock);
+        auto& destination = worker->queues[(size_t) newPriority];
+        for (size_t priority = 0; priority < worker->queues.size(); priority++)
+        {
+            if ((int) priority == newPriority)
+                continue;
+
+            auto& queue = worker->queues[priority];
+            for (auto it = queue.begin(); it != queue.end();)
+            {
+                if ((*it)->client.get() != &client)
+                {
+                    ++it;
+                    continue;
+                }
+
+                destination.push_back(std::move(*it));
+                it = queue.erase(it);
+                numQueued[priority]--;
+                numQueued[(size_t) newPriority]++;
+            }
+        }
+    }
+}
+
+//==============================================================================
+WorkerPool::Client::Client(Priority priority) : state(std::make_shared<ClientState>())
+{
+    state->priority = priority;
+}
+
+WorkerPool::Client::~Client()
+{
+    //nothing new gets in, nothing queued runs, and the running jobs see isCurrentJobCancelled()
+    state->closed = true;
+    pool->RemoveQueued(*state);
+    while (state->numOutstanding.load() > 0)
+        juce::Thread::sleep(1);
+}
+
+void WorkerPool::Client::submit(std::function<void()> function)
+{
+    if (state->closed.load())
+        return;
+
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+    job->client = state;
+    state->numOutstanding++;
+    pool->Enqueue(job);
+}
+
+void WorkerPool::Client::submitLatest(int key, std::function<void()> function)
+{
+    if (state->closed.load())
+        return;
+
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+    job->client = state;
+
+    {
+        const juce::ScopedLock lock(latestLock);
+        auto& previous = latest[key];
+        if (auto stale = previous.lock())
+            stale->cancelled = true;
+        previous = job;
+    }
+
+    state->numOutstanding++;
+    pool->Enqueue(job);
+}
+
+void WorkerPool::Client::setPriority(Priority priority)
+{
+    if (state->priority.exchange(priority) != priority)
+        pool->Requeue(*state, priority);
+}
+
+//==============================================================================
+WorkerPool::Trigger::Trigger(Client& client, std::function<void()> function)
+    : pool(*client.pool.get()), job(std::make_shared<Job>())
+{
+    job->function = std::move(function);
+    job->client = client.state;
+    job->trigger = this;
+}
+
+WorkerPool::Trigger::~Trigger()
+{
+    stop();
+}
+
+void WorkerPool::Trigger::fire() noexcept
+{
+    auto current = state.load();
+    for (;;)
+    {
+        if (current == idle)
+        {
+            if (!state.compare_exchange_weak(current, queued))
+                continue;
+
+            //pushed onto the pool's fired list, the worker that's woken queues it from there
+            auto* head = pool.firedTriggers.load();
+            do
+            {
+                nextFired = head;
+            }
+            while (!pool.firedTriggers.compare_exchange_weak(head, this));
+            pool.Wake();
+            return;
+        }
+
+        if (current == running)
+        {
+            if (!state.compare_exchange_weak(current, firedWhileRunning))
+                continue;
+            return;
+        }
+
+        //already queued, or already due to run again
+        return;
+    }
+}
+
+void WorkerPool::Trigger::fireAndWake()
+{
+    fire();
+    pool.QueueFiredTriggers();
+}
+
+void WorkerPool::Trigger::stop()
+{
+    //a queued run still has to come round before it's out of the pool's hands, it just doesn't call the job
+    stopped = true;
+    while (state.load() != idle)
+        juce::Thread::sleep(1);
+}
+
+void WorkerPool::Trigger::start()
+{
+    stopped = false;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//one set of background threads shared by every instance in the process, so 200 instances don't mean hundreds of
+//designer threads. it's held through juce::SharedResourcePointer: the first Client creates it and it goes away
+//with the last one
+//
+//every worker has its own queues, one per priority. jobs from outside the pool are dealt round the workers, jobs a
+//job submits stay on its worker, and a worker with nothing of its own steals from the others, so one instance
+//queueing a lot of work doesn't leave the rest of the pool idle. the highest priority with anything queued
+//anywhere always goes first
+//
+//idle workers sleep on one semaphore until something is queued or a trigger fires, they never wake up just to look
+class WorkerPool
+{
+public:
+    enum Priority
+    {
+        background,
+        normal,
+        //an instance with its editor open, the user is looking at whatever it's waiting for
+        visible,
+        numPriorities
+    };
+
+    WorkerPool();
+    ~WorkerPool();
+
+    int getNumWorkers() const { return workers.size(); }
+
+    //long jobs look at this now and again and return early, something newer has made their result pointless
+    static bool isCurrentJobCancelled();
+
+    class Client;
+    class Trigger;
+
+private:
+    struct ClientState
+    {
+        std::atomic<int> priority {normal};
+        std::atomic<int> numOutstanding {0};
+        std::atomic<bool> closed {false};
+    };
+
+    struct Job
+    {
+        std::function<void()> function;
+        std::shared_ptr<ClientState> client;
+        std::atomic<bool> cancelled {false};
+        //set for a trigger's job, which is the same job queued again every time the trigger fires
+        Trigger* trigger {nullptr};
+    };
+    using JobPointer = std::shared_ptr<Job>;
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(WorkerPool& pool, int index);
+
+        WorkerPool& pool;
+        const int index;
+        juce::CriticalSection lock;
+        std::array<std::deque<JobPointer>, numPriorities> queues;
+
+    private:
+        void run() override;
+    };
+
+    //a counting semaphore whose post never takes a lock, so the audio thread can wake a worker with it
+    //(std::counting_semaphore would do, once we're on c++20)
+    struct WakeSemaphore;
+
+    void Enqueue(const JobPointer& job);
+    JobPointer Take(Worker& worker);
+    void Run(const JobPointer& job);
+    void RunTrigger(const JobPointer& job);
+    void QueueFiredTriggers();
+    bool HasWork() const;
+    //wakes one idle worker, if there is one and no wake-up is already on its way, lock free
+    void Wake() noexcept;
+    void RemoveQueued(const ClientState& client);
+    void Requeue(const ClientState& client, int priority);
+
+    juce::OwnedArray<Worker> workers;
+    std::array<std::atomic<int>, numPriorities> numQueued {};
+    std::atomic<unsigned int> nextWorker {0};
+    //triggers fired since a worker last looked, pushed without locking so the audio thread can fire them
+    std::atomic<Trigger*> firedTriggers {nullptr};
+
+    //a worker counts itself idle before its last look for work and a waker checks the count after adding some,
+    //so between them one always sees the other. wakePending stops a burst of fires posting once each, the worker it
+    //wakes clears it and passes the wake-up on if there's more than it can take
+    std::unique_ptr<WakeSemaphore> wakeSemaphore;
+    std::atomic<int> numIdle {0};
+    std::atomic<bool> wakePending {false};
+
+    static thread_local Worker* currentWorker;
+    static thread_local Job* currentJob;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerPool)
+};
+
+//one engine's way into the pool, every job it submits goes in at the client's priority
+//destroying it cancels whatever it still has queued and waits for the jobs that are running
+class WorkerPool::Client
+{
+public:
+    explicit Client(Priority priority = normal);
+    ~Client();
+
+    //message thread or a job, these allocate
+    void submit(std::function<void()> job);
+    //cancels whatever was last submitted with this key, queued or running, and submits this instead
+    void submitLatest(int key, std::function<void()> job);
+
+    //moves everything already queued as well, so opening an editor bumps the work it's waiting on
+    void setPriority(Priority priority);
+    Priority getPriority() const { return Priority(state->priority.load()); }
+
+    bool isBusy() const { return state->numOutstanding.load() > 0; }
+
+private:
+    friend class WorkerPool::Trigger;
+
+    juce::SharedResourcePointer<WorkerPool> pool;
+    std::shared_ptr<ClientState> state;
+
+    juce::CriticalSection latestLock;
+    std::map<int, std::weak_ptr<Job>> latest;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Client)
+};
+
+//a job that's set up once and then fired from anywhere, the audio thread included: firing never locks or allocates
+//a fired trigger runs once on the pool however many times it was fired, and never on two workers at once.
+//firing it while it's running makes isCurrentJobCancelled() true for that run and queues another one
+//it has to be destroyed before its client
+class WorkerPool::Trigger
+{
+public:
+    Trigger(Client& client, std::function<void()> job);
+    ~Trigger();
+
+    //pushes it onto the pool's fired list and wakes an idle worker to queue it
+    void fire() noexcept;
+    //fires it and queues it on this thread, so the worker that's woken finds it already queued
+    //queueing takes the pool's locks, so this is for threads that can wait a moment, like an offline render's
+    void fireAndWake();
+
+    //waits for a run that's queued or running to finish, the job isn't called again until start
+    void stop();
+    void start();
+
+private:
+    friend class WorkerPool;
+
+    enum State { idle, queued, running, firedWhileRunning };
+
+    WorkerPool& pool;
+    JobPointer job;
+    std::atomic<int> state {idle};
+    std::atomic<bool> stopped {false};
+    Trigger* nextFired {nullptr};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Trigger)
+};
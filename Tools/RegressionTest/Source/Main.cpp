@@ -0,0 +1,585 @@
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/ResponseAnalysis.h"
+#include "../../../Source/BiquadKernels.h"
+
+//renders impulses through the whole processor for every combination of a set of eq settings, cut slopes,
+//sample rates and processing paths, and checks what comes out against two references:
+//  the response worked out from the coefficients (see ResponseAnalysis), within a tolerance that depends on the path
+//  golden responses from a known good build, which catch anything that changes the output by more than 0.01db
+//
+//  RegressionTest [--rates=44100,48000,96000] [--golden=Golden/responses.csv] [--write] [--filter=text]
+//
+//--write replaces the golden file with what this build renders instead of comparing against it, and is only meant
+//for a change that is supposed to move the output. --filter only runs the cases with that text in their name
+//the golden file starts with a line saying which build wrote it (compiler, juce, cpu, kernel and date), since a file
+//from a different compiler or cpu can be a few hundredths of a db off without anything being wrong. until a file has
+//been written the golden comparison is skipped and says so, and a case missing from an existing file fails
+//
+//on top of that every kernel variant this cpu supports has to match the scalar one exactly, both through the
+//processor and in BiquadKernels::CheckVariants, and the multithreaded render has to match the single threaded one
+//exits with 1 if anything failed. it's only built optimised, since that's where the kernels could start to differ
+
+//the processing paths, in the order they're run
+enum class Path
+{
+    Biquad,
+    Svf,
+    LinearPhase,
+    Render,
+    RenderThreaded
+};
+
+static const char* GetPathName(Path path)
+{
+    switch (path)
+    {
+        case Path::Biquad:         return "biquad";
+        case Path::Svf:            return "svf";
+        case Path::LinearPhase:    return "linear phase";
+        case Path::Render:         return "render";
+        case Path::RenderThreaded: return "render threaded";
+    }
+
+    return "";
+}
+
+//how close a path has to get to the response worked out from the coefficients, and over which frequencies
+//the fir is windowed and can't resolve much below a few of its bins, and the render path's closed form designs
+//at the oversampled rate are meant to differ from the bilinear ones towards nyquist
+struct PathTolerance
+{
+    double maxErrorInDb, highestFraction;
+    int lowestFirBins;
+};
+
+static PathTolerance GetPathTolerance(Path path)
+{
+    switch (path)
+    {
+        case Path::Biquad:         return { 0.1, 0.45, 0 };
+        case Path::Svf:            return { 0.1, 0.45, 0 };
+        case Path::LinearPhase:    return { 1.0, 0.45, 16 };
+        case Path::Render:
+        case Path::RenderThreaded: return { 1.0, 0.25, 0 };
+    }
+
+    return {};
+}
+
+//one set of knobs, the second set is only used by the unlinked stereo modes
+struct NamedSettings
+{
+    juce::String name;
+    StereoMode stereoMode;
+    std::function<void(ChainSettings& first, ChainSettings& second)> apply;
+};
+
+static std::vector<NamedSettings> MakeSettingsMatrix()
+{
+    auto cuts = [](ChainSettings& settings, float low, float high)
+    {
+        settings.lowCutFreq = low;
+        settings.highCutFreq = high;
+    };
+    auto peak = [](ChainSettings& settings, float freq, float gainInDb, float quality)
+    {
+        settings.peakFreq = freq;
+        settings.peakGainInDb = gainInDb;
+        settings.peakQuality = quality;
+    };
+    auto band = [](ChainSettings& settings, int index, BandType type, float freq, float gainInDb, float quality)
+    {
+        settings.bands[(size_t) index] = { type, freq, gainInDb, quality, true };
+    };
+
+    return {
+        { "Flat", StereoMode::Linked, [](ChainSettings&, ChainSettings&) {} },
+        { "Peak", StereoMode::Linked, [=](ChainSettings& first, ChainSettings&)
+            {
+                cuts(first, 80.f, 12000.f);
+                peak(first, 1000.f, 12.f, 1.f);
+            } },
+        { "Narrow cut", StereoMode::Linked, [=](ChainSettings& first, ChainSettings&)
+            {
+                cuts(first, 40.f, 16000.f);
+                peak(first, 3150.f, -18.f, 8.f);
+            } },
+        { "Bands", StereoMode::Linked, [=](ChainSettings& first, ChainSettings&)
+            {
+                cuts(first, 30.f, 18000.f);
+                band(first, 0, BandType::LowShelf, 120.f, 4.f, .71f);
+                band(first, 1, BandType::Bell, 450.f, -3.f, 2.f);
+                band(first, 2, BandType::Notch, 60.f, 0.f, 10.f);
+                band(first, 3, BandType::HighShelf, 8000.f, 3.f, .71f);
+                band(first, 4, BandType::Tilt, 1000.f, 2.f, .71f);
+            } },
+        { "Left/right", StereoMode::LeftRight, [=](ChainSettings& first, ChainSettings& second)
+            {
+                cuts(first, 60.f, 14000.f);
+                peak(first, 2500.f, 6.f, 1.5f);
+                cuts(second, 100.f, 6000.f);
+                peak(second, 200.f, -6.f, .7f);
+            } },
+        { "Mid/side", StereoMode::MidSide, [=](ChainSettings& first, ChainSettings& second)
+            {
+                cuts(first, 60.f, 14000.f);
+                peak(first, 2500.f, 6.f, 1.5f);
+                band(first, 0, BandType::Bell, 700.f, -4.f, 1.f);
+                cuts(second, 100.f, 6000.f);
+                peak(second, 200.f, -6.f, .7f);
+            } }
+    };
+}
+
+//every slope only has to be right once, so the matrix takes a shallow, an odd, a steep and the steepest one
+static const std::array<Slope, 4> slopes { Slope::Slope_6, Slope::Slope_18, Slope::Slope_48, Slope::Slope_96 };
+
+static juce::String GetSlopeName(Slope slope)
+{
+    switch (slope)
+    {
+        case Slope::Slope_6:  return "6db";
+        case Slope::Slope_18: return "18db";
+        case Slope::Slope_48: return "48db";
+        case Slope::Slope_96: return "96db";
+        default:              return "slope " + juce::String(int(slope));
+    }
+}
+
+static const std::array<Path, 5> paths { Path::Biquad, Path::Svf, Path::LinearPhase, Path::Render, Path::RenderThreaded };
+
+static constexpr int responseOrder = 16;
+static constexpr int responseLength = 1 << responseOrder;
+static constexpr int maxBlockSize = 512;
+//the default fir length, 8192
+static constexpr int firLengthChoice = 1;
+static constexpr int firLength = 4096 << firLengthChoice;
+//odd sizes mixed in, so state that doesn't carry across block boundaries shows up
+static const std::array<int, 6> blockPattern { 512, 97, 509, 1, 256, 33 };
+
+//the impulse responses of the main bus' two channels
+using Responses = std::array<std::vector<float>, 2>;
+
+struct Case
+{
+    const NamedSettings* settings;
+    Slope slope;
+    double sampleRate;
+    Path path;
+
+    juce::String getName() const
+    {
+        return settings->name + " | " + GetSlopeName(slope) + " | " + juce::String(int(sampleRate)) + " | " + GetPathName(path);
+    }
+};
+
+static void SetParameter(SimpleEQAudioProcessor& processor, const juce::String& id, float value)
+{
+    auto* parameter = processor.apvts.getParameter(id);
+    if (parameter == nullptr)
+    {
+        jassertfalse;
+        return;
+    }
+
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+//sets the case's knobs on a fresh processor, lets it settle, then renders the impulse
+//the settings it ends up with (after the parameters have snapped them to their ranges) are handed back for the analysis
+static bool RenderCase(const Case& testCase, Responses& responses, ChainSettings& first, ChainSettings& second, juce::String& error)
+{
+    SimpleEQAudioProcessor processor;
+
+    //anything the case doesn't set stays at the parameter's default
+    auto requestedFirst = getChainSettings(processor.apvts, 0);
+    auto requestedSecond = getChainSettings(processor.apvts, 1);
+    testCase.settings->apply(requestedFirst, requestedSecond);
+    requestedFirst.lowCutSlope = requestedFirst.highCutSlope = testCase.slope;
+    requestedSecond.lowCutSlope = requestedSecond.highCutSlope = testCase.slope;
+
+    auto setParameter = [&processor](const juce::String& id, float value) { SetParameter(processor, id, value); };
+    WriteChainSettings(setParameter, requestedFirst, 0);
+    WriteChainSettings(setParameter, requestedSecond, 1);
+    setParameter("StereoMode", float(testCase.settings->stereoMode));
+    setParameter("FilterEngine", testCase.path == Path::Svf ? 1.f : 0.f);
+    setParameter("LinearPhase", testCase.path == Path::LinearPhase ? 1.f : 0.f);
+    setParameter("FirLength", float(firLengthChoice));
+    auto render = testCase.path == Path::Render || testCase.path == Path::RenderThreaded;
+    setParameter("RenderQuality", render ? 1.f : 0.f);
+    setParameter("RenderMultithreaded", testCase.path == Path::RenderThreaded ? 1.f : 0.f);
+
+    first = getChainSettings(processor.apvts, 0);
+    second = testCase.settings->stereoMode == StereoMode::Linked ? first : getChainSettings(processor.apvts, 1);
+
+    //the render path only runs when the host says it's bouncing
+    processor.setNonRealtime(render);
+    processor.setRateAndBufferSizeDetails(testCase.sampleRate, maxBlockSize);
+    processor.prepareToPlay(testCase.sampleRate, maxBlockSize);
+
+    juce::AudioBuffer<float> buffer (juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), maxBlockSize);
+    juce::MidiBuffer midi;
+    auto processBlock = [&](int numSamples)
+    {
+        juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+        processor.processBlock(block, midi);
+    };
+
+    //silence until the smoothing has caught up and the background designs have landed
+    auto start = juce::Time::getMillisecondCounterHiRes();
+    for (int settled = 0; settled < int(testCase.sampleRate * 0.5) || processor.hasPendingDesigns(); settled += maxBlockSize)
+    {
+        buffer.clear();
+        processBlock(maxBlockSize);
+
+        if (processor.hasPendingDesigns())
+        {
+            if (juce::Time::getMillisecondCounterHiRes() - start > 10000.0)
+            {
+                error = "the background designs never landed";
+                return false;
+            }
+            juce::Thread::sleep(1);
+        }
+    }
+
+    //an impulse on both channels, or only on the left in mid/side so the side gets one too
+    for (auto& response : responses)
+        response.assign((size_t) responseLength, 0.f);
+
+    for (int position = 0, block = 0; position < responseLength; block++)
+    {
+        auto numSamples = juce::jmin(blockPattern[(size_t) block % blockPattern.size()], responseLength - position);
+        buffer.clear();
+        if (position == 0)
+        {
+            buffer.setSample(0, 0, 1.f);
+            if (testCase.settings->stereoMode != StereoMode::MidSide)
+                buffer.setSample(1, 0, 1.f);
+        }
+
+        processBlock(numSamples);
+
+        for (int channel = 0; channel < 2; channel++)
+            std::copy(buffer.getReadPointer(channel), buffer.getReadPointer(channel) + numSamples, responses[(size_t) channel].begin() + position);
+        position += numSamples;
+    }
+
+    return true;
+}
+
+static std::vector<float> GetMagnitudeSpectrum(const std::vector<float>& response)
+{
+    juce::dsp::FFT fft (responseOrder);
+    std::vector<float> spectrum ((size_t) (2 * responseLength), 0.f);
+    std::copy(response.begin(), response.end(), spectrum.begin());
+    fft.performFrequencyOnlyForwardTransform(spectrum.data(), true);
+    spectrum.resize((size_t) (responseLength / 2 + 1));
+    return spectrum;
+}
+
+static int GetNearestBin(double freq, double sampleRate)
+{
+    return juce::jlimit(1, responseLength / 2, juce::roundToInt(freq * responseLength / sampleRate));
+}
+
+//the worst difference between the rendered magnitudes and the ones worked out from the coefficients,
+//only where the expected level is high enough for the difference to mean anything
+static double CompareToAnalysis(const Case& testCase, const std::array<std::vector<float>, 2>& spectra,
+                                const ChainSettings& first, const ChainSettings& second, double& worstFreq)
+{
+    auto sampleRate = testCase.sampleRate;
+    auto tolerance = GetPathTolerance(testCase.path);
+    auto lowest = juce::jmax(20.0, tolerance.lowestFirBins * sampleRate / firLength);
+
+    std::vector<int> bins;
+    std::vector<double> frequencies;
+    for (auto freq : MakeLogFrequencyGrid(256, lowest, tolerance.highestFraction * sampleRate))
+    {
+        auto bin = GetNearestBin(freq, sampleRate);
+        bins.push_back(bin);
+        frequencies.push_back(double(bin) * sampleRate / responseLength);
+    }
+
+    auto firstCurve = AnalyseResponse(MakeChainSections(first, sampleRate), frequencies, sampleRate);
+    auto secondCurve = AnalyseResponse(MakeChainSections(second, sampleRate), frequencies, sampleRate);
+
+    double worst = 0;
+    for (size_t f = 0; f < frequencies.size(); f++)
+    {
+        //the fir has the magnitudes with no phase (it's a delay, and the same one on both sides)
+        auto linearPhase = testCase.path == Path::LinearPhase;
+        auto a = std::polar(juce::Decibels::decibelsToGain(firstCurve.magnitudeInDb[f], -300.0), linearPhase ? 0.0 : firstCurve.phaseInRadians[f]);
+        auto b = std::polar(juce::Decibels::decibelsToGain(secondCurve.magnitudeInDb[f], -300.0), linearPhase ? 0.0 : secondCurve.phaseInRadians[f]);
+
+        //with only the left channel excited, mid and side both get half of it and the decode adds and subtracts them
+        std::array<std::complex<double>, 2> expected { a, b };
+        if (testCase.settings->stereoMode == StereoMode::MidSide)
+            expected = { 0.5 * (a + b), 0.5 * (a - b) };
+
+        for (size_t channel = 0; channel < 2; channel++)
+        {
+            auto expectedInDb = juce::Decibels::gainToDecibels(std::abs(expected[channel]), -300.0);
+            if (expectedInDb < -24.0)
+                continue;
+
+            auto error = std::abs(juce::Decibels::gainToDecibels(double(spectra[channel][(size_t) bins[f]]), -300.0) - expectedInDb);
+            if (error > worst)
+            {
+                worst = error;
+                worstFreq = frequencies[f];
+            }
+        }
+    }
+
+    return worst;
+}
+
+//what goes in the golden file, the rendered magnitudes at a few fixed frequencies on each channel
+static constexpr int numGoldenPoints = 64;
+static constexpr double goldenToleranceInDb = 0.01;
+//below this it's the fft's rounding being compared, which differs from platform to platform
+static constexpr double goldenFloorInDb = -100.0;
+
+static std::vector<float> GetGoldenValues(const std::array<std::vector<float>, 2>& spectra, double sampleRate)
+{
+    std::vector<float> values;
+    for (const auto& spectrum : spectra)
+        for (auto freq : MakeLogFrequencyGrid(numGoldenPoints, 20.0, 0.45 * sampleRate))
+            values.push_back(juce::Decibels::gainToDecibels(spectrum[(size_t) GetNearestBin(freq, sampleRate)], -200.f));
+    return values;
+}
+
+//what wrote a golden file, which is as much as can be said about why two builds might render differently
+static juce::String GetBuildDescription()
+{
+   #if defined (__clang__)
+    juce::String compiler ("clang " __clang_version__);
+   #elif defined (__GNUC__)
+    juce::String compiler ("gcc " __VERSION__);
+   #elif defined (_MSC_VER)
+    juce::String compiler ("msvc " + juce::String(_MSC_FULL_VER));
+   #else
+    juce::String compiler ("unknown compiler");
+   #endif
+
+   #if JUCE_DEBUG
+    compiler << " debug";
+   #else
+    compiler << " release";
+   #endif
+
+    return compiler + " | " + juce::SystemStats::getJUCEVersion() + " | " + juce::SystemStats::getCpuModel().trim()
+         + " | " + BiquadKernels::GetVariantName(BiquadKernels::GetActiveVariant(2)) + " kernel | " + juce::Time::getCurrentTime().toISO8601(true);
+}
+
+//a # line saying which build wrote it, then the case name and its values, one case per line
+static std::map<juce::String, std::vector<float>> ReadGolden(const juce::File& file, juce::String& writtenBy)
+{
+    std::map<juce::String, std::vector<float>> golden;
+    juce::StringArray lines;
+    file.readLines(lines);
+    for (const auto& line : lines)
+    {
+        if (line.startsWith("#"))
+        {
+            writtenBy = line.substring(1).trim();
+            continue;
+        }
+
+        auto fields = juce::StringArray::fromTokens(line, ",", "\"");
+        if (fields.size() < 2)
+            continue;
+
+        auto& values = golden[fields[0].unquoted()];
+        for (int i = 1; i < fields.size(); i++)
+            values.push_back(fields[i].getFloatValue());
+    }
+    return golden;
+}
+
+static bool WriteGolden(const juce::File& file, const std::map<juce::String, std::vector<float>>& golden)
+{
+    juce::MemoryOutputStream stream;
+    stream << "# " << GetBuildDescription() << "\n";
+    for (const auto& [name, values] : golden)
+    {
+        stream << name.quoted();
+        for (auto value : values)
+            stream << "," << juce::String(value, 4);
+        stream << "\n";
+    }
+
+    return file.getParentDirectory().createDirectory().wasOk() && file.replaceWithData(stream.getData(), stream.getDataSize());
+}
+
+//every kernel variant this cpu has, through the processor, has to give exactly what the scalar one does
+static bool CheckKernelVariants(const Case& testCase, juce::String& error)
+{
+    Responses reference;
+    ChainSettings first, second;
+
+    for (int i = 0; i < BiquadKernels::numVariants; i++)
+    {
+        auto variant = static_cast<BiquadKernels::Variant>(i);
+        if (!BiquadKernels::ForceVariant(variant))
+            continue;
+
+        Responses responses;
+        auto rendered = RenderCase(testCase, responses, first, second, error);
+        BiquadKernels::ClearForcedVariant();
+        if (!rendered)
+            return false;
+
+        if (variant == BiquadKernels::Variant::Scalar)
+        {
+            reference = std::move(responses);
+            continue;
+        }
+
+        if (responses != reference)
+        {
+            error = BiquadKernels::GetVariantName(variant) + " doesn't match the scalar kernel";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main (int argc, char* argv[])
+{
+    //the processor's parameters and preset bank need a message manager even though nothing is shown
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    std::vector<double> sampleRates;
+    for (const auto& rate : juce::StringArray::fromTokens(args.containsOption("--rates") ? args.getValueForOption("--rates") : "44100,48000,96000", ",", {}))
+        if (rate.getDoubleValue() > 0)
+            sampleRates.push_back(rate.getDoubleValue());
+
+    auto goldenFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.containsOption("--golden") ? args.getValueForOption("--golden") : "Golden/responses.csv");
+    auto writeGolden = args.containsOption("--write");
+    auto filter = args.getValueForOption("--filter");
+
+    juce::String goldenWrittenBy;
+    auto golden = writeGolden ? std::map<juce::String, std::vector<float>>() : ReadGolden(goldenFile, goldenWrittenBy);
+    auto compareGolden = !writeGolden && !golden.empty();
+    std::cout << "this build: " << GetBuildDescription() << std::endl;
+    if (compareGolden)
+        std::cout << "golden responses from: " << (goldenWrittenBy.isNotEmpty() ? goldenWrittenBy : juce::String("an unknown build")) << std::endl;
+    else if (!writeGolden)
+        std::cout << "no golden responses in " << goldenFile.getFullPathName() << ", only checking against the designed responses until they're written with --write" << std::endl;
+
+    int numCases = 0, numFailed = 0;
+    auto fail = [&numFailed](const juce::String& name, const juce::String& reason)
+    {
+        std::cout << "FAIL  " << name << ": " << reason << std::endl;
+        numFailed++;
+    };
+
+    //the kernels on their own first, everything after this relies on them
+    for (auto sampleRate : sampleRates)
+    {
+        for (const auto& report : BiquadKernels::CheckVariants(sampleRate))
+        {
+            numCases++;
+            auto name = "kernel " + BiquadKernels::GetVariantName(report.variant) + " | " + juce::String(int(sampleRate));
+            if (report.maxError != 0.f)
+                fail(name, "max error " + juce::String(report.maxError) + " against scalar, null " + juce::String(report.nullDepthInDb, 1) + " db");
+            else if (report.magnitudeErrorInDb >= 0.1)
+                fail(name, "magnitude error " + juce::String(report.magnitudeErrorInDb, 3) + " db");
+        }
+    }
+
+    auto matrix = MakeSettingsMatrix();
+    //the single threaded render of each case, which the threaded one has to match exactly
+    std::map<juce::String, Responses> singleThreadedRenders;
+
+    for (const auto& settings : matrix)
+    {
+        for (auto slope : slopes)
+        {
+            for (auto sampleRate : sampleRates)
+            {
+                for (auto path : paths)
+                {
+                    Case testCase { &settings, slope, sampleRate, path };
+                    auto name = testCase.getName();
+                    if (filter.isNotEmpty() && !name.containsIgnoreCase(filter))
+                        continue;
+
+                    numCases++;
+                    Responses responses;
+                    ChainSettings first, second;
+                    juce::String error;
+                    if (!RenderCase(testCase, responses, first, second, error))
+                    {
+                        fail(name, error);
+                        continue;
+                    }
+
+                    std::array<std::vector<float>, 2> spectra { GetMagnitudeSpectrum(responses[0]), GetMagnitudeSpectrum(responses[1]) };
+
+                    double worstFreq = 0;
+                    auto worst = CompareToAnalysis(testCase, spectra, first, second, worstFreq);
+                    if (worst > GetPathTolerance(path).maxErrorInDb)
+                        fail(name, juce::String(worst, 3) + " db from the designed response at " + juce::String(worstFreq, 1) + " hz");
+
+                    auto values = GetGoldenValues(spectra, sampleRate);
+                    if (writeGolden)
+                    {
+                        golden[name] = values;
+                    }
+                    else if (compareGolden)
+                    {
+                        auto found = golden.find(name);
+                        if (found == golden.end() || found->second.size() != values.size())
+                        {
+                            fail(name, "no golden response");
+                        }
+                        else
+                        {
+                            double goldenError = 0;
+                            for (size_t i = 0; i < values.size(); i++)
+                                if (found->second[i] > goldenFloorInDb || values[i] > goldenFloorInDb)
+                                    goldenError = juce::jmax(goldenError, std::abs(double(values[i]) - found->second[i]));
+
+                            if (goldenError > goldenToleranceInDb)
+                                fail(name, juce::String(goldenError, 4) + " db from the golden response");
+                        }
+                    }
+
+                    if (path == Path::Biquad && !CheckKernelVariants(testCase, error))
+                        fail(name, error);
+
+                    auto renderName = Case { &settings, slope, sampleRate, Path::Render }.getName();
+                    if (path == Path::Render)
+                    {
+                        singleThreadedRenders[renderName] = responses;
+                    }
+                    else if (path == Path::RenderThreaded)
+                    {
+                        auto found = singleThreadedRenders.find(renderName);
+                        if (found != singleThreadedRenders.end() && found->second != responses)
+                            fail(name, "doesn't match the single threaded render");
+                    }
+                }
+            }
+        }
+    }
+
+    if (writeGolden)
+    {
+        if (!WriteGolden(goldenFile, golden))
+        {
+            std::cout << "can't write " << goldenFile.getFullPathName() << std::endl;
+            return 1;
+        }
+        std::cout << "wrote " << golden.size() << " golden responses to " << goldenFile.getFullPathName() << std::endl;
+    }
+
+    std::cout << numCases - numFailed << " of " << numCases << " cases passed" << std::endl;
+    return numFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/PresetBank.h"
+#include "../../../Source/ResponseAnalysis.h"
+
+//exports the response curve of every preset in a bank without rendering any audio
+//
+//  ResponseExport [bank file] [--rate=48000] [--points=512] [--low=20] [--high=20000]
+//                 [--impulse=0] [--threads=0] [--binary] [--output=file]
+//
+//with no bank file the default bank is used, and if that's empty the default parameters are exported
+//each preset gives two results, its left (or mid) side and its right (or side) side
+int main (int argc, char* argv[])
+{
+    //the processor's parameters and preset bank need a message manager even though nothing is shown
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    auto optionOr = [&args](const juce::String& option, double fallback)
+    {
+        auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value.getDoubleValue() : fallback;
+    };
+
+    auto sampleRate = optionOr("--rate", 48000.0);
+    auto numPoints = (int) optionOr("--points", 512.0);
+    auto impulseLength = (int) optionOr("--impulse", 0.0);
+    auto numThreads = (int) optionOr("--threads", 0.0);
+    auto frequencies = MakeLogFrequencyGrid(numPoints, optionOr("--low", 20.0), optionOr("--high", 20000.0));
+
+    SimpleEQAudioProcessor processor;
+    auto& bank = processor.getPresetBank();
+    if (args.size() > 0 && !args[0].isOption() && !bank.loadBank(args[0].resolveAsFile()))
+    {
+        std::cerr << "couldn't read preset bank " << args[0].text << std::endl;
+        return 1;
+    }
+
+    std::vector<ChainSettings> settings;
+    juce::StringArray labels;
+    for (int i = 0; i < bank.getNumPresets(); i++)
+    {
+        ChainSettings left, right;
+        if (!bank.getPresetSettings(i, left, right))
+            continue;
+
+        auto name = bank.getPresetName(i);
+        settings.push_back(left);
+        labels.add(name + "/L");
+        settings.push_back(right);
+        labels.add(name + "/R");
+    }
+
+    if (settings.empty())
+    {
+        settings.push_back(getChainSettings(processor.apvts));
+        labels.add("Default");
+    }
+
+    auto start = juce::Time::getMillisecondCounterHiRes();
+    auto results = AnalyseResponses(settings, sampleRate, frequencies, impulseLength, numThreads);
+    auto elapsed = juce::Time::getMillisecondCounterHiRes() - start;
+
+    juce::MemoryOutputStream output;
+    if (args.containsOption("--binary"))
+        WriteResponsesBinary(output, frequencies, impulseLength, results);
+    else
+        WriteResponsesCsv(output, labels, frequencies, results);
+
+    auto outputFile = args.getValueForOption("--output");
+    if (outputFile.isNotEmpty())
+    {
+        auto file = juce::File::getCurrentWorkingDirectory().getChildFile(outputFile);
+        if (!file.replaceWithData(output.getData(), output.getDataSize()))
+        {
+            std::cerr << "couldn't write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout.write(static_cast<const char*>(output.getData()), (std::streamsize) output.getDataSize());
+    }
+
+    std::cerr << "analysed " << results.size() << " curves in " << elapsed << " ms" << std::endl;
+    return 0;
+}
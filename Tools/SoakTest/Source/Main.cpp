@@ -0,0 +1,616 @@
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/AutomationRecorder.h"
+#include "../../../Source/Timeline.h"
+#include "../../../Source/BiquadKernels.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+#endif
+
+//runs a whole session's worth of eq instances with no editors and no audio device, as fast as it can,
+//and reports how close each block came to the real time deadline
+//
+//  SoakTest [--instances=64] [--rate=48000] [--block=256] [--seconds=30] [--threads=0]
+//           [--trace=file.csv] [--seed=1]
+//  SoakTest --replay=file.seqa [--seed=1]
+//  SoakTest --state-benchmark [--instances=64] [--rate=48000] [--block=256] [--seed=1]
+//  either can take --timeline=file.json when built with SIMPLEEQ_TIMELINE=1
+//  and --kernel=scalar|sse2|avx2|avx512|neon
+//
+//--threads=0 processes every instance on this thread like a single core host, otherwise the instances are
+//split across that many worker threads like a multi core host
+//
+//a trace is csv with one parameter change per line: seconds,parameter id,value (the value the knob shows)
+//every instance replays it from its own random starting point, without one they get random walks
+//
+//--replay takes a trace an instance recorded itself (see AutomationRecorder) and plays it into one instance
+//with the host's exact block sizes and parameter timing, so a spike a customer saw can be brought back under a profiler
+//
+//--timeline records every marker (see Timeline) for the whole run and writes it out as chrome trace json at the end
+//
+//--kernel makes every biquad cascade use that kernel variant whatever its channel count (see BiquadKernels),
+//so the variants can be timed against each other on the same cpu
+//
+//--state-benchmark times saving and restoring every instance the way a host does when a session loads, the binary
+//state (see StateFormat) against the ValueTree sessions used to be saved as, and the first block after each restore
+
+//what the os says we are using, so memory per instance is whatever creating and preparing one adds
+static juce::int64 GetResidentMemoryBytes()
+{
+   #if JUCE_LINUX
+    auto statm = juce::File("/proc/self/statm").loadFileAsString();
+    auto pages = juce::StringArray::fromTokens(statm, " ", {})[1].getLargeIntValue();
+    return pages * (juce::int64) sysconf(_SC_PAGESIZE);
+   #elif JUCE_MAC
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+        return 0;
+    return (juce::int64) info.resident_size;
+   #elif JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return (juce::int64) counters.WorkingSetSize;
+   #else
+    return 0;
+   #endif
+}
+
+struct AutomationEvent
+{
+    juce::int64 sample;
+    int parameterIndex;
+    float normalisedValue;
+};
+
+//parameter changes sorted by time, looped for as long as the test runs
+static std::vector<AutomationEvent> LoadTrace(const juce::File& file, SimpleEQAudioProcessor& processor, double sampleRate)
+{
+    std::vector<AutomationEvent> events;
+    const auto& parameters = processor.getParameters();
+
+    juce::StringArray lines;
+    file.readLines(lines);
+    for (const auto& line : lines)
+    {
+        auto fields = juce::StringArray::fromTokens(line, ",", "\"");
+        if (fields.size() < 3 || !fields[0].containsOnly("0123456789.eE-+"))
+            continue;
+
+        auto* parameter = processor.apvts.getParameter(fields[1].trim());
+        if (parameter == nullptr)
+            continue;
+
+        events.push_back({ juce::int64(fields[0].getDoubleValue() * sampleRate), parameters.indexOf(parameter),
+                           parameter->convertTo0to1(fields[2].getFloatValue()) });
+    }
+
+    std::sort(events.begin(), events.end(), [](const auto& a, const auto& b) { return a.sample < b.sample; });
+    return events;
+}
+
+//a random walk on the knobs people actually move, a change every 10ms or so
+static std::vector<AutomationEvent> MakeRandomTrace(SimpleEQAudioProcessor& processor, double sampleRate, double seconds, juce::Random& random)
+{
+    std::vector<AutomationEvent> events;
+    const auto& parameters = processor.getParameters();
+
+    juce::StringArray ids { "PeakFreq", "PeakGain", "PeakQ", "LowCutFreq", "HiCutFreq", "Band1Gain", "Band2Freq" };
+    std::vector<float> values;
+    std::vector<int> indices;
+    for (const auto& id : ids)
+    {
+        if (auto* parameter = processor.apvts.getParameter(id))
+        {
+            indices.push_back(parameters.indexOf(parameter));
+            values.push_back(parameter->getValue());
+        }
+    }
+
+    auto step = juce::int64(sampleRate * 0.01);
+    for (juce::int64 sample = 0; sample < juce::int64(seconds * sampleRate) && !indices.empty(); sample += step)
+    {
+        auto which = (size_t) random.nextInt((int) indices.size());
+        values[which] = juce::jlimit(0.f, 1.f, values[which] + (random.nextFloat() - 0.5f) * 0.05f);
+        events.push_back({ sample, indices[which], values[which] });
+    }
+
+    return events;
+}
+
+struct Instance
+{
+    std::unique_ptr<SimpleEQAudioProcessor> processor;
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer midi;
+    size_t nextEvent {0};
+    juce::int64 traceOffset {0}, position {0};
+};
+
+//applies whatever automation falls in this block (at the start of it, like most hosts) and runs the block
+static void ProcessInstance(Instance& instance, const std::vector<AutomationEvent>& trace, juce::int64 traceLength,
+                            const juce::AudioBuffer<float>& input, int blockSize)
+{
+    auto& processor = *instance.processor;
+    const auto& parameters = processor.getParameters();
+
+    //the same thing a plugin wrapper does when the host automates a parameter
+    auto fireUntil = [&](juce::int64 limit)
+    {
+        while (instance.nextEvent < trace.size() && trace[instance.nextEvent].sample < limit)
+        {
+            const auto& event = trace[instance.nextEvent++];
+            auto* parameter = parameters[event.parameterIndex];
+            parameter->setValue(event.normalisedValue);
+            parameter->sendValueChangedMessageToListeners(event.normalisedValue);
+        }
+    };
+
+    if (!trace.empty())
+    {
+        auto start = (instance.traceOffset + instance.position) % traceLength;
+        auto end = start + blockSize;
+        fireUntil(end);
+
+        //wrapped round to the start of the trace
+        if (end >= traceLength)
+        {
+            instance.nextEvent = 0;
+            fireUntil(end - traceLength);
+        }
+    }
+
+    for (int channel = 0; channel < instance.buffer.getNumChannels(); channel++)
+        instance.buffer.copyFrom(channel, 0, input, channel % input.getNumChannels(), int(instance.position % (input.getNumSamples() - blockSize)), blockSize);
+
+    processor.processBlock(instance.buffer, instance.midi);
+    instance.position += blockSize;
+}
+
+//the recorded blocks one after another, with every parameter change landing just before the block it was seen in
+static int ReplayRecording(const juce::File& file, const juce::AudioBuffer<float>& input)
+{
+    AutomationTrace trace;
+    if (!AutomationRecorder::readTrace(file, trace))
+    {
+        std::cout << "can't read " << file.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    //a recording that never got stopped has no header totals, so the blocks are looked at too
+    auto maxBlockSize = trace.maxBlockSize;
+    for (const auto& event : trace.events)
+        if (event.parameter == AutomationTrace::Event::blockStart)
+            maxBlockSize = juce::jmax(maxBlockSize, int(event.value));
+    if (maxBlockSize <= 0 || maxBlockSize >= input.getNumSamples())
+    {
+        std::cout << "no usable blocks in " << file.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    SimpleEQAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails(trace.sampleRate, maxBlockSize);
+    processor.prepareToPlay(trace.sampleRate, maxBlockSize);
+
+    //by id, so the trace still lines up if this build has moved parameters around
+    std::vector<juce::AudioProcessorParameter*> parameters;
+    for (const auto& id : trace.parameterIds)
+        parameters.push_back(processor.apvts.getParameter(id));
+
+    juce::AudioBuffer<float> buffer (juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), maxBlockSize);
+    juce::MidiBuffer midi;
+
+    struct TimedBlock
+    {
+        double ms;
+        juce::int64 position;
+        int numSamples, numChanges;
+    };
+    std::vector<TimedBlock> blocks;
+    int numChanges = 0, misses = 0;
+
+    for (const auto& event : trace.events)
+    {
+        if (event.parameter != AutomationTrace::Event::blockStart)
+        {
+            //the same thing a plugin wrapper does when the host automates a parameter
+            if (auto* parameter = parameters[(size_t) event.parameter])
+            {
+                parameter->setValue(event.value);
+                parameter->sendValueChangedMessageToListeners(event.value);
+            }
+            numChanges++;
+            continue;
+        }
+
+        auto numSamples = int(event.value);
+        juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+        for (int channel = 0; channel < block.getNumChannels(); channel++)
+            block.copyFrom(channel, 0, input, channel % input.getNumChannels(), int(event.position % (input.getNumSamples() - maxBlockSize)), numSamples);
+
+        auto begin = juce::Time::getMillisecondCounterHiRes();
+        processor.processBlock(block, midi);
+        auto elapsed = juce::Time::getMillisecondCounterHiRes() - begin;
+
+        if (elapsed > 1000.0 * numSamples / trace.sampleRate)
+            misses++;
+        blocks.push_back({ elapsed, event.position, numSamples, numChanges });
+        numChanges = 0;
+    }
+
+    if (blocks.empty())
+        return 1;
+
+    double totalMs = 0;
+    juce::int64 totalSamples = 0;
+    for (const auto& block : blocks)
+    {
+        totalMs += block.ms;
+        totalSamples += block.numSamples;
+    }
+
+    std::sort(blocks.begin(), blocks.end(), [](const auto& a, const auto& b) { return a.ms > b.ms; });
+
+    std::cout << "replay               " << file.getFileName() << (trace.numDropped > 0 ? " (" + juce::String(trace.numDropped) + " events missing)" : juce::String()) << "\n"
+              << "sample rate / block  " << trace.sampleRate << " / up to " << maxBlockSize << "\n"
+              << "kernel               " << BiquadKernels::GetVariantName(processor.getKernelVariant()) << "\n"
+              << "blocks               " << blocks.size() << ", " << double(totalSamples) / trace.sampleRate << " s\n"
+              << "block time           mean " << totalMs / double(blocks.size()) << " ms, max " << blocks.front().ms << " ms\n"
+              << "deadline misses      " << misses << " of " << blocks.size() << "\n"
+              << "slowest blocks" << "\n";
+    for (size_t i = 0; i < juce::jmin(size_t(10), blocks.size()); i++)
+        std::cout << "  " << blocks[i].ms << " ms at " << blocks[i].position / trace.sampleRate << " s ("
+                  << blocks[i].numSamples << " samples, " << blocks[i].numChanges << " parameter changes)\n";
+    std::cout << std::flush;
+
+    return misses > 0 ? 2 : 0;
+}
+
+//worker threads that each own a slice of the instances and meet up at the end of every block
+class WorkerGroup
+{
+public:
+    WorkerGroup(int numThreads, std::vector<Instance>& instancesToRun, std::function<void(Instance&)> processToUse)
+        : instances(instancesToRun), process(std::move(processToUse))
+    {
+        for (int i = 0; i < numThreads; i++)
+            workers.push_back(std::make_unique<Worker>(*this, i, numThreads));
+        for (auto& worker : workers)
+            worker->startThread();
+    }
+
+    ~WorkerGroup()
+    {
+        for (auto& worker : workers)
+            worker->signalThreadShouldExit();
+        for (auto& worker : workers)
+            worker->start.signal();
+        for (auto& worker : workers)
+            worker->stopThread(1000);
+    }
+
+    //runs one block on every instance and returns once they're all done
+    void runBlock()
+    {
+        remaining = (int) workers.size();
+        for (auto& worker : workers)
+            worker->start.signal();
+        finished.wait();
+    }
+
+    //cpu time the workers actually spent processing, in ms
+    double getBusyMs() const
+    {
+        double total = 0;
+        for (const auto& worker : workers)
+            total += worker->busyMs;
+        return total;
+    }
+
+private:
+    struct Worker : public juce::Thread
+    {
+        Worker(WorkerGroup& groupToJoin, int index, int numWorkers)
+            : juce::Thread("SoakTest Worker " + juce::String(index)), group(groupToJoin), first(index), stride(numWorkers) {}
+
+        void run() override
+        {
+            while (true)
+            {
+                start.wait();
+                if (threadShouldExit())
+                    return;
+
+                auto begin = juce::Time::getMillisecondCounterHiRes();
+                for (auto i = (size_t) first; i < group.instances.size(); i += (size_t) stride)
+                    group.process(group.instances[i]);
+                busyMs += juce::Time::getMillisecondCounterHiRes() - begin;
+
+                if (--group.remaining == 0)
+                    group.finished.signal();
+            }
+        }
+
+        WorkerGroup& group;
+        int first, stride;
+        juce::WaitableEvent start;
+        double busyMs {0};
+    };
+
+    std::vector<Instance>& instances;
+    std::function<void(Instance&)> process;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<int> remaining {0};
+    juce::WaitableEvent finished;
+};
+
+//every instance saves, then restores a state with every knob moved and runs a block, once from the binary state
+//and once from the same state as a ValueTree. the times are per instance
+static int BenchmarkState(int numInstances, double sampleRate, int blockSize, juce::Random& random)
+{
+    std::vector<std::unique_ptr<SimpleEQAudioProcessor>> processors;
+    for (int i = 0; i < numInstances; i++)
+    {
+        processors.push_back(std::make_unique<SimpleEQAudioProcessor>());
+        processors.back()->setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processors.back()->prepareToPlay(sampleRate, blockSize);
+    }
+
+    auto& source = *processors.front();
+    juce::MemoryBlock defaultState, binaryState, treeState;
+    source.getStateInformation(defaultState);
+
+    //only the continuous knobs move, switching engines on would be timing something else
+    for (auto* parameter : source.getParameters())
+        if (dynamic_cast<juce::AudioParameterFloat*>(parameter) != nullptr)
+            parameter->setValueNotifyingHost(random.nextFloat());
+
+    source.getStateInformation(binaryState);
+    {
+        juce::MemoryOutputStream stream (treeState, false);
+        source.apvts.copyState().writeToStream(stream);
+    }
+
+    juce::AudioBuffer<float> buffer (juce::jmax(source.getTotalNumInputChannels(), source.getTotalNumOutputChannels()), blockSize);
+    juce::MidiBuffer midi;
+
+    auto timeEach = [&processors](const std::function<void(SimpleEQAudioProcessor&)>& function)
+    {
+        auto begin = juce::Time::getMillisecondCounterHiRes();
+        for (auto& processor : processors)
+            function(*processor);
+        return (juce::Time::getMillisecondCounterHiRes() - begin) * 1000.0 / double(processors.size());
+    };
+
+    auto saveBinary = timeEach([&](SimpleEQAudioProcessor& processor)
+    {
+        juce::MemoryBlock state;
+        processor.getStateInformation(state);
+    });
+    auto saveTree = timeEach([&](SimpleEQAudioProcessor& processor)
+    {
+        juce::MemoryBlock state;
+        juce::MemoryOutputStream stream (state, false);
+        processor.apvts.copyState().writeToStream(stream);
+    });
+
+    //back to the defaults with the filters settled, so every restore moves the same knobs from the same place
+    auto resetAll = [&]
+    {
+        for (auto& processor : processors)
+        {
+            processor->setStateInformation(defaultState.getData(), (int) defaultState.getSize());
+            buffer.clear();
+            processor->processBlock(buffer, midi);
+        }
+    };
+    auto restore = [&](const juce::MemoryBlock& state)
+    {
+        return timeEach([&](SimpleEQAudioProcessor& processor) { processor.setStateInformation(state.getData(), (int) state.getSize()); });
+    };
+    auto firstBlock = [&]
+    {
+        return timeEach([&](SimpleEQAudioProcessor& processor)
+        {
+            buffer.clear();
+            processor.processBlock(buffer, midi);
+        });
+    };
+
+    resetAll();
+    auto restoreBinary = restore(binaryState);
+    auto blockBinary = firstBlock();
+    resetAll();
+    auto restoreTree = restore(treeState);
+    auto blockTree = firstBlock();
+
+    std::cout << "instances            " << numInstances << "
+"
+              << "sample rate / block  " << sampleRate << " / " << blockSize << "
+"
+              << "state size           " << binaryState.getSize() << " bytes binary, " << treeState.getSize() << " bytes valuetree
+"
+              << "save                 " << saveBinary << " us binary, " << saveTree << " us valuetree
+"
+              << "restore              " << restoreBinary << " us binary, " << restoreTree << " us valuetree
+"
+              << "first block after    " << blockBinary << " us binary, " << blockTree << " us valuetree" << std::endl;
+
+    return 0;
+}
+
+#if SIMPLEEQ_TIMELINE
+//records for as long as it's around, so it covers whichever way main returns
+struct ScopedTimelineExport
+{
+    explicit ScopedTimelineExport(const juce::File& destination) : file(destination)
+    {
+        if (file != juce::File())
+            Timeline::start();
+    }
+
+    ~ScopedTimelineExport()
+    {
+        if (file == juce::File())
+            return;
+
+        Timeline::stop();
+        if (!Timeline::writeChromeTrace(file))
+            std::cout << "can't write " << file.getFullPathName() << std::endl;
+    }
+
+    juce::File file;
+};
+#endif
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    auto optionOr = [&args](const juce::String& option, double fallback)
+    {
+        auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value.getDoubleValue() : fallback;
+    };
+
+    auto numInstances = juce::jmax(1, (int) optionOr("--instances", 64.0));
+    auto sampleRate = optionOr("--rate", 48000.0);
+    auto blockSize = juce::jmax(1, (int) optionOr("--block", 256.0));
+    auto seconds = optionOr("--seconds", 30.0);
+    auto numThreads = (int) optionOr("--threads", 0.0);
+    juce::Random random ((juce::int64) optionOr("--seed", 1.0));
+
+    if (args.containsOption("--kernel"))
+    {
+        auto name = args.getValueForOption("--kernel").trim();
+        auto forced = false;
+        for (int i = 0; i < BiquadKernels::numVariants && !forced; i++)
+        {
+            auto variant = static_cast<BiquadKernels::Variant>(i);
+            if (BiquadKernels::GetVariantName(variant).removeCharacters("-").equalsIgnoreCase(name))
+                forced = BiquadKernels::ForceVariant(variant);
+        }
+
+        if (!forced)
+        {
+            std::cout << "kernel " << name << " doesn't exist or can't run on this cpu" << std::endl;
+            return 1;
+        }
+    }
+
+   #if SIMPLEEQ_TIMELINE
+    ScopedTimelineExport timeline (args.containsOption("--timeline")
+        ? juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--timeline")) : juce::File());
+   #endif
+
+    if (args.containsOption("--state-benchmark"))
+        return BenchmarkState(numInstances, sampleRate, blockSize, random);
+
+    //the input every instance reads from, a few seconds of quiet noise
+    juce::AudioBuffer<float> input (2, int(sampleRate * 4.0));
+    for (int channel = 0; channel < input.getNumChannels(); channel++)
+        for (int i = 0; i < input.getNumSamples(); i++)
+            input.setSample(channel, i, (random.nextFloat() - 0.5f) * 0.25f);
+    
+    if (args.containsOption("--replay"))
+        return ReplayRecording(juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--replay")), input);
+
+    //create and prepare everything up front, the way a session loads
+    std::vector<Instance> instances ((size_t) numInstances);
+    auto memoryBefore = GetResidentMemoryBytes();
+    for (auto& instance : instances)
+    {
+        instance.processor = std::make_unique<SimpleEQAudioProcessor>();
+        instance.processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+        instance.processor->prepareToPlay(sampleRate, blockSize);
+        instance.buffer.setSize(juce::jmax(instance.processor->getTotalNumInputChannels(), instance.processor->getTotalNumOutputChannels()), blockSize);
+        instance.midi.ensureSize(256);
+    }
+    auto memoryPerInstance = double(GetResidentMemoryBytes() - memoryBefore) / numInstances;
+
+    auto& first = *instances.front().processor;
+    auto footprint = first.getMemoryFootprint();
+    auto trace = args.containsOption("--trace")
+        ? LoadTrace(juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--trace")), first, sampleRate)
+        : MakeRandomTrace(first, sampleRate, 10.0, random);
+    auto traceLength = trace.empty() ? juce::int64(1) : trace.back().sample + blockSize;
+
+    for (auto& instance : instances)
+    {
+        instance.traceOffset = random.nextInt64() % traceLength;
+        if (instance.traceOffset < 0)
+            instance.traceOffset += traceLength;
+        while (instance.nextEvent < trace.size() && trace[instance.nextEvent].sample < instance.traceOffset)
+            instance.nextEvent++;
+    }
+
+    auto process = [&](Instance& instance) { ProcessInstance(instance, trace, traceLength, input, blockSize); };
+    std::unique_ptr<WorkerGroup> workers;
+    if (numThreads > 0)
+        workers = std::make_unique<WorkerGroup>(numThreads, instances, process);
+
+    auto deadlineMs = 1000.0 * blockSize / sampleRate;
+    auto numBlocks = juce::jmax(1, int(seconds * sampleRate / blockSize));
+    std::vector<double> blockTimes;
+    blockTimes.reserve((size_t) numBlocks);
+    double busyMs = 0;
+
+    for (int block = 0; block < numBlocks; block++)
+    {
+        auto begin = juce::Time::getMillisecondCounterHiRes();
+
+        if (workers != nullptr)
+        {
+            workers->runBlock();
+        }
+        else
+        {
+            for (auto& instance : instances)
+                process(instance);
+        }
+
+        auto elapsed = juce::Time::getMillisecondCounterHiRes() - begin;
+        blockTimes.push_back(elapsed);
+        busyMs += elapsed;
+    }
+
+    if (workers != nullptr)
+        busyMs = workers->getBusyMs();
+
+    auto misses = std::count_if(blockTimes.begin(), blockTimes.end(), [deadlineMs](double time) { return time > deadlineMs; });
+    auto sorted = blockTimes;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) { return sorted[(size_t) juce::jmin(double(sorted.size() - 1), p * double(sorted.size()))]; };
+
+    //one core can keep up with as many instances as fit in the deadline at the cost of an average block,
+    //and to not glitch it needs the slow blocks (99th percentile) to fit as well
+    auto meanPerInstanceMs = busyMs / (double(numBlocks) * numInstances);
+    auto worstShare = percentile(0.99) / juce::jmax(1.0, double(numThreads > 0 ? numInstances / double(numThreads) : numInstances));
+
+    std::cout << "instances            " << numInstances << (numThreads > 0 ? " on " + juce::String(numThreads) + " threads" : juce::String(" on one thread")) << "\n"
+              << "sample rate / block  " << sampleRate << " / " << blockSize << " (deadline " << deadlineMs << " ms)\n"
+              << "automation           " << trace.size() << " events" << (args.containsOption("--trace") ? " from trace" : " random") << "\n"
+              << "kernel               " << BiquadKernels::GetVariantName(first.getKernelVariant())
+              << (args.containsOption("--kernel") ? " (forced)" : "") << "\n"
+              << "block time           mean " << busyMs / numBlocks << " ms, p99 " << percentile(0.99) << " ms, max " << sorted.back() << " ms\n"
+              << "deadline misses      " << misses << " of " << numBlocks << " (" << 100.0 * double(misses) / numBlocks << "%)\n"
+              << "per instance         " << meanPerInstanceMs * 1000.0 << " us per block\n"
+              << "instances per core   " << int(deadlineMs / meanPerInstanceMs) << " average, " << int(deadlineMs / worstShare) << " at p99\n"
+              << "memory per instance  " << memoryPerInstance / 1024.0 << " KB resident, " << footprint.getTotal() / 1024.0 << " KB reported"
+              << " (processor " << footprint.processor / 1024.0 << ", linear phase " << footprint.linearPhase / 1024.0
+              << ", svf " << footprint.svf / 1024.0 << ", multiband " << footprint.multiBand / 1024.0
+              << ", presets " << footprint.presets / 1024.0 << ", morph " << footprint.morph / 1024.0
+              << ", render " << footprint.render / 1024.0 << ", crossover " << footprint.crossover / 1024.0
+              << ", match " << footprint.match / 1024.0 << ", recorder " << footprint.recorder / 1024.0
+              << ", spectrogram " << footprint.spectrogram / 1024.0 << ")" << std::endl;
+
+    return misses > 0 ? 2 : 0;
+}